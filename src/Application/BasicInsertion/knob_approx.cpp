@@ -44,6 +44,16 @@ Knob ToKnobSide(const string& side)
     }
 }
 
+/// 只读写对应一侧的旋钮。侧别无效时命令只会报错，不访问谱面
+CmdFootprint KnobFootprint(const string& side)
+{
+    if (side != "l" && side != "r")
+    {
+        return CmdFootprint();
+    }
+    return CmdFootprint{IndexedChart::LanesOf(ToKnobSide(side))};
+}
+
 }  // namespace KnobApprox_Core
 
 namespace core = KnobApprox_Core;
@@ -55,16 +65,21 @@ vector<string> KnobApprox::AcceptedCmdName()
     return {"knob"};
 }
 
-bool KnobApprox::CheckArgs(const Command& cmd)
+const ArgSchema* KnobApprox::AcceptedArgs() const
 {
     // knob [side] [start_time] [end_time] [start_pos] [end_pos]
-    return cmd.argLength() == 5 &&
-           (cmd.argIsDouble(1) || cmd.argIsRatio(1)) &&
-           (cmd.argIsDouble(2) || cmd.argIsRatio(2)) &&
-           cmd.argIsInt(3) && cmd.argIsInt(4);
+    static const ArgSchema schema(
+        {{"side"}, {"start_time", ArgType::DoubleOrRatio}, {"end_time", ArgType::DoubleOrRatio},
+         {"start_pos", ArgType::Int}, {"end_pos", ArgType::Int}});
+    return &schema;
+}
+
+CmdFootprint KnobApprox::Footprint(const Command& cmd) const
+{
+    return core::KnobFootprint(cmd.arg(0));
 }
 
-bool KnobApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool KnobApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     bool success = true;
     // STEP 1 获取信息
@@ -132,15 +147,19 @@ vector<string> KnobAddApprox::AcceptedCmdName()
     return {"knobadd"};
 }
 
-bool KnobAddApprox::CheckArgs(const Command& cmd)
+const ArgSchema* KnobAddApprox::AcceptedArgs() const
 {
     // knobadd [side] [end_time] [end_pos]
-    return cmd.argLength() == 3 &&
-           (cmd.argIsDouble(1) || cmd.argIsRatio(1)) &&
-           cmd.argIsInt(2);
+    static const ArgSchema schema({{"side"}, {"end_time", ArgType::DoubleOrRatio}, {"end_pos", ArgType::Int}});
+    return &schema;
 }
 
-bool KnobAddApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+CmdFootprint KnobAddApprox::Footprint(const Command& cmd) const
+{
+    return core::KnobFootprint(cmd.arg(0));
+}
+
+bool KnobAddApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     bool success = true;
     // STEP 1 获取信息
@@ -199,21 +218,21 @@ vector<string> KnobSlamApprox::AcceptedCmdName()
     return {"slam"};
 }
 
-bool KnobSlamApprox::CheckArgs(const Command& cmd)
+const ArgSchema* KnobSlamApprox::AcceptedArgs() const
 {
     // slam [side] [time] [start_pos] [end_pos] ([duration])
-    bool valid = cmd.argLength() >= 4 &&
-                 (cmd.argIsDouble(1) || cmd.argIsRatio(1)) &&
-                 cmd.argIsInt(2) && cmd.argIsInt(3);
-    if (valid && cmd.argLength() == 5)
-    {
-        valid &= cmd.argIsDouble(4) || cmd.argIsRatio(4);
-    }
+    static const ArgSchema schema(
+        {{"side"}, {"time", ArgType::DoubleOrRatio}, {"start_pos", ArgType::Int}, {"end_pos", ArgType::Int}},
+        {{"duration", ArgType::DoubleOrRatio}}, true);
+    return &schema;
+}
 
-    return valid;
+CmdFootprint KnobSlamApprox::Footprint(const Command& cmd) const
+{
+    return core::KnobFootprint(cmd.arg(0));
 }
 
-bool KnobSlamApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool KnobSlamApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     bool success = true;
     // STEP 1 获取信息
@@ -70,6 +70,39 @@ bool AddNote(IndexedChart& chart, const string& note_id, const IndexList<int>& n
     }
 }
 
+/// 音符所在的表。类型无效时为空
+IndexedChart::LaneSet NoteLanes(const string& note_id)
+{
+    if (note_id == "a")
+    {
+        return IndexedChart::LanesOf(BT::A);
+    }
+    else if (note_id == "b")
+    {
+        return IndexedChart::LanesOf(BT::B);
+    }
+    else if (note_id == "c")
+    {
+        return IndexedChart::LanesOf(BT::C);
+    }
+    else if (note_id == "d")
+    {
+        return IndexedChart::LanesOf(BT::D);
+    }
+    else if (note_id == "l")
+    {
+        return IndexedChart::LanesOf(FX::L);
+    }
+    else if (note_id == "r")
+    {
+        return IndexedChart::LanesOf(FX::R);
+    }
+    else
+    {
+        return IndexedChart::LaneSet();
+    }
+}
+
 }  // namespace NoteApprox_Core
 
 vector<string> NoteApprox::AcceptedCmdName()
@@ -77,25 +110,22 @@ vector<string> NoteApprox::AcceptedCmdName()
     return {"note"};
 }
 
-bool NoteApprox::CheckArgs(const Command& cmd)
+const ArgSchema* NoteApprox::AcceptedArgs() const
 {
     // note [note_type] [start] ([end])
-    bool valid = cmd.argLength() >= 2 && (cmd.argIsDouble(1) || cmd.argIsRatio(1));
-    if (cmd.argLength() == 3)
-    {
-        valid &= cmd.argIsDouble(2) || cmd.argIsRatio(2);
-    }
-    else if (cmd.argLength() > 3)
-    {
-        valid = false;
-    }
-
-    return valid;
+    static const ArgSchema schema({{"note_type"}, {"start", ArgType::DoubleOrRatio}}, {{"end", ArgType::DoubleOrRatio}});
+    return &schema;
 }
 
 namespace core = NoteApprox_Core;
 
-bool NoteApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+CmdFootprint NoteApprox::Footprint(const Command& cmd) const
+{
+    // 只读写对应的BT或FX表
+    return CmdFootprint{core::NoteLanes(cmd.arg(0))};
+}
+
+bool NoteApprox::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     bool success = true;
     // STEP 1 获取信息
@@ -19,6 +19,7 @@
 */
 
 #include "write_mark.h"
+#include "src/misc/keywords.h"
 
 #include <string>
 
@@ -27,71 +28,36 @@ using namespace std;
 namespace WriteMark_Core
 {
 
+// 命令中使用的标记名称
+constexpr auto kMarkNames = MakeKeywordTable<MarkType>({
+    {"bpm", MarkType::BPM},
+    {"sig", MarkType::TimeSignature},
+    {"signature", MarkType::TimeSignature},
+    {"fxlong_l", MarkType::FXLong},
+    {"fxlong_r", MarkType::FXLong},
+    {"fxchip_l", MarkType::FXChip},
+    {"fxchip_r", MarkType::FXChip},
+    {"laser2x_l", MarkType::Laser2x},
+    {"laser2x_r", MarkType::Laser2x},
+    {"filter", MarkType::Filter},
+    {"slamsound", MarkType::SlamSound},
+    {"knobvol", MarkType::KnobVolume},
+    {"slamvol", MarkType::SlamVolume},
+    {"zt", MarkType::ZoomTop},
+    {"zoomtop", MarkType::ZoomTop},
+    {"zb", MarkType::ZoomBottom},
+    {"zoombottom", MarkType::ZoomBottom},
+    {"zs", MarkType::ZoomSide},
+    {"zoomside", MarkType::ZoomSide},
+    {"tilt", MarkType::Tilt},
+    {"stop", MarkType::Stop},
+    {"split", MarkType::LaneSplit},
+});
+
 MarkType MarkTypeFromString(const std::string& mark_str)
 {
     // Command已经帮我们做过小写转化了
-    if(mark_str == "bpm")
-    {
-        return MarkType::BPM;
-    }
-    else if(mark_str == "sig" || mark_str == "signature")
-    {
-        return MarkType::TimeSignature;
-    }
-    else if(mark_str == "fxlong_l" || mark_str == "fxlong_r")
-    {
-        return MarkType::FXLong;
-    }
-    else if(mark_str == "fxchip_l" || mark_str == "fxchip_r")
-    {
-        return MarkType::FXChip;
-    }
-    else if(mark_str == "laser2x_l" || mark_str == "laser2x_r")
-    {
-        return MarkType::Laser2x;
-    }
-    else if(mark_str == "filter")
-    {
-        return MarkType::Filter;
-    }
-    else if(mark_str == "slamsound")
-    {
-        return MarkType::SlamSound;
-    }
-    else if(mark_str == "knobvol")
-    {
-        return MarkType::KnobVolume;
-    }
-    else if(mark_str == "slamvol")
-    {
-        return MarkType::SlamVolume;
-    }
-    else if(mark_str == "zt" || mark_str == "zoomtop")
-    {
-        return MarkType::ZoomTop;
-    }
-    else if(mark_str == "zb" || mark_str == "zoombottom")
-    {
-        return MarkType::ZoomBottom;
-    }
-    else if(mark_str == "zs" || mark_str == "zoomside")
-    {
-        return MarkType::ZoomSide;
-    }
-    else if(mark_str == "tilt")
-    {
-        return MarkType::Tilt;
-    }
-    else if(mark_str == "stop")
-    {
-        return MarkType::Stop;
-    }
-    else if(mark_str == "split")
-    {
-        return MarkType::LaneSplit;
-    }
-
-    return MarkType::Error;
+    return kMarkNames.Get(mark_str, MarkType::Error);
 }
 
 Side MarkSideFromString(const std::string& mark_str)
@@ -112,13 +78,24 @@ namespace core = WriteMark_Core;
 
 vector<string> WriteMark::AcceptedCmdName() { return {"mark"}; }
 
-bool WriteMark::CheckArgs(const Command& cmd)
+const ArgSchema* WriteMark::AcceptedArgs() const
 {
     // mark [type] [start_val] ([end_val])
-    return cmd.argLength() == 2 || cmd.argLength() == 3;
+    static const ArgSchema schema({{"type"}, {"start_val"}}, {{"end_val"}});
+    return &schema;
+}
+
+CmdFootprint WriteMark::Footprint(const Command& cmd) const
+{
+    MarkType type = core::MarkTypeFromString(cmd.arg(0));
+    if (type == MarkType::Error)
+    {
+        return CmdFootprint::Exclusive();
+    }
+    return CmdFootprint{IndexedChart::LanesOf(type, core::MarkSideFromString(cmd.arg(0)))};
 }
 
-bool WriteMark::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool WriteMark::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     // 该命令不检查用户给的值是否合法，只是往上填。
     ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
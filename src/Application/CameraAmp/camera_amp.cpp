@@ -84,22 +84,18 @@ vector<string> CameraAmp::AcceptedCmdName()
 	return { "ztamp", "zbamp", "zsamp", "tiltamp", "splitamp" };
 }
 
-bool CameraAmp::CheckArgs(const Command& cmd) {
+const ArgSchema* CameraAmp::AcceptedArgs() const {
 	// ztamp [amp] ([center-val])
-	if (cmd.argLength() >= 1 && cmd.argIsDouble(0)) {
-		if (cmd.argLength() >= 2) {
-			return cmd.argIsDouble(1);
-		}
-		else {
-			return true;
-		}
-	}
-	else {
-		return false;
-	}
+	static const ArgSchema schema({{"amp", ArgType::Double}}, {{"center-val", ArgType::Double}}, true);
+	return &schema;
+}
+
+CmdFootprint CameraAmp::Footprint(const Command& /*cmd*/) const {
+	// 作用到成对的结束命令为止
+	return CmdFootprint::ExclusiveUntilEnd();
 }
 
-bool CameraAmp::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart) {
+bool CameraAmp::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/) {
 	// STEP 1 判断命令类型
 	MarkType type;
 	if (cmd.cmd() == "ztamp") {
@@ -82,15 +82,20 @@ bool CommandBatch::CheckArgs(const Command& cmd)
     }
 }
 
+bool CommandBatch::IsDefinition(const Command& cmd) const
+{
+    // define和import只登记batch，call才会修改谱面
+    return cmd.arg(0) == "define" || cmd.arg(0) == "import";
+}
+
 /* #endregion METADATA */
 
 /* #region 三大功能 */
 
 bool CommandBatch::DefineBatch(
     const std::string& name, const std::string& content,
-    ApplicationBus::ErrorStack& err_stack)
+    ApplicationBus::ErrorStack& err_stack, ApplicationBus& bus)
 {
-    ApplicationBus& bus = ApplicationBus::GetInstance();
     Command cmd_in(content);
     CommandMap cmds;
 
@@ -121,8 +126,43 @@ CommandMap CommandBatch::LoadBatch(const std::string& name)
     }
 }
 
-bool CommandBatch::ImportFromFile(const string& path)
+bool CommandBatch::LoadCachedLibrary(const string& path, filesystem::file_time_type mtime)
+{
+    lock_guard<mutex> lock(library_mutex);
+    auto iter = library_cache.find(path);
+    if (iter == library_cache.end() || iter->second.mtime != mtime)
+    {
+        return false;
+    }
+
+    for (auto& [name, cmds] : iter->second.batches)
+    {
+        batch_map.insert_or_assign(name, cmds);
+    }
+    return true;
+}
+
+void CommandBatch::StoreCachedLibrary(const string& path, CompiledLibrary&& library)
 {
+    lock_guard<mutex> lock(library_mutex);
+    library_cache.insert_or_assign(path, std::move(library));
+}
+
+bool CommandBatch::ImportFromFile(const string& path, ApplicationBus& bus)
+{
+    // 编译结果只取决于文件内容，文件没有变化时可以复用
+    error_code ec;
+    CompiledLibrary library;
+    library.mtime = filesystem::last_write_time(path, ec);
+    if (!ec && this->LoadCachedLibrary(path, library.mtime))
+    {
+        return true;
+    }
+    // 有定义编译失败或者编译时记录了日志时不缓存，下次导入时重新报告
+    auto& err_collector = GET_ERROR_COLLECTOR;
+    const int logged_before = err_collector.ErrorCount() + err_collector.WarningCount();
+    bool cacheable = !ec;
+
     bool success = true;
 
     // 这里的path是可以直接读的。文件的搜寻交给更外面
@@ -148,9 +188,15 @@ bool CommandBatch::ImportFromFile(const string& path)
                 // EXECUTE
                 string& name = content_split[i + 2];
                 string& cmd_str = content_split[i + 3];
-                success = this->DefineBatch(name, cmd_str, err_stack);
-                if (!success)
+                success = this->DefineBatch(name, cmd_str, err_stack, bus);
+                if (success)
                 {
+                    library.batches.emplace_back(name, batch_map[name]);
+                }
+                else
+                {
+                    cacheable = false;
+
                     if (err_stack.empty())
                     {
                         GET_ERROR_COLLECTOR.ErrorLog(
@@ -177,6 +223,11 @@ bool CommandBatch::ImportFromFile(const string& path)
         }
     }
 
+    if (cacheable && err_collector.ErrorCount() + err_collector.WarningCount() == logged_before)
+    {
+        this->StoreCachedLibrary(path, std::move(library));
+    }
+
     return success;
 }
 
@@ -184,7 +235,7 @@ bool CommandBatch::ImportFromFile(const string& path)
 
 /* #region 总入口 */
 
-bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus)
 {
     bool success = true;
     const string& subtype = cmd.arg(0);
@@ -193,7 +244,7 @@ bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedCh
     {
         ApplicationBus::ErrorStack err_stack;
 
-        success = DefineBatch(cmd.arg(1), cmd.arg(2), err_stack);
+        success = DefineBatch(cmd.arg(1), cmd.arg(2), err_stack, bus);
         if (!success)
         {
             if (err_stack.empty())
@@ -229,7 +280,7 @@ bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedCh
         else
         {
             err_collector.AddToStack(cmd.toOriginalString());
-            ApplicationBus::GetInstance().ExecuteBatch(batch, cmd.time());
+            bus.ExecuteBatch(batch, cmd.time());
             err_collector.PopStack();
         }
     }
@@ -237,7 +288,7 @@ bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedCh
     else if (subtype == "import")
     {
         string path_in_cmd = cmd.substring(1);
-        string full_path = PathManager::GetInstance().FindFirstFileInPath(path_in_cmd);
+        string full_path = bus.Paths().FindFirstFileInPath(path_in_cmd);
         if (full_path.empty())
         {
             GET_ERROR_COLLECTOR.ErrorLog("Import file not found.");
@@ -245,7 +296,8 @@ bool CommandBatch::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedCh
         }
         else
         {
-            success = ImportFromFile(full_path);
+            bus.AddDependency(full_path);
+            success = ImportFromFile(full_path, bus);
         }
     }
     else
@@ -23,6 +23,7 @@
 #include "../application_bus.h"
 
 #include <map>
+#include <mutex>
 #include <filesystem>
 
 class CommandBatch : public IApplication {
@@ -35,17 +36,32 @@ public:
 	std::vector<std::string> AcceptedCmdName() override;
 
     bool CheckArgs(const Command& cmd) override;
+    bool IsDefinition(const Command& cmd) const override;
 
-    bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart) override;
+    bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus) override;
 
 private:
     std::map<std::string, CommandMap> batch_map;
 
+    /// 一个batch文件编译后的全部定义
+    struct CompiledLibrary
+    {
+        std::filesystem::file_time_type mtime;
+        std::vector<std::pair<std::string, CommandMap>> batches;
+    };
+    /// 编译过的batch文件，进程内的所有ApplicationBus共享。文件修改后失效
+    inline static std::mutex library_mutex;
+    inline static std::map<std::string, CompiledLibrary> library_cache;
+
+    /// 文件未修改时，直接载入之前编译的定义
+    bool LoadCachedLibrary(const std::string& path, std::filesystem::file_time_type mtime);
+    void StoreCachedLibrary(const std::string& path, CompiledLibrary&& library);
+
     bool DefineBatch(const std::string& name, const std::string& content,
-                     ApplicationBus::ErrorStack& err_stack);
+                     ApplicationBus::ErrorStack& err_stack, ApplicationBus& bus);
 
     CommandMap LoadBatch(const std::string& name);
 
-    bool ImportFromFile(const std::string& path);
+    bool ImportFromFile(const std::string& path, ApplicationBus& bus);
 
 };
\ No newline at end of file
@@ -35,27 +35,21 @@ std::vector<std::string> CurveKnob::AcceptedCmdName()
         "cl", "curvel", "cr", "curver"};
 }
 
-bool CurveKnob::CheckArgs(const Command& cmd)
+const ArgSchema* CurveKnob::AcceptedArgs() const
 {
     // cl curvetype reverse [mode] [amp(float)]
-    if (cmd.argLength() >= 2 && cmd.argLength() <= 4 && cmd.argIsBool(1))
-    {
-        if (cmd.argLength() == 4)
-        {
-            return cmd.argIsDouble(3);
-        }
-        else
-        {
-            return true;
-        }
-    }
-    else
-    {
-        return false;
-    }
+    static const ArgSchema schema({{"curvetype"}, {"reverse", ArgType::Bool}}, {{"mode"}, {"amp", ArgType::Double}});
+    return &schema;
+}
+
+CmdFootprint CurveKnob::Footprint(const Command& cmd) const
+{
+    // 只读写对应一侧的旋钮
+    Knob knob = (cmd.cmd() == "cl" || cmd.cmd() == "curvel") ? Knob::L : Knob::R;
+    return CmdFootprint{IndexedChart::LanesOf(knob)};
 }
 
-bool CurveKnob::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart)
+bool CurveKnob::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     // STEP 1 判断命令类型
     Knob knob;
@@ -75,31 +69,32 @@ bool CurveKnob::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedC
     // STEP 2 获取信息
     ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
     int start_time = cmd.time();
-    auto& knob_list = chart.KnobList(knob);
-    bool slam = IsSlam(knob_list, start_time);
+    const KnobSegmentIndex& knob_index = chart.KnobSegments(knob);
+    bool slam = knob_index.IsSlam(start_time);
     if (slam)
     {
         start_time += 6;
     }
 
-    auto iter = knob_list.nextItem(start_time);
-    if (iter == knob_list.end())
+    int next_id = knob_index.NextIndex(start_time);
+    if (next_id == knob_index.Size())
     {
         err_collector.ErrorLog(ErrorMessage<ErrorType::ObjectNotFound>());
         return false;
     }
 
-    int end_time = iter->first;
+    const auto& next_point = knob_index.Points()[next_id];
+    int end_time = next_point.time;
 
-    auto iter2 = knob_list.prevItem(start_time);
-    if (iter2 == knob_list.end())
+    int prev_id = knob_index.PrevIndex(start_time);
+    if (prev_id < 0)
     {
         err_collector.ErrorLog(ErrorMessage<ErrorType::ObjectNotFound>());
         return false;
     }
 
-    int start_pos = iter2->second.second();
-    int end_pos = iter->second.first();
+    int start_pos = knob_index.Points()[prev_id].end_val;
+    int end_pos = next_point.start_val;
 
     if (start_pos == -1 || end_pos == -1)
     {
@@ -113,7 +108,7 @@ bool CurveKnob::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedC
     }
 
     int length = end_time - start_time;
-    bool laser2x = IsLaser2x(chart, knob, start_time);
+    bool laser2x = knob_index.IsLaser2x(start_time);
     bool reverse = cmd.argAsBool(1);
 
     string mode = "";
@@ -19,6 +19,7 @@
 */
 
 #include "svfx.h"
+#include "src/misc/keywords.h"
 
 #include <cmath>
 
@@ -104,23 +105,38 @@ namespace SVFX_Core {
 
 /* #endregion */
 
+	enum class SVFXCurveID {
+		Linear, Quad, Sqrt, Sine, Exp
+	};
+
+	// 变速曲线名称
+	constexpr auto kSVFXCurveNames = MakeKeywordTable<SVFXCurveID>({
+		{"l", SVFXCurveID::Linear}, {"linear", SVFXCurveID::Linear},
+		{"p", SVFXCurveID::Quad}, {"parabola", SVFXCurveID::Quad},
+		{"sq", SVFXCurveID::Sqrt}, {"sqrt", SVFXCurveID::Sqrt},
+		{"s", SVFXCurveID::Sine}, {"sine", SVFXCurveID::Sine},
+		{"e", SVFXCurveID::Exp}, {"exp", SVFXCurveID::Exp},
+	});
+
 	unique_ptr<ISVFXFunctor> NewSVFXFunctor(const string& type) {
-		if (type == "l" || type == "linear") {
-			return unique_ptr<ISVFXFunctor>(new SVFXLinear());
+		const SVFXCurveID* curve = kSVFXCurveNames.Find(type);
+		if (curve == nullptr) {
+			return nullptr;
 		}
-		else if (type == "p" || type == "parabola") {
+
+		switch (*curve)
+		{
+		case SVFXCurveID::Linear:
+			return unique_ptr<ISVFXFunctor>(new SVFXLinear());
+		case SVFXCurveID::Quad:
 			return unique_ptr<ISVFXFunctor>(new SVFXQuad());
-		}
-		else if (type == "sq" || type == "sqrt") {
+		case SVFXCurveID::Sqrt:
 			return unique_ptr<ISVFXFunctor>(new SVFXSqrt());
-		}
-		else if (type == "s" || type == "sine") {
+		case SVFXCurveID::Sine:
 			return unique_ptr<ISVFXFunctor>(new SVFXSine());
-		}
-		else if (type == "e" || type == "exp") {
+		case SVFXCurveID::Exp:
 			return unique_ptr<ISVFXFunctor>(new SVFXExp());
-		}
-		else {
+		default:
 			return nullptr;
 		}
 	}
@@ -168,26 +184,22 @@ vector<string> SVFX::AcceptedCmdName()
 	return { "svfx" };
 }
 
-bool SVFX::CheckArgs(const Command& cmd) {
-		// svfx [type] [reverse(bool)] [length(float, ratio)] [div(int)] (BPM(float)) (amp(float))
-		if (cmd.argLength() >= 4 && cmd.argIsBool(1)  &&
-			(cmd.argIsDouble(2) || cmd.argIsRatio(2)) && cmd.argIsInt(3)) {
-			if (cmd.argLength() >= 6) {
-				return cmd.argIsDouble(4) && cmd.argIsDouble(5);
-			}
-			else if (cmd.argLength() == 5) {
-				return cmd.argIsDouble(4);
-			}
-			else {
-				return true;
-			}
-		}
-		else {
-			return false;
-		}
-	}
+const ArgSchema* SVFX::AcceptedArgs() const {
+	// svfx [type] [reverse(bool)] [length(float, ratio)] [div(int)] (amp(float)) (BPM(float))
+	static const ArgSchema schema(
+		{{"type"}, {"reverse", ArgType::Bool}, {"length", ArgType::DoubleOrRatio}, {"div", ArgType::Int}},
+		{{"amp", ArgType::Double}, {"bpm", ArgType::Double}}, true);
+	return &schema;
+}
+
+CmdFootprint SVFX::Footprint(const Command& cmd) const {
+	// 读取节奏表，写入BPM表，作用时长即length
+	CmdFootprint footprint{IndexedChart::TempoLanes()};
+	footprint.span = static_cast<int>(cmd.argAsDoubleOrRatio(2, 48.0));
+	return footprint;
+}
 
-bool SVFX::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart) {
+bool SVFX::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart, ApplicationBus& /*bus*/) {
 	
 	// STEP 1 获取信息
 	ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
@@ -212,8 +224,7 @@ bool SVFX::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart&
 	}
 	else {
 		// 寻找当前bpm
-		auto bpm_list = chart.MarkList(MarkType::BPM);
-		bpm = stod(bpm_list.prevItem(cmd.time())->second.first());
+		bpm = chart.GetTempoMap().BPMAt(cmd.time());
 	}
 
 	// STEP 2 生成数据
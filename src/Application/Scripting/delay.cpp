@@ -26,15 +26,15 @@ using namespace std;
 
 vector<string> Delay::AcceptedCmdName() { return {"delay"}; }
 
-bool Delay::CheckArgs(const Command& cmd)
+const ArgSchema* Delay::AcceptedArgs() const
 {
     // delay [step] [subcmds...]
-    return cmd.argLength() >= 2 && (cmd.argIsDouble(0) || cmd.argIsRatio(0));
+    static const ArgSchema schema({{"step", ArgType::DoubleOrRatio}, {"subcmd"}}, {}, true);
+    return &schema;
 }
 
-bool Delay::Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack)
+bool Delay::Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack, ApplicationBus& bus)
 {
-    ApplicationBus& bus = ApplicationBus::GetInstance();
     ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
 
     // 提取数据
@@ -26,15 +26,15 @@ using namespace std;
 
 vector<string> Looper::AcceptedCmdName() { return {"loop"}; }
 
-bool Looper::CheckArgs(const Command& cmd)
+const ArgSchema* Looper::AcceptedArgs() const
 {
     // loop [count] [step] [subcmd...]
-    return cmd.argLength() >= 3 && cmd.argIsInt(0) && (cmd.argIsDouble(1) || cmd.argIsRatio(1));
+    static const ArgSchema schema({{"count", ArgType::Int}, {"step", ArgType::DoubleOrRatio}, {"subcmd"}}, {}, true);
+    return &schema;
 }
 
-bool Looper::Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack)
+bool Looper::Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack, ApplicationBus& bus)
 {
-    ApplicationBus& bus = ApplicationBus::GetInstance();
     ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
     
     // 提取数据
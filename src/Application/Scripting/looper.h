@@ -31,7 +31,7 @@ public:
 
 	std::vector<std::string> AcceptedCmdName() override;
 
-    bool CheckArgs(const Command& cmd) override;
+    const ArgSchema* AcceptedArgs() const override;
 
-	bool Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack) override;
+	bool Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack, ApplicationBus& bus) override;
 };
\ No newline at end of file
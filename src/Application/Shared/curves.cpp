@@ -19,38 +19,58 @@
 */
 
 #include "curves.h"
+#include "src/misc/keywords.h"
 
 using namespace std;
 
+namespace {
+
+enum class CurveID {
+	Sqr1, Sqr2, Cubic1, Cubic2, SmoothLinear1, SmoothLinear2, Sine, Exp, Polynomial
+};
+
+// 曲线名称
+constexpr auto kCurveNames = MakeKeywordTable<CurveID>({
+	{"p", CurveID::Sqr1}, {"p1", CurveID::Sqr1}, {"parabola", CurveID::Sqr1},
+	{"p2", CurveID::Sqr2}, {"parabola2", CurveID::Sqr2},
+	{"c", CurveID::Cubic1}, {"c1", CurveID::Cubic1}, {"cubic", CurveID::Cubic1},
+	{"c2", CurveID::Cubic2}, {"cubic2", CurveID::Cubic2},
+	{"sl", CurveID::SmoothLinear1}, {"sl1", CurveID::SmoothLinear1}, {"smoothlinear", CurveID::SmoothLinear1},
+	{"sl2", CurveID::SmoothLinear2}, {"smoothlinear2", CurveID::SmoothLinear2},
+	{"s", CurveID::Sine}, {"sin", CurveID::Sine}, {"sine", CurveID::Sine},
+	{"e", CurveID::Exp}, {"exp", CurveID::Exp}, {"exponential", CurveID::Exp},
+	{"xn", CurveID::Polynomial}, {"polynomial", CurveID::Polynomial},
+});
+
+}
+
 std::unique_ptr<ICurveFunctor> NewCurveFunctor(const std::string& type) {
-	if (type == "p" || type == "p1" || type == "parabola") {
-		return std::unique_ptr<ICurveFunctor>(new SqrType1());
+	const CurveID* curve = kCurveNames.Find(type);
+	if (curve == nullptr) {
+		return nullptr;
 	}
-	else if (type == "p2" || type == "parabola2") {
+
+	switch (*curve)
+	{
+	case CurveID::Sqr1:
+		return std::unique_ptr<ICurveFunctor>(new SqrType1());
+	case CurveID::Sqr2:
 		return std::unique_ptr<ICurveFunctor>(new SqrType2());
-	}
-	else if (type == "c" || type == "c1" || type == "cubic") {
+	case CurveID::Cubic1:
 		return std::unique_ptr<ICurveFunctor>(new CubicType1());
-	}
-	else if (type == "c2" || type == "cubic2") {
+	case CurveID::Cubic2:
 		return std::unique_ptr<ICurveFunctor>(new CubicType2());
-	}
-	else if (type == "sl" || type == "sl1" || type == "smoothlinear") {
+	case CurveID::SmoothLinear1:
 		return std::unique_ptr<ICurveFunctor>(new SmoothenedLinearType1());
-	}
-	else if (type == "sl2" || type == "smoothlinear2") {
+	case CurveID::SmoothLinear2:
 		return std::unique_ptr<ICurveFunctor>(new SmoothenedLinearType2());
-	}
-	else if (type == "s" || type == "sin" || type == "sine") {
+	case CurveID::Sine:
 		return std::unique_ptr<ICurveFunctor>(new Sine());
-	}
-	else if (type == "e" || type == "exp" || type == "exponential") {
+	case CurveID::Exp:
 		return std::unique_ptr<ICurveFunctor>(new Exp());
-	}
-	else if (type == "xn" || type == "polynomial") {
+	case CurveID::Polynomial:
 		return std::unique_ptr<ICurveFunctor>(new Polynomial());
-	}
-	else {
+	default:
 		return nullptr;
 	}
 }
\ No newline at end of file
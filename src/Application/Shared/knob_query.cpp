@@ -20,22 +20,12 @@
 
 #include "knob_query.h"
 
-bool IsSlam(IndexedChart& chart, Knob knob, int time)
+bool IsSlam(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (!lst.hasKey(time))
-    {
-        return false;
-    }
-    else
-    {
-        int start_val = lst.startVal(time);
-        int end_val = lst.endVal(time);
-        return start_val != end_val && start_val != -1 && end_val != -1;
-    }
+    return chart.KnobSegments(knob).IsSlam(time);
 }
 
-bool IsSlam(IndexList<int>& knob_list, int time)
+bool IsSlam(const IndexList<int>& knob_list, int time)
 {
     if (!knob_list.hasKey(time))
     {
@@ -59,6 +49,11 @@ bool IsSlam(const IndexList<double>::Iterator& iter)
     return (iter->second.first() != iter->second.second() && iter->second.second() != -1);
 }
 
+bool IsSlam(const IndexList<double>::ConstIterator& iter)
+{
+    return (iter->second.first() != iter->second.second() && iter->second.second() != -1);
+}
+
 bool IsSlamToVoid(const IndexList<int>::Iterator& iter)
 {
     auto next = iter;
@@ -81,124 +76,49 @@ bool IsSlamToVoid(const IndexList<double>::Iterator& iter)
     );
 }
 
-bool IsStart(IndexedChart& chart, Knob knob, int time)
+bool IsSlamToVoid(const IndexList<double>::ConstIterator& iter)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (!lst.hasKey(time))
-    {
-        return false;
-    }
-    else
-    {
-        auto iter = lst.prevItem(time - 1);
-        return (iter == lst.end() || iter->second.second() == -1);
-    }
+    auto next = iter;
+    ++next;
+
+    return (iter->second.first() != iter->second.second() && next->second.first() != next->second.second() &&
+            next->second.first() == iter->second.second() &&
+            next->second.second() == -1 && next->first - iter->first <= 6  // 时间差小于1/8拍
+    );
 }
 
-bool IsNormalEnd(IndexedChart& chart, Knob knob, int time)
+bool IsStart(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (!lst.hasKey(time))
-    {
-        return false;
-    }
-    else
-    {
-        auto& val = lst.getVal(time);
-        return val.second() == -1;
-    }
+    return chart.KnobSegments(knob).IsStart(time);
 }
 
-/// @brief 查询特定时刻是否是旋钮的结束点（包括直角结束）
-bool IsEnd(IndexedChart& chart, Knob knob, int time)
+bool IsNormalEnd(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    auto iter = lst.find(time);
-    if (!lst.hasKey(time))
-    {
-        return false;
-    }
-    // 通常结束
-    else if (iter->second.second() == -1)
-    {
-        return true;
-    }
-    // 直角结束
-    else
-    {
-        return IsSlamToVoid(lst.find(time));
-    }
+    return chart.KnobSegments(knob).IsNormalEnd(time);
 }
 
-bool ExistsSlam(IndexedChart& chart, Knob knob, int start, int end)
+/// @brief 查询特定时刻是否是旋钮的结束点（包括直角结束）
+bool IsEnd(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    auto iter = lst.nextItem(start - 1);
-    while (iter != lst.end() && iter->first <= end)
-    {
-        if (iter->second.first() != iter->second.second() && iter->second.first() != -1 && iter->second.second() != -1)
-        {
-            return true;
-        }
-        ++iter;
-    }
-
-    return false;
+    return chart.KnobSegments(knob).IsEnd(time);
 }
 
-int LastSlam(IndexedChart& chart, Knob knob, int time)
+bool ExistsSlam(const IndexedChart& chart, Knob knob, int start, int end)
 {
-    int output = -1;
-    IndexList<int>& lst = chart.KnobList(knob);
-    auto iter = lst.prevItem(time);
-    while (iter != lst.end())
-    {
-        if (iter->second.first() != iter->second.second() && iter->second.first() != -1 && iter->second.second() != -1)
-        {
-            output = iter->first;
-            break;
-        }
-
-        --iter;
-    }
-
-    return output;
+    return chart.KnobSegments(knob).ExistsSlam(start, end);
 }
 
-bool IsLaser2x(IndexedChart& chart, Knob knob, int time)
+int LastSlam(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& knob_list = chart.KnobList(knob);
-    auto iter = knob_list.prevItem(time + 1);
-    if (iter == knob_list.end())
-    {
-        return false;
-    }
-
-    // 找到旋钮起始点
-    while (iter->second.second() != -1 && iter != knob_list.begin())
-    {
-        --iter;
-    }
-    // 如果旋钮表开头是个旋钮起点就不用加，否则加
-    if (!(iter == knob_list.begin() && iter->second.second() != -1))
-    {
-        ++iter;
-    }
+    return chart.KnobSegments(knob).LastSlam(time);
+}
 
-    // 查是否有2x标记
-    int query_time = iter->first;
-    auto& laser2x_list = chart.MarkList(MarkType::Laser2x, ToSide(knob));
-    if (laser2x_list.hasKey(query_time))
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+bool IsLaser2x(const IndexedChart& chart, Knob knob, int time)
+{
+    return chart.KnobSegments(knob).IsLaser2x(time);
 }
 
-static double InterpolateKnobPos(IndexList<int>& lst, int time)
+static double InterpolateKnobPos(const IndexList<int>& lst, int time)
 {
     auto prev_iter = lst.prevItem(time);
     if (prev_iter != lst.end())
@@ -236,9 +156,9 @@ static double InterpolateKnobPos(IndexList<int>& lst, int time)
     }
 }
 
-double KnobStartPos(IndexedChart& chart, Knob knob, int time)
+double KnobStartPos(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
+    const IndexList<int>& lst = chart.KnobList(knob);
     // 恰好有一个记录
     if (lst.hasKey(time))
     {
@@ -267,9 +187,9 @@ double KnobStartPos(IndexedChart& chart, Knob knob, int time)
     }
 }
 
-double KnobEndPos(IndexedChart& chart, Knob knob, int time)
+double KnobEndPos(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
+    const IndexList<int>& lst = chart.KnobList(knob);
     // 恰好有一个记录
     if (lst.hasKey(time))
     {
@@ -299,92 +219,17 @@ double KnobEndPos(IndexedChart& chart, Knob knob, int time)
     }
 }
 
-std::pair<int, double> NextStartPos(IndexedChart& chart, Knob knob, int time)
+std::pair<int, double> NextStartPos(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (lst.size() == 0)
-    {
-        return {-1, -1};
-    }
-    auto iter = lst.nextItem(time - 1);
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-    if (iter == lst.begin())
-    {
-        return {iter->first, iter->second.first()};
-    }
-    --iter;
-    while (iter != lst.end() && iter->second.first() != -1)
-    {
-        ++iter;
-    }
-    if (iter != lst.end())
-    {
-        ++iter;
-    }
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-    return {iter->first, iter->second.first()};
+    return chart.KnobSegments(knob).NextStartPos(time);
 }
 
-std::pair<int, double> LastEndPos(IndexedChart& chart, Knob knob, int time)
+std::pair<int, double> LastEndPos(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (lst.size() == 0)
-    {
-        return {-1, -1};
-    }
-    auto iter = lst.prevItem(time);
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-    while (iter != lst.begin() && (iter->second.second() != -1 || iter->second.first() == -1))
-    {
-        --iter;
-    }
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-    return {iter->first, iter->second.first()};
+    return chart.KnobSegments(knob).LastEndPos(time);
 }
 
-std::pair<int, double> LastEndPos_BeforeSlam(IndexedChart& chart, Knob knob, int time)
+std::pair<int, double> LastEndPos_BeforeSlam(const IndexedChart& chart, Knob knob, int time)
 {
-    IndexList<int>& lst = chart.KnobList(knob);
-    if (lst.size() == 0)
-    {
-        return {-1, -1};
-    }
-    auto iter = lst.prevItem(time);
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-    while (iter != lst.begin() && (iter->second.second() != -1 || iter->second.first() == -1))
-    {
-        --iter;
-    }
-
-    if (iter == lst.end())
-    {
-        return {-1, -1};
-    }
-
-    if (IsSlam(chart, knob, iter->first - 6))
-    {
-        --iter;
-    }
-
-    return {iter->first, iter->second.first()};
+    return chart.KnobSegments(knob).LastEndPos_BeforeSlam(time);
 }
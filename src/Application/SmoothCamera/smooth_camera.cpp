@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "src/misc/enums.h"
+#include "src/misc/keywords.h"
 #include "src/misc/utilities.h"
 #include "../Shared/curve_generator.h"
 
@@ -36,25 +37,24 @@ namespace SmoothCamera_Core {
 		Additive
 	};
 
+	// 命令词对应的标记类型
+	constexpr auto kCmdMarkTypes = MakeKeywordTable<MarkType>({
+		{"zt", MarkType::ZoomTop},
+		{"zoomtop", MarkType::ZoomTop},
+		{"ztauto", MarkType::ZoomTop},
+		{"zb", MarkType::ZoomBottom},
+		{"zoombottom", MarkType::ZoomBottom},
+		{"zbauto", MarkType::ZoomBottom},
+		{"zs", MarkType::ZoomSide},
+		{"zoomside", MarkType::ZoomSide},
+		{"zsauto", MarkType::ZoomSide},
+		{"tilt", MarkType::Tilt},
+		{"tiltauto", MarkType::Tilt},
+		{"split", MarkType::LaneSplit},
+	});
+
 	MarkType CmdMarkType(const std::string& str) {
-		if (str == "zt" || str == "zoomtop" || str == "ztauto") {
-			return MarkType::ZoomTop;
-		}
-		else if (str == "zb" || str == "zoombottom" || str == "zbauto") {
-			return MarkType::ZoomBottom;
-		}
-		else if (str == "zs" || str == "zoomside" || str == "zsauto") {
-			return MarkType::ZoomSide;
-		}
-		else if (str == "tilt" || str == "tiltauto") {
-			return MarkType::Tilt;
-		}
-		else if (str == "split") {
-			return MarkType::LaneSplit;
-		}
-		else {
-			return MarkType::Error;
-		}
+		return kCmdMarkTypes.Get(str, MarkType::Error);
 	}
 
 }
@@ -70,22 +70,20 @@ vector<string> SmoothCamera::AcceptedCmdName(){
 	};
 }
 
-bool SmoothCamera::CheckArgs(const Command& cmd){
+const ArgSchema* SmoothCamera::AcceptedArgs() const {
 	// zt [curvetype] [reverse(bool)] [divisor(int)] (amp(double))
-		if (cmd.argLength() >= 3 && cmd.argIsBool(1) && cmd.argIsInt(2)) {
-			if (cmd.argLength() == 4) {
-				return cmd.argIsDouble(3);
-			}
-			else {
-				return true;
-			}
-		}
-		else {
-			return false;
-		}
+	static const ArgSchema schema(
+		{{"curvetype"}, {"reverse", ArgType::Bool}, {"divisor", ArgType::Int}},
+		{{"amp", ArgType::Double}}, true);
+	return &schema;
+}
+
+CmdFootprint SmoothCamera::Footprint(const Command& cmd) const {
+	// 只读写对应的镜头标记表
+	return CmdFootprint{IndexedChart::LanesOf(core::CmdMarkType(cmd.cmd()))};
 }
 
-bool SmoothCamera::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart) {
+bool SmoothCamera::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart, ApplicationBus& /*bus*/) {
 
 		// STEP 1 判断类型
 		MarkType mark_type = core::CmdMarkType(cmd.cmd());
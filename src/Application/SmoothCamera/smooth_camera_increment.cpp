@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "src/misc/enums.h"
+#include "src/misc/keywords.h"
 #include "src/misc/utilities.h"
 #include "../Shared/curve_generator.h"
 
@@ -40,32 +41,18 @@ enum class ProcessType
 
 /* #region assist func */
 
+// 命令词对应的标记类型
+constexpr auto kCmdMarkTypes = MakeKeywordTable<MarkType>({
+    {"ztadd", MarkType::ZoomTop},
+    {"zbadd", MarkType::ZoomBottom},
+    {"zsadd", MarkType::ZoomSide},
+    {"tiltadd", MarkType::Tilt},
+    {"splitadd", MarkType::LaneSplit},
+});
+
 MarkType CmdMarkType(const std::string& str)
 {
-    if (str == "ztadd")
-    {
-        return MarkType::ZoomTop;
-    }
-    else if (str == "zbadd")
-    {
-        return MarkType::ZoomBottom;
-    }
-    else if (str == "zsadd")
-    {
-        return MarkType::ZoomSide;
-    }
-    else if (str == "tiltadd")
-    {
-        return MarkType::Tilt;
-    }
-    else if (str == "splitadd")
-    {
-        return MarkType::LaneSplit;
-    }
-    else
-    {
-        return MarkType::Error;
-    }
+    return kCmdMarkTypes.Get(str, MarkType::Error);
 }
 
 /* #endregion */
@@ -80,27 +67,22 @@ vector<string> SmoothCameraIncrement::AcceptedCmdName()
         "ztadd", "zbadd", "zsadd", "tiltadd", "splitadd"};
 }
 
-bool SmoothCameraIncrement::CheckArgs(const Command& cmd)
+const ArgSchema* SmoothCameraIncrement::AcceptedArgs() const
 {
     // ztadd [mode] [length(float, ratio)] [divisor(int)] [offset(float)] (curvetype) (amp(double))
-    if (cmd.argLength() >= 4 && cmd.argIsInt(2) && cmd.argIsDouble(3) && (cmd.argIsDouble(1) || cmd.argIsRatio(1)))
-    {
-        if (cmd.argLength() == 6)
-        {
-            return cmd.argIsDouble(5);
-        }
-        else
-        {
-            return true;
-        }
-    }
-    else
-    {
-        return false;
-    }
+    static const ArgSchema schema(
+        {{"mode"}, {"length", ArgType::DoubleOrRatio}, {"divisor", ArgType::Int}, {"offset", ArgType::Double}},
+        {{"curvetype"}, {"amp", ArgType::Double}}, true);
+    return &schema;
+}
+
+CmdFootprint SmoothCameraIncrement::Footprint(const Command& cmd) const
+{
+    // 只读写对应的镜头标记表
+    return CmdFootprint{IndexedChart::LanesOf(core::CmdMarkType(cmd.cmd()))};
 }
 
-bool SmoothCameraIncrement::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart)
+bool SmoothCameraIncrement::ProcessCmd(const Command& cmd, CommandMap& /*cmd_map*/, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     // STEP 1 判断类型
     MarkType mark_type = core::CmdMarkType(cmd.cmd());
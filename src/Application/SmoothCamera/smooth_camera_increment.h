@@ -31,7 +31,9 @@ public:
 
 	std::vector<std::string> AcceptedCmdName() override;
 
-    bool CheckArgs(const Command& cmd) override;
+    const ArgSchema* AcceptedArgs() const override;
 
-    bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart) override;
+    CmdFootprint Footprint(const Command& cmd) const override;
+
+    bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus) override;
 };
\ No newline at end of file
@@ -180,13 +180,20 @@ namespace core = Swing_Core;
 
 vector<string> Swing::AcceptedCmdName() { return {"swing"}; }
 
-bool Swing::CheckArgs(const Command& cmd)
+const ArgSchema* Swing::AcceptedArgs() const
 {
     // swing [target_div(int)] [delay(double / ratio)]
-    return cmd.argLength() == 2 && cmd.argIsInt(0) && (cmd.argIsDouble(1) || cmd.argIsRatio(1));
+    static const ArgSchema schema({{"target_div", ArgType::Int}, {"delay", ArgType::DoubleOrRatio}});
+    return &schema;
 }
 
-bool Swing::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+CmdFootprint Swing::Footprint(const Command& /*cmd*/) const
+{
+    // 作用到成对的结束命令为止
+    return CmdFootprint::ExclusiveUntilEnd();
+}
+
+bool Swing::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     // STEP 1 获取信息
     ErrorCollector& err_collector = GET_ERROR_COLLECTOR;
@@ -211,7 +218,7 @@ bool Swing::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& ch
     }
 
     int ref_beat = 0;
-    auto time_sig_list = chart.MarkList(MarkType::TimeSignature);
+    const auto& time_sig_list = chart.MarkList(MarkType::TimeSignature);
     auto iter = time_sig_list.prevItem(start_time);
     if (iter != time_sig_list.end())
     {
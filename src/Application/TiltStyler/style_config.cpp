@@ -91,7 +91,7 @@ void StyleConfig::ConfigFromStr(const vector<string>& conf, bool with_style)
 }
 
 IndexList<double> TiltStyler_Core::MakeTiltGuide(
-    IndexedChart& chart, int start, int end, std::map<int, StyleConfig>& func_map)
+    const IndexedChart& chart, int start, int end, std::map<int, StyleConfig>& func_map)
 {
     IndexList<double> output;
 
@@ -123,25 +123,27 @@ IndexList<double> TiltStyler_Core::MakeTiltGuide(
 
         StyleConfig& config = iter->second;
 
-        // 获取旋钮位置
-        IndexList<double> knob_left, knob_right;
+        // 获取旋钮位置。外扩的位置表由谱面缓存，不需要复制
+        IndexList<double> converted_left, converted_right;
+        const IndexList<double>* knob_left = &converted_left;
+        const IndexList<double>* knob_right = &converted_right;
 
         if (config.laser2x_extend)
         {
-            knob_left = chart.KnobPosList(Knob::L);
-            knob_right = chart.KnobPosList(Knob::R);
+            knob_left = &chart.KnobPosList(Knob::L);
+            knob_right = &chart.KnobPosList(Knob::R);
         }
         else
         {
-            knob_left = chart.KnobList(Knob::L);
-            knob_right = chart.KnobList(Knob::R);
+            converted_left = chart.KnobList(Knob::L);
+            converted_right = chart.KnobList(Knob::R);
         }
 
         // 生成各段的tiltguide
         IndexList<double> tilt_left = config.zero_left ? IndexList<double>() : 
-            MakeTiltGuide(knob_left, start_time, end_time, *config.pleft);
+            MakeTiltGuide(*knob_left, start_time, end_time, *config.pleft);
         IndexList<double> tilt_right = config.zero_right ? IndexList<double>() : 
-            MakeTiltGuide(knob_right, start_time, end_time, *config.pright);
+            MakeTiltGuide(*knob_right, start_time, end_time, *config.pright);
 
         IndexList<double> tilt_guide = MergeTiltGuide(tilt_left, tilt_right);
         tilt_guide = tilt_guide.clamp(start_time, end_time);
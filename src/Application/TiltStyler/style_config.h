@@ -41,7 +41,7 @@ public:
     void ConfigFromStr(const std::vector<std::string>& conf, bool with_style = false);
 };
 
-IndexList<double> MakeTiltGuide(IndexedChart& chart, int start, int end,
+IndexList<double> MakeTiltGuide(const IndexedChart& chart, int start, int end,
         std::map<int, StyleConfig>& func_map);
 
 }  // namespace TiltStyler_Core
\ No newline at end of file
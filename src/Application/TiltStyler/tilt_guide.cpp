@@ -121,7 +121,7 @@ IndexList<double> MergeTiltGuide(IndexList<double>& a, IndexList<double>& b)
     return output;
 }
 
-IndexList<double> MakeTiltGuide(IndexList<double>& knob, int start, int end, ITiltPos& tilt_func)
+IndexList<double> MakeTiltGuide(const IndexList<double>& knob, int start, int end, ITiltPos& tilt_func)
 {
     IndexList<double> output;
 
@@ -32,7 +32,7 @@ void RegulateTiltGuide(IndexList<double> &guide);
 IndexList<double> MergeTiltGuide(IndexList<double> &a, IndexList<double> &b);
 
 
-IndexList<double> MakeTiltGuide(IndexList<double> &knob, int start, int end,
+IndexList<double> MakeTiltGuide(const IndexList<double> &knob, int start, int end,
                                 ITiltPos &tilt_func);
 
 } // namespace TiltStyler_Core
\ No newline at end of file
@@ -56,10 +56,17 @@ namespace core = TiltStyler_Core;
 
 vector<string> TiltStyler::AcceptedCmdName() { return {"tiltstyle"}; }
 
-bool TiltStyler::CheckArgs(const Command& cmd)
+const ArgSchema* TiltStyler::AcceptedArgs() const
 {
     // tiltstyle [style] ([amp])
-    return cmd.argLength() >= 1;
+    static const ArgSchema schema({{"style"}}, {{"amp"}}, true);
+    return &schema;
+}
+
+CmdFootprint TiltStyler::Footprint(const Command& /*cmd*/) const
+{
+    // 作用到成对的结束命令为止
+    return CmdFootprint::ExclusiveUntilEnd();
 }
 
 void TiltStyler::RegisterTiltStyleCmd(const Command& cmd, bool with_style)
@@ -88,7 +95,7 @@ void TiltStyler::RegisterTiltStyleCmd(const Command& cmd, bool with_style)
     style_map.insert_or_assign(cmd.time(), std::move(config));
 }
 
-bool TiltStyler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool TiltStyler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& /*bus*/)
 {
     style_map.clear();
     // 起始和结束时间
@@ -111,19 +118,15 @@ bool TiltStyler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChar
     // 登记首个tiltstyle命令
     RegisterTiltStyleCmd(cmd, true);
     // 将这中间所有的tiltstyle命令登记到表中
-    auto cmd_iter = cmd_map.upper_bound(start_time);
-    while (cmd_iter != end_cmd)
+    CommandMap::Position after_start(start_time, UINT64_MAX);
+    for (auto cmd_iter : cmd_map.CommandsOfWord("tiltstyle", after_start, cmd_map.PositionOf(end_cmd)))
     {
         const Command& the_cmd = cmd_iter->second;
-        if (the_cmd.matchesType("tiltstyle") && CheckArgs(the_cmd) && cmd.delay() == delay)
+        if (CheckArgs(the_cmd) && cmd.delay() == delay)
         {
             this->RegisterTiltStyleCmd(the_cmd);
             cmd_map.erase(cmd_iter);
         }
-        else
-        {
-            ++cmd_iter;
-        }
     }
 
     if(style_map.begin()->second.styler == nullptr)
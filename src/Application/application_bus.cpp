@@ -20,11 +20,20 @@
 
 #include "application_bus.h"
 
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <sstream>
+#include <utility>
+
+#include "execution_record.h"
+
 using namespace std;
 
 /* #region IApplication & ICompiler */
 
-inline bool IApplication::ExecuteCommand(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+inline bool IApplication::ExecuteCommand(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart,
+                                         ApplicationBus& bus)
 {
 #ifdef DEBUG
     auto accepted_cmd_name = this->AcceptedCmdName();
@@ -36,16 +45,22 @@ inline bool IApplication::ExecuteCommand(const Command& cmd, CommandMap& cmd_map
     }
 #endif
 
-    return ProcessCmd(cmd, cmd_map, chart);
+    return ProcessCmd(cmd, cmd_map, chart, bus);
+}
+
+bool IApplication::CheckArgs(const Command& cmd)
+{
+    const ArgSchema* schema = this->AcceptedArgs();
+    return schema != nullptr && schema->Check(cmd);
 }
 
-bool ICompiler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart)
+bool ICompiler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus)
 {
     CommandMap lambda_batch;
     ErrorStack err_stack;
 
     // COMPILE
-    bool success = Compile(cmd, lambda_batch, err_stack);
+    bool success = Compile(cmd, lambda_batch, err_stack, bus);
     if (!err_stack.empty())
     {
         std::string all_invalid_cmds = "";
@@ -61,7 +76,7 @@ bool ICompiler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart
     // EXECUTE
     auto& err_collector = GET_ERROR_COLLECTOR;
     err_collector.AddToStack(cmd.toOriginalString());
-    ApplicationBus::GetInstance().ExecuteBatch(lambda_batch);
+    bus.ExecuteBatch(lambda_batch);
     err_collector.PopStack();
 
     return success;
@@ -86,9 +101,11 @@ bool ICompiler::ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart
 #include "Swing/swing.h"
 #include "TiltStyler/tilt_styler.h"
 
-#define REGISTER_UTILS(name) this->app_list.push_back(std::make_shared<name>())
+/* #region Plugin Registry */
 
-void ApplicationBus::RegisterAllApplications()
+#define REGISTER_UTILS(name) this->factories.push_back([] { return std::make_shared<name>(); })
+
+void PluginRegistry::RegisterAllApplications()
 {
     // REGISTER_UTILS(...)
     REGISTER_UTILS(CurveKnob);
@@ -111,196 +128,695 @@ void ApplicationBus::RegisterAllApplications()
     return;
 }
 
-ApplicationBus::ApplicationBus()
+PluginRegistry::PluginRegistry()
 {
     RegisterAllApplications();
-    InitializeDispatchMap();
-    InitializeCompilerMap();
+    // 命令词等元数据从一套临时实例中读取
+    auto apps = this->Instantiate();
+    InitializeDispatchMap(apps);
+    InitializeCompilerMap(apps);
 }
 
-TimeInfo ApplicationBus::ToTimeInfo(int time_number)
+const PluginRegistry& PluginRegistry::Default()
 {
-    int measure_id = this->chart_.MeasureIDAtTime(time_number);
-    const auto& measure = this->chart_[measure_id];
-    // 如果Chart中的小节数量不足，那么根据最后一小节的拍号顺延。
-    int measure_size = measure.TotalTimespan();
-    int local_time = time_number - measure.StartTime();
-    measure_id += local_time / measure_size;
-    local_time = local_time % measure_size;
-    int gcd = std::gcd(local_time, 48);
-    int denom = local_time == 0 ? 4 : 192 / gcd;
-
-    TimeInfo output;
-    output.measure = measure_id;
-    output.entry_numer = local_time / gcd;
-    output.entry_denom = denom;
+    static const PluginRegistry registry;
+    return registry;
+}
 
-    return output;
+std::vector<std::shared_ptr<IApplication>> PluginRegistry::Instantiate() const
+{
+    std::vector<std::shared_ptr<IApplication>> apps;
+    for (auto& factory : this->factories)
+    {
+        apps.push_back(factory());
+    }
+    return apps;
 }
 
-void ApplicationBus::InitializeDispatchMap()
+void PluginRegistry::InitializeDispatchMap(const std::vector<std::shared_ptr<IApplication>>& apps)
 {
-    this->app_dispatch_map.insert({"__DEFAULT__", {/*empty vector*/}});
-    for (auto& app : this->app_list)
+    this->dispatch_map.insert({"__DEFAULT__", kDefaultDispatch});
+    this->dispatch_table.push_back({/*empty vector*/});
+    int app_count = static_cast<int>(apps.size());
+    for (int app_id = 0; app_id < app_count; ++app_id)
     {
-        vector<string> cmd_names = app->AcceptedCmdName();
+        vector<string> cmd_names = apps[app_id]->AcceptedCmdName();
         if (!cmd_names.empty())
         {
             for (string name : cmd_names)
             {
                 // new command
-                if (this->app_dispatch_map.find(name) == this->app_dispatch_map.end())
+                if (this->dispatch_map.find(name) == this->dispatch_map.end())
                 {
-                    this->app_dispatch_map.insert({name, {/*empty vector*/}});
+                    this->dispatch_map.insert({name, static_cast<int>(this->dispatch_table.size())});
+                    this->dispatch_table.push_back({/*empty vector*/});
                 }
 
-                this->app_dispatch_map[name].push_back(app);
+                this->dispatch_table[this->dispatch_map[name]].push_back(app_id);
             }
         }
         else
         {
-            this->app_dispatch_map["__DEFAULT__"].push_back(app);
+            this->dispatch_table[kDefaultDispatch].push_back(app_id);
         }
     }
 }
 
-void ApplicationBus::InitializeCompilerMap()
+void PluginRegistry::InitializeCompilerMap(const std::vector<std::shared_ptr<IApplication>>& apps)
 {
-    for (auto& app : this->app_list)
+    int app_count = static_cast<int>(apps.size());
+    for (int app_id = 0; app_id < app_count; ++app_id)
     {
-        if (app->type() == ApplicationType::Scripting)
+        if (apps[app_id]->type() == ApplicationType::Scripting)
         {
-            vector<string> cmd_names = app->AcceptedCmdName();
+            vector<string> cmd_names = apps[app_id]->AcceptedCmdName();
             if (!cmd_names.empty())
             {
                 for (string name : cmd_names)
                 {
-                    // new command
-                    if (this->script_compile_map.find(name) == this->script_compile_map.end())
-                    {
-                        this->script_compile_map.insert({name, {/*empty vector*/}});
-                    }
-
-                    this->script_compile_map[name].push_back(std::reinterpret_pointer_cast<ICompiler>(app));
+                    this->compile_map[name].push_back(app_id);
                 }
             }
         }
     }
 }
 
+/* #endregion Plugin Registry */
+
+ApplicationBus::ApplicationBus(const PathManager& paths, const PluginRegistry& registry)
+    : registry(registry), app_list(registry.Instantiate()), path_manager(paths),
+      worker_count(1)
+{
+    // 日志中的小节位置按当前谱面换算
+    this->err_collector.SetMeasureGrid(&this->chart_.Grid());
+}
+
 void ApplicationBus::RunCommands()
 {
-    // 获取注释表
-    auto& comment_list = this->ic_.CommentList();
+    this->RunCommands(nullptr, nullptr, nullptr);
+}
 
-    CommandMap cmd_map(comment_list);
-    CommandMap failed_map;  // 执行不了的东西
+int ApplicationBus::RunCommandsIncremental(const ExecutionRecord& previous, const IndexedChart& previous_output,
+                                           ExecutionRecord& record)
+{
+    return this->RunCommands(&previous, &previous_output, &record);
+}
 
-    unsigned int current_delay = 0, next_delay = UINT32_MAX;
-    while (!cmd_map.Empty())
+/// 是否为结束命令（end xxx）
+static bool IsEndCommand(const Command& command)
+{
+    return command.cmd().compare(0, 4, "end ") == 0;
+}
+
+CmdFootprint ApplicationBus::ExpandedFootprint(int time, const Command& command)
+{
+    if (this->registry.Compilers(command.cmd()) == nullptr)
+    {
+        return this->CommandFootprint(command);
+    }
+
+    // 展开时的报错在执行时还会出现，这里不记录
+    ErrorCollector* outer_collector = local_collector;
+    ErrorCollector scratch;
+    local_collector = &scratch;
+    CommandMap single;
+    single.insert(time, command);
+    ErrorStack err_stack;
+    CommandMap expanded = this->Compile(single, err_stack);
+    local_collector = outer_collector;
+
+    if (!err_stack.empty())
     {
-        for (auto iter = cmd_map.begin(); iter != cmd_map.end();)
+        return CmdFootprint::Exclusive();
+    }
+    CmdFootprint footprint;
+    footprint.span = 0;
+    for (auto& [sub_time, sub_command] : expanded)
+    {
+        // 子命令的时长从根命令的时刻算起
+        CmdFootprint sub_footprint = this->CommandFootprint(sub_command);
+        if (sub_footprint.span >= 0)
         {
-            Command command = iter->second;
-            // 延迟判断
-            if (command.delay() > current_delay)
+            sub_footprint.span += sub_time - time;
+        }
+        footprint |= sub_footprint;
+    }
+    return footprint;
+}
+
+int ApplicationBus::SkipUnchangedCommands(CommandMap& cmd_map, CommandMap& failed_map, const ExecutionRecord& previous,
+                                          const IndexedChart* previous_output, ExecutionRecord& record,
+                                          IndexedChart::LaneSet& reused_lanes)
+{
+    using LaneSet = IndexedChart::LaneSet;
+    constexpr int kLaneCount = ExecutionRecord::kLaneCount;
+    // 命令本身在注释表中，由各表的命令记录代替。失败的命令单独记录
+    const LaneSet comment_lanes = IndexedChart::CommentLanes();
+    const LaneSet chart_lanes = ~comment_lanes;
+
+    // 访问同一个表的命令可能互相影响，用并查集把它们访问的表连成组
+    std::array<int, kLaneCount> group;
+    std::iota(group.begin(), group.end(), 0);
+    auto find_group = [&group](int lane) {
+        while (group[lane] != lane)
+        {
+            lane = group[lane] = group[group[lane]];
+        }
+        return lane;
+    };
+
+    std::array<uint64_t, kLaneCount> command_hash;
+    command_hash.fill(kHashSeed);
+    // 根命令、访问的表和成对的结束命令
+    struct Candidate
+    {
+        CommandMap::Iterator iter;
+        LaneSet lanes;
+        CommandMap::Iterator end_iter;
+    };
+    std::vector<Candidate> candidates;
+    for (auto iter = cmd_map.begin(); iter != cmd_map.end(); ++iter)
+    {
+        CmdFootprint footprint = this->ExpandedFootprint(iter->first, iter->second);
+        // 独占的命令视为访问除注释以外的所有表。注释表每次都重新生成，算进去的话这类命令永远不能复用
+        LaneSet lanes = footprint.exclusive ? chart_lanes : footprint.lanes;
+
+        // 作用到结束命令为止的命令，结束命令的位置也是它的输入，跳过时一并取走
+        auto end_iter = cmd_map.end();
+        if (footprint.span == CmdFootprint::kUntilEndCommand)
+        {
+            end_iter = cmd_map.FindNearestCommand("end " + iter->second.cmd(), iter->first);
+            // 找不到（比如结束命令来自batch展开）或者与嵌套的同名命令配对到同一个时，无法确定输入，不复用
+            auto same_end = [&end_iter](const Candidate& other) { return other.end_iter == end_iter; };
+            if (end_iter == cmd_map.end() || std::any_of(candidates.begin(), candidates.end(), same_end))
             {
-                next_delay = min(next_delay, command.delay());
-                ++iter;
-                continue;
+                end_iter = cmd_map.end();
+                lanes.set();
             }
-            else
+        }
+        candidates.push_back({iter, lanes, end_iter});
+
+        const std::string text = iter->second.toOriginalString();
+        const std::string end_text = end_iter != cmd_map.end() ? end_iter->second.toOriginalString() : std::string();
+        int first_lane = -1;
+        for (int lane = 0; lane < kLaneCount; ++lane)
+        {
+            if (lanes[lane])
             {
-                // 设置Logger
-                auto time_info = this->ToTimeInfo(command.time());
-                err_collector.SetRootCmdTime(time_info);
-                err_collector.SetExecTime(time_info);
-                err_collector.SetCommand(command.toOriginalString());
-                bool success = false;
-                // 执行
-                auto entrance = this->app_dispatch_map.find(command.cmd());
-                if (entrance != this->app_dispatch_map.end())
+                HashValue(command_hash[lane], iter->first);
+                HashValue(command_hash[lane], text);
+                if (end_iter != cmd_map.end())
                 {
-                    bool cmd_checked = false;
-                    for (std::shared_ptr<IApplication>& app : entrance->second)
-                    {
-                        cmd_checked = app->CheckArgs(command);
-                        if (cmd_checked)
-                        {
-                            success = app->ExecuteCommand(command, cmd_map, ic_);
-                            if (success)
-                            {
-                                break;
-                            }
-                        }
-                    }
-                    if (!cmd_checked)
-                    {
-                        // 如果没有任何一个插件接受此命令，那么报检查错误
-                        this->err_collector.ErrorLog(ErrorMessage<ErrorType::InvalidArgs>());
-                    }
+                    HashValue(command_hash[lane], end_iter->first);
+                    HashValue(command_hash[lane], end_text);
                 }
-
-                else  // start at __DEFAULT__
+                if (first_lane < 0)
                 {
-                    auto default_apps = this->app_dispatch_map.at("__DEFAULT__");
-                    for (std::shared_ptr<IApplication>& app : default_apps)
-                    {
-                        if (app->CheckArgs(command))
-                        {
-                            success = app->ExecuteCommand(command, cmd_map, ic_);
-                            if (success)
-                            {
-                                break;
-                            }
-                        }
-                    }
+                    first_lane = lane;
                 }
+                else
+                {
+                    group[find_group(lane)] = find_group(first_lane);
+                }
+            }
+        }
+    }
+
+    for (int lane = 0; lane < kLaneCount; ++lane)
+    {
+        record.lanes[lane].input = comment_lanes[lane] ? 0 : this->ic_.LaneHash(lane);
+        record.lanes[lane].commands = command_hash[lane];
+    }
+    // 导入的batch文件变化时，原文相同的命令也可能有不同的结果
+    if (!previous.valid || previous_output == nullptr || !previous.DependenciesUnchanged())
+    {
+        return 0;
+    }
+
+    // 组内任何一个表的输入或者命令变化了，整组重新执行。上次的输出被改动过时同样不能使用
+    LaneSet dirty_groups;
+    for (int lane = 0; lane < kLaneCount; ++lane)
+    {
+        const ExecutionRecord::LaneRecord& before = previous.lanes[lane];
+        const ExecutionRecord::LaneRecord& now = record.lanes[lane];
+        if (comment_lanes[lane] || before.input != now.input || before.commands != now.commands ||
+            previous_output->LaneHash(lane) != before.output)
+        {
+            dirty_groups.set(find_group(lane));
+        }
+    }
+    for (int lane = 0; lane < kLaneCount; ++lane)
+    {
+        reused_lanes[lane] = !dirty_groups[find_group(lane)];
+    }
 
-                auto iter_before_increase = iter;
-                ++iter;
-                // 把没有成功执行的命令移动到failed_map里面
-                if (!success)
+    // 取出只访问可复用表的命令。上次失败的命令仍然写回注释，上次的日志原样重放
+    auto failed_before = previous.failed_commands;
+    auto logs_before = previous.command_logs;
+    int skipped = 0;
+    for (auto& [iter, lanes, end_iter] : candidates)
+    {
+        if (lanes.none() || (lanes & ~reused_lanes).any())
+        {
+            continue;
+        }
+        auto key = std::make_pair(iter->first, iter->second.toOriginalString());
+        auto log = logs_before.find(key);
+        if (log != logs_before.end())
+        {
+            this->err_collector.Output() << log->second.text;
+            this->err_collector.AddCounts(log->second.errors, log->second.warnings);
+            record.command_logs.insert(logs_before.extract(log));
+        }
+
+        auto failed = failed_before.find(key);
+        int time = iter->first;
+        Command command = cmd_map.Take(iter);
+        if (failed != failed_before.end())
+        {
+            failed_before.erase(failed);
+            failed_map.insert(time, std::move(command));
+        }
+        else if (end_iter != cmd_map.end())
+        {
+            // 结束命令已被成功执行的起始命令消耗。起始命令失败时结束命令留在表里，与完整执行时一样处理
+            cmd_map.erase(end_iter);
+        }
+        ++skipped;
+    }
+    return skipped;
+}
+
+int ApplicationBus::RunCommands(const ExecutionRecord* previous, const IndexedChart* previous_output,
+                                ExecutionRecord* record)
+{
+    CurrentScope scope(this);
+    // 获取注释表
+    auto& comment_list = this->ic_.CommentList();
+
+    CommandMap cmd_map(comment_list);
+    CommandMap failed_map;  // 执行不了的东西
+
+    // 限定时间范围时，范围以外的根命令在调度到时原样写回，在此之前范围内的命令仍然可以取用它们。
+    // 只定义状态的命令（batch define、batch import）在写回之前照常执行，范围内的命令可能用到它们
+    const bool windowed = this->window_start > 0 || this->window_end < INT_MAX;
+    const auto in_window = [this](int time) { return time >= this->window_start && time < this->window_end; };
+
+    // 找不到起始命令的结束命令，不会被任何命令消耗
+    for (auto iter : cmd_map.UnpairedEndCommands())
+    {
+        if (!in_window(iter->first))
+        {
+            continue;
+        }
+        const Command& command = iter->second;
+        err_collector.SetRootCmdTime(command.time());
+        err_collector.SetExecTime(command.time());
+        err_collector.SetCommand(command);
+        this->err_collector.ErrorLog(ErrorMessage<ErrorType::BeginCommandNotFound>());
+    }
+
+    // 增量执行时跳过没有变化的命令
+    this->recording = record;
+    IndexedChart::LaneSet reused_lanes;
+    int skipped = 0;
+    if (record != nullptr)
+    {
+        skipped = this->SkipUnchangedCommands(cmd_map, failed_map, previous != nullptr ? *previous : ExecutionRecord(),
+                                              previous_output, *record, reused_lanes);
+    }
+
+    // 每一轮按顺序执行延迟权重不超过current_delay的命令。
+    // 命令直接从命令表的延迟分组索引中取出，不再逐条跳过延迟较高的命令。
+    // 连续的、访问范围互不冲突的命令组成一组并行执行
+    unsigned int current_delay = 0;
+    std::vector<CommandMap::Iterator> group;
+    CmdFootprint group_footprint;
+    while (!cmd_map.Empty())
+    {
+        CommandMap::Position cursor = CommandMap::kBeginPosition;
+        for (auto iter = cmd_map.NextScheduled(current_delay, cursor); iter != cmd_map.end();
+             iter = cmd_map.NextScheduled(current_delay, cursor))
+        {
+            // 没有被起始命令取走的结束命令属于范围以外的起始命令，同样写回
+            if (windowed && (!in_window(iter->first) || IsEndCommand(iter->second)))
+            {
+                int time = iter->first;
+                if (this->IsDefinition(iter->second))
                 {
-                    failed_map.insert(iter_before_increase->first, iter_before_increase->second);
+                    this->RunRecordedCommand(time, iter->second, cmd_map);
                 }
-                cmd_map.erase(iter_before_increase);
+                failed_map.insert(time, cmd_map.Take(iter));
+                continue;
+            }
+
+            CmdFootprint footprint = this->worker_count > 1 ? this->CommandFootprint(iter->second) : CmdFootprint::Exclusive();
+            if (footprint.ConflictsWith(group_footprint))
+            {
+                this->RunConcurrently(group, cmd_map, failed_map);
+                group_footprint = CmdFootprint();
+            }
+
+            if (footprint.exclusive)
+            {
+                bool success = this->RunRecordedCommand(iter->first, iter->second, cmd_map);
+                this->RetireRootCommand(iter, success, cmd_map, failed_map);
+            }
+            else
+            {
+                // 各表需要在并行访问前加载完毕
+                this->ic_.PreloadLanes(footprint.lanes);
+                group.push_back(iter);
+                group_footprint |= footprint;
             }
         }
+        this->RunConcurrently(group, cmd_map, failed_map);
+        group_footprint = CmdFootprint();
+
         // 下一个延迟点
-        current_delay = next_delay;
-        next_delay = UINT32_MAX;
+        current_delay = cmd_map.NextDelayLevel(current_delay);
+    }
+
+    // 没有变化的表使用上次的输出
+    if (reused_lanes.any())
+    {
+        this->ic_.CopyLanes(*previous_output, reused_lanes);
     }
 
     // 写回
     ic_.CommentList() = failed_map.ExportToComment();
 
-    this->chart_ = ic_.ExportToChart();
+    // 谱面头和自定义fx不经过索引表，直接从输入移交给输出
+    Chart output = ic_.ExportToChart();
+    output.GetHeader() = std::move(this->chart_.GetHeader());
+    output.GetCustomFX() = std::move(this->chart_.GetCustomFX());
+    this->chart_ = std::move(output);
+    // ic_的懒加载数据源已被替换，重新绑定
+    this->ic_.ImportFromChart(this->chart_);
+
+    // 记录输出。与下次读入的输出文件比对，所以在重新绑定之后计算
+    if (record != nullptr)
+    {
+        for (int lane = 0; lane < ExecutionRecord::kLaneCount; ++lane)
+        {
+            record->lanes[lane].output = this->ic_.LaneHash(lane);
+        }
+        for (auto& [time, command] : failed_map)
+        {
+            record->failed_commands.emplace(time, command.toOriginalString());
+        }
+        record->RecordDependencies(this->dependencies);
+        record->valid = true;
+    }
+    this->recording = nullptr;
+
+    return skipped;
 }
 
-bool ApplicationBus::CheckCommand(const Command& command)
+int ApplicationBus::WindowReach()
+{
+    CurrentScope scope(this);
+    CommandMap cmd_map(std::as_const(this->ic_).CommentList());
+
+    int reach = this->window_end;
+    for (auto iter = cmd_map.lower_bound(this->window_start); iter != cmd_map.end() && iter->first < this->window_end;
+         ++iter)
+    {
+        const int time = iter->first;
+        const Command& command = iter->second;
+        if (IsEndCommand(command))
+        {
+            continue;
+        }
+
+        int span = this->ExpandedFootprint(time, command).span;
+        if (span == CmdFootprint::kUntilEndCommand)
+        {
+            auto end_iter = cmd_map.FindNearestCommand("end " + command.cmd(), time);
+            if (end_iter == cmd_map.end())
+            {
+                return INT_MAX;
+            }
+            span = end_iter->first - time;
+        }
+        reach = std::max(reach, time + span);
+    }
+    return reach;
+}
+
+int ApplicationBus::ResolveDispatch(const Command& command)
+{
+    int dispatch_id = command.dispatchID();
+    if (dispatch_id < 0)
+    {
+        dispatch_id = this->registry.DispatchID(command.cmd());
+        command.setDispatchID(dispatch_id);
+    }
+    return dispatch_id;
+}
+
+bool ApplicationBus::CheckCandidate(const Command& command, int candidate)
+{
+    int cached = command.cachedCheck(candidate);
+    if (cached >= 0)
+    {
+        return cached == 1;
+    }
+
+    int app_id = this->registry.Candidates(command.dispatchID())[candidate];
+    bool valid = this->app_list[app_id]->CheckArgs(command);
+    command.cacheCheck(candidate, valid);
+    return valid;
+}
+
+bool ApplicationBus::Dispatch(const Command& command, CommandMap& cmd_map, bool& cmd_checked)
+{
+    auto& candidates = this->registry.Candidates(this->ResolveDispatch(command));
+    int candidate_count = static_cast<int>(candidates.size());
+    cmd_checked = false;
+    for (int i = 0; i < candidate_count; ++i)
+    {
+        cmd_checked = this->CheckCandidate(command, i);
+        if (cmd_checked && this->app_list[candidates[i]]->ExecuteCommand(command, cmd_map, this->ic_, *this))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+CmdFootprint ApplicationBus::CommandFootprint(const Command& command)
+{
+    // 不接受该命令的插件不会执行它，不计入范围
+    CmdFootprint footprint;
+    footprint.span = 0;
+    int dispatch_id = this->ResolveDispatch(command);
+    auto& candidates = this->registry.Candidates(dispatch_id);
+    int candidate_count = static_cast<int>(candidates.size());
+    for (int i = 0; i < candidate_count; ++i)
+    {
+        if (this->CheckCandidate(command, i))
+        {
+            footprint |= this->app_list[candidates[i]]->Footprint(command);
+        }
+    }
+    return footprint;
+}
+
+bool ApplicationBus::IsDefinition(const Command& command)
+{
+    bool accepted = false;
+    int dispatch_id = this->ResolveDispatch(command);
+    auto& candidates = this->registry.Candidates(dispatch_id);
+    int candidate_count = static_cast<int>(candidates.size());
+    for (int i = 0; i < candidate_count; ++i)
+    {
+        if (this->CheckCandidate(command, i))
+        {
+            if (!this->app_list[candidates[i]]->IsDefinition(command))
+            {
+                return false;
+            }
+            accepted = true;
+        }
+    }
+    return accepted;
+}
+
+bool ApplicationBus::RunRootCommand(const Command& command, CommandMap& cmd_map, ErrorCollector& logger)
+{
+    // 设置Logger
+    logger.SetRootCmdTime(command.time());
+    logger.SetExecTime(command.time());
+    logger.SetCommand(command);
+    // 执行
+    bool cmd_checked = false;
+    bool success = this->Dispatch(command, cmd_map, cmd_checked);
+    if (!cmd_checked && command.dispatchID() != kDefaultDispatch)
+    {
+        // 如果没有任何一个插件接受此命令，那么报检查错误
+        logger.ErrorLog(this->InvalidArgsMessage(command));
+    }
+    return success;
+}
+
+bool ApplicationBus::RunRecordedCommand(int time, const Command& command, CommandMap& cmd_map)
+{
+    if (this->recording == nullptr)
+    {
+        return this->RunRootCommand(command, cmd_map, this->err_collector);
+    }
+
+    // 单独截取这条命令的日志，之后原样转发
+    std::ostream& outer_output = this->err_collector.Output();
+    std::ostringstream captured;
+    const int errors_before = this->err_collector.ErrorCount();
+    const int warnings_before = this->err_collector.WarningCount();
+    this->err_collector.SetOutput(&captured);
+    bool success = false;
+    try
+    {
+        success = this->RunRootCommand(command, cmd_map, this->err_collector);
+    }
+    catch (...)
+    {
+        this->err_collector.SetOutput(&outer_output);
+        outer_output << captured.str();
+        throw;
+    }
+    this->err_collector.SetOutput(&outer_output);
+    outer_output << captured.str();
+
+    this->RecordCommandLog(time, command, captured.str(), this->err_collector.ErrorCount() - errors_before,
+                           this->err_collector.WarningCount() - warnings_before);
+    return success;
+}
+
+void ApplicationBus::RecordCommandLog(int time, const Command& command, const std::string& text, int errors,
+                                      int warnings)
+{
+    if (this->recording != nullptr && (!text.empty() || errors != 0 || warnings != 0))
+    {
+        this->recording->command_logs.emplace(std::make_pair(time, command.toOriginalString()),
+                                              ExecutionRecord::CommandLog{text, errors, warnings});
+    }
+}
+
+void ApplicationBus::RetireRootCommand(CommandMap::Iterator& iter, bool success, CommandMap& cmd_map,
+                                       CommandMap& failed_map)
+{
+    // 把没有成功执行的命令移动到failed_map里面
+    if (!success)
+    {
+        int exec_time = iter->first;
+        failed_map.insert(exec_time, cmd_map.Take(iter));
+    }
+    else
+    {
+        cmd_map.erase(iter);
+    }
+}
+
+void ApplicationBus::RunConcurrently(std::vector<CommandMap::Iterator>& group, CommandMap& cmd_map,
+                                     CommandMap& failed_map)
 {
-    bool cmd_is_valid = false;
-    // 看看命令是否合法
-    auto entrance = this->app_dispatch_map.find(command.cmd());
-    if (entrance != this->app_dispatch_map.end())
+    if (group.size() == 1)
     {
-        for (std::shared_ptr<IApplication>& app : entrance->second)
+        bool success = this->RunRecordedCommand(group[0]->first, group[0]->second, cmd_map);
+        this->RetireRootCommand(group[0], success, cmd_map, failed_map);
+    }
+    else if (group.size() > 1)
+    {
+        if (this->worker_pool == nullptr)
         {
-            // 只要其中某一个插件认为合法就行（因为执行的时候也是这样）
-            cmd_is_valid = app->CheckArgs(command);
-            if (cmd_is_valid)
+            this->worker_pool = std::make_unique<WorkerPool>(this->worker_count);
+        }
+
+        // 每条命令使用自己的Logger，消息先写入缓冲区
+        int count = static_cast<int>(group.size());
+        std::vector<ErrorCollector> loggers(count, this->err_collector);
+        std::vector<std::ostringstream> messages(count);
+        std::vector<char> results(count, 0);
+        std::vector<std::exception_ptr> exceptions(count);
+        this->worker_pool->Run(count, [&](int i) {
+            loggers[i].Reset();
+            loggers[i].SetOutput(&messages[i]);
+            CurrentScope scope(this);
+            local_collector = &loggers[i];
+            try
             {
-                break;
+                results[i] = this->RunRootCommand(group[i]->second, cmd_map, loggers[i]);
             }
+            catch (...)
+            {
+                exceptions[i] = std::current_exception();
+            }
+            local_collector = nullptr;
+        });
+
+        // 按命令顺序提交。异常也在轮到该命令时才抛出
+        for (int i = 0; i < count; ++i)
+        {
+            this->err_collector.Output() << messages[i].str();
+            this->err_collector.MergeCounts(loggers[i]);
+            this->RecordCommandLog(group[i]->first, group[i]->second, messages[i].str(), loggers[i].ErrorCount(),
+                                   loggers[i].WarningCount());
+            if (exceptions[i] != nullptr)
+            {
+                group.clear();
+                std::rethrow_exception(exceptions[i]);
+            }
+            this->RetireRootCommand(group[i], results[i] != 0, cmd_map, failed_map);
         }
     }
+    group.clear();
+}
 
-    return cmd_is_valid;
+std::string ApplicationBus::InvalidArgsMessage(const Command& command) const
+{
+    std::string msg = ErrorMessage<ErrorType::InvalidArgs>();
+    for (int app_id : this->registry.Candidates(command.dispatchID()))
+    {
+        auto& app = this->app_list[app_id];
+        const ArgSchema* schema = app->AcceptedArgs();
+        if (schema != nullptr)
+        {
+            msg += "\n\tUsage: " + command.cmd() + " " + schema->Usage();
+            std::string reason = schema->Explain(command);
+            if (!reason.empty())
+            {
+                msg += " (" + reason + ")";
+            }
+        }
+    }
+    return msg;
+}
+
+bool ApplicationBus::CheckCommand(const Command& command)
+{
+    // 看看命令是否合法。默认插件组不参与检查
+    int dispatch_id = this->ResolveDispatch(command);
+    if (dispatch_id == kDefaultDispatch)
+    {
+        return false;
+    }
+
+    int candidate_count = static_cast<int>(this->registry.Candidates(dispatch_id).size());
+    for (int i = 0; i < candidate_count; ++i)
+    {
+        // 只要其中某一个插件认为合法就行（因为执行的时候也是这样）
+        if (this->CheckCandidate(command, i))
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 CommandMap ApplicationBus::Compile(const CommandMap& map, ErrorStack& err_stack)
 {
+    CurrentScope scope(this);
     CommandMap input_map = map;
     CommandMap compiled_map;
     while (!input_map.Empty())
@@ -313,13 +829,14 @@ CommandMap ApplicationBus::Compile(const CommandMap& map, ErrorStack& err_stack)
             if (!command.empty())
             {
                 // 执行script命令
-                auto entrance = this->script_compile_map.find(command.cmd());
-                if (entrance != this->script_compile_map.end())
+                const std::vector<int>* compilers = this->registry.Compilers(command.cmd());
+                if (compilers != nullptr)
                 {
-                    for (std::shared_ptr<ICompiler>& app : entrance->second)
+                    for (int app_id : *compilers)
                     {
+                        auto app = std::static_pointer_cast<ICompiler>(this->app_list[app_id]);
                         CommandMap submap;
-                        cmd_is_valid = app->Compile(command, submap, err_stack);
+                        cmd_is_valid = app->Compile(command, submap, err_stack, *this);
                         if (cmd_is_valid)
                         {
                             for(auto& [time, cmd] : submap)
@@ -362,51 +879,48 @@ CommandMap ApplicationBus::Compile(const CommandMap& map, ErrorStack& err_stack)
 
 void ApplicationBus::ExecuteBatch(const CommandMap& batch, int time)
 {
+    CurrentScope scope(this);
     CommandMap input_map = batch.Offset(time);
     CommandMap failed_map;
+    // Logger中记录的命令位于input_map中，退出前需要还原
+    const string outer_command = err_collector.CurrentCommand();
     while (!input_map.Empty())
     {
-        for (auto iter = input_map.begin(); iter != input_map.end();)
+        // 批处理不区分延迟权重，按顺序执行全部命令
+        CommandMap::Position cursor = CommandMap::kBeginPosition;
+        for (auto iter = input_map.NextScheduled(UINT_MAX, cursor); iter != input_map.end();
+             iter = input_map.NextScheduled(UINT_MAX, cursor))
         {
-            Command command = iter->second;
+            const Command& command = iter->second;
             bool success = false;
             // 执行
-            auto entrance = this->app_dispatch_map.find(command.cmd());
-            if (entrance != this->app_dispatch_map.end())
+            if (this->ResolveDispatch(command) != kDefaultDispatch)
             {
                 // 设置Logger
-                err_collector.SetExecTime(this->ToTimeInfo(command.time()));
-                err_collector.SetCommand(command.toOriginalString());
+                err_collector.SetExecTime(command.time());
+                err_collector.SetCommand(command);
                 bool cmd_checked = false;
-                for (std::shared_ptr<IApplication>& app : entrance->second)
-                {
-                    cmd_checked = app->CheckArgs(command);
-                    if (cmd_checked)
-                    {
-                        success = app->ExecuteCommand(command, input_map, this->ic_);
-                        if (success)
-                        {
-                            break;
-                        }
-                    }
-                }
+                success = this->Dispatch(command, input_map, cmd_checked);
 
                 if (!cmd_checked)
                 {
                     // 如果没有任何一个插件认为命令参数合法，那么报错
-                    this->err_collector.ErrorLog(ErrorMessage<ErrorType::InvalidArgs>());
+                    this->err_collector.ErrorLog(this->InvalidArgsMessage(command));
                 }
             }
 
-            auto iter_before_increase = iter;
-            ++iter;
             if (!success)
             {
-                failed_map.insert(iter_before_increase->first, iter_before_increase->second);
+                int exec_time = iter->first;
+                failed_map.insert(exec_time, input_map.Take(iter));
+            }
+            else
+            {
+                input_map.erase(iter);
             }
-            input_map.erase(iter_before_increase);
         }
     }
+    err_collector.SetCommand(outer_command);
 }
 
 void ApplicationBus::Reset()
@@ -414,6 +928,7 @@ void ApplicationBus::Reset()
     this->err_collector.Reset();
     this->chart_ = Chart();
     this->ic_ = IndexedChart();
+    this->dependencies.clear();
 }
 
 /* #endregion Application Bus */
\ No newline at end of file
@@ -20,15 +20,27 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <climits>
 #include <functional>
 #include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "src/Chart/indexed_chart.h"
+#include "src/Command/arg_schema.h"
 #include "src/Command/command.h"
 #include "src/Command/command_map.h"
 
 #include "src/Errors/error_collector.h"
+#include "src/FileSystem/path_manager.h"
+#include "src/misc/worker_pool.h"
+
+class ApplicationBus;
+class ExecutionRecord;
 
 /* #region Application Interface */
 
@@ -45,26 +57,83 @@ enum class ApplicationType : int
 #define APP_TYPE(type_name) \
     ApplicationType type() const override { return ApplicationType::type_name; }
 
+/// 命令执行时读写的谱面范围，用于判断哪些命令可以并行执行
+struct CmdFootprint
+{
+    /// 读写的索引表
+    IndexedChart::LaneSet lanes;
+    /// 是否需要独占谱面和命令表。独占的命令不与任何命令并行
+    bool exclusive = false;
+    /// 自命令时刻起读写谱面的时长，流式处理时用来决定向后读入多少小节
+    int span = kUnknownSpan;
+
+    /// 作用时长未知
+    static constexpr int kUnknownSpan = -1;
+    /// 一直作用到成对的结束命令
+    static constexpr int kUntilEndCommand = -2;
+
+    /// 独占的访问范围
+    static inline CmdFootprint Exclusive() { return CmdFootprint{{}, true}; }
+    /// 作用到成对结束命令的独占访问范围
+    static inline CmdFootprint ExclusiveUntilEnd() { return CmdFootprint{{}, true, kUntilEndCommand}; }
+    /// 两个访问范围是否冲突
+    inline bool ConflictsWith(const CmdFootprint& other) const
+    {
+        return this->exclusive || other.exclusive || (this->lanes & other.lanes).any();
+    }
+    /// 合并访问范围
+    inline CmdFootprint& operator|=(const CmdFootprint& other)
+    {
+        this->lanes |= other.lanes;
+        this->exclusive = this->exclusive || other.exclusive;
+        // 时长取较长的一方，未知优先于到结束命令为止
+        if (this->span == kUnknownSpan || other.span == kUnknownSpan)
+        {
+            this->span = kUnknownSpan;
+        }
+        else if (this->span == kUntilEndCommand || other.span == kUntilEndCommand)
+        {
+            this->span = kUntilEndCommand;
+        }
+        else
+        {
+            this->span = std::max(this->span, other.span);
+        }
+        return *this;
+    }
+};
+
+/// 命令插件。每个ApplicationBus持有各插件自己的实例，插件内的状态不会在谱面之间共享
 class IApplication
 {
 public:
     friend class ApplicationBus;
+    friend class PluginRegistry;
 
 protected:
     // 接受的命令名称
     virtual std::vector<std::string> AcceptedCmdName() = 0;
 
-    // 检查命令参数是否合法
-    virtual bool CheckArgs(const Command& cmd) = 0;
+    // 接受的参数格式。没有声明格式的插件需要自行实现CheckArgs
+    virtual const ArgSchema* AcceptedArgs() const { return nullptr; }
 
-    // 执行命令
-    virtual bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart) = 0;
+    // 检查命令参数是否合法。默认按AcceptedArgs检查
+    virtual bool CheckArgs(const Command& cmd);
+
+    // 执行命令。bus是执行该命令的上下文
+    virtual bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus) = 0;
+
+    // 命令访问谱面的范围。默认独占；声明了范围的插件可能被并行执行，此时不能访问命令表
+    virtual CmdFootprint Footprint(const Command& /*cmd*/) const { return CmdFootprint::Exclusive(); }
+
+    // 命令是否只定义插件内的状态（比如batch define），不修改谱面。限定时间范围执行时，这类命令不论在哪里都会执行
+    virtual bool IsDefinition(const Command& /*cmd*/) const { return false; }
 
 public:
     virtual ~IApplication() = default;
 
     // ApplicationBus使用的执行入口点
-    bool ExecuteCommand(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart);
+    bool ExecuteCommand(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus);
 
     virtual ApplicationType type() const { return ApplicationType::Normal; }
 };
@@ -79,66 +148,202 @@ public:
     virtual ApplicationType type() const override { return ApplicationType::Scripting; }
 
 protected:
-    virtual bool Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack) = 0;
+    virtual bool Compile(const Command& cmd, CommandMap& cmd_map, ErrorStack& err_stack, ApplicationBus& bus) = 0;
 
-    virtual bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart) override;
+    virtual bool ProcessCmd(const Command& cmd, CommandMap& cmd_map, IndexedChart& chart, ApplicationBus& bus) override;
 };
 
 /* #endregion Application Interface */
 
+/* #region Plugin Registry */
+
+/// 插件注册表：所有插件的构造方式，以及命令词到插件的分派表。
+/// 全进程共享一份，构造完成后不再修改，因此可以被多个线程中的ApplicationBus同时使用。
+class PluginRegistry
+{
+public:
+    using Factory = std::function<std::shared_ptr<IApplication>()>;
+    /// 命令词 -> 分派编号。命令词由插件在运行时注册，因此使用哈希表而非编译期关键字表
+    using DispatchMap = std::unordered_map<std::string, int>;
+    /// 分派编号 -> 候选插件在插件表中的序号
+    using DispatchTable = std::vector<std::vector<int>>;
+    /// 脚本命令词 -> 候选编译插件在插件表中的序号
+    using CompileMap = std::unordered_map<std::string, std::vector<int>>;
+
+    /// 分派编号：没有匹配命令词的命令交给默认插件组
+    static constexpr int kDefaultDispatch = 0;
+
+private:
+    std::vector<Factory> factories;
+    DispatchMap dispatch_map;
+    DispatchTable dispatch_table;
+    CompileMap compile_map;
+
+    PluginRegistry();
+    PluginRegistry(const PluginRegistry&) = delete;
+    PluginRegistry& operator=(const PluginRegistry&) = delete;
+
+    void RegisterAllApplications();
+    void InitializeDispatchMap(const std::vector<std::shared_ptr<IApplication>>& apps);
+    void InitializeCompilerMap(const std::vector<std::shared_ptr<IApplication>>& apps);
+
+public:
+    /// 获取全局共享的注册表
+    static const PluginRegistry& Default();
+
+    /// 按注册顺序创建一套新的插件实例
+    std::vector<std::shared_ptr<IApplication>> Instantiate() const;
+
+    /// 获取命令词的分派编号。命令词未注册时返回kDefaultDispatch
+    inline int DispatchID(const std::string& cmd) const;
+    /// 分派编号对应的候选插件序号
+    inline const std::vector<int>& Candidates(int dispatch_id) const;
+    /// 脚本命令词对应的编译插件序号。不是脚本命令时返回空指针
+    inline const std::vector<int>* Compilers(const std::string& cmd) const;
+};
+
+/* #endregion Plugin Registry */
+
 /* #region Application Bus */
 
+/// 当前线程上正在执行命令的ApplicationBus的Logger
 #define GET_ERROR_COLLECTOR \
-    ApplicationBus::GetInstance().GetErrorCollector()
+    ApplicationBus::Current().GetErrorCollector()
 
+/// 一次执行任务的上下文：谱面、Logger、文件搜索路径和一套插件实例。
+///
+/// 不同的ApplicationBus之间互不影响，可以在不同线程中同时处理不同的谱面。
 class ApplicationBus
 {
 public:
-    using DispatchMap = std::map<std::string, std::vector<std::shared_ptr<IApplication>>>;
-    using CompileMap = std::map<std::string, std::vector<std::shared_ptr<ICompiler>>>;
     using ErrorStack = std::list<std::string>;
 
 private:
-    // 组件存储区
+    // 插件注册表
+    const PluginRegistry& registry;
+    // 本上下文的插件实例，顺序与注册表一致
     std::vector<std::shared_ptr<IApplication>> app_list;
-    // 存放各个功能组件的索引表
-    DispatchMap app_dispatch_map;
-    CompileMap script_compile_map;
+    // 文件搜索路径
+    PathManager path_manager;
+    // 执行过程中读取过的外部文件
+    std::vector<std::string> dependencies;
     // 谱面本体
     Chart chart_;
     IndexedChart ic_;
     // Logger
     ErrorCollector err_collector;
-    
+    // 并行执行命令时，工作线程使用的Logger
+    inline static thread_local ErrorCollector* local_collector = nullptr;
+    // 当前线程上正在执行命令的ApplicationBus
+    inline static thread_local ApplicationBus* current_bus = nullptr;
+    // 并行执行命令的线程。首次需要时创建
+    std::unique_ptr<WorkerPool> worker_pool;
+    int worker_count;
+    // 增量执行时，本次执行的记录
+    ExecutionRecord* recording = nullptr;
+    // 只执行这段时间内的根命令，[window_start, window_end)
+    int window_start = 0;
+    int window_end = INT_MAX;
 
 private:
-    // singleton
-    ApplicationBus();
+    /// 在作用域内将某个ApplicationBus设为当前线程的上下文，退出时还原
+    class CurrentScope
+    {
+    private:
+        ApplicationBus* previous;
+
+    public:
+        inline explicit CurrentScope(ApplicationBus* bus) : previous(current_bus) { current_bus = bus; }
+        inline ~CurrentScope() { current_bus = previous; }
+        CurrentScope(const CurrentScope&) = delete;
+        CurrentScope& operator=(const CurrentScope&) = delete;
+    };
+
     ApplicationBus(const ApplicationBus&) = delete;
     ApplicationBus& operator=(const ApplicationBus&) = delete;
 
-    void RegisterAllApplications();
-
-    void InitializeDispatchMap();
-    void InitializeCompilerMap();
-
-    TimeInfo ToTimeInfo(int time_number);
+    /// 分派编号：没有匹配命令词的命令交给默认插件组
+    static constexpr int kDefaultDispatch = PluginRegistry::kDefaultDispatch;
+    /// 获取命令的分派编号。命令词未注册时返回kDefaultDispatch。
+    int ResolveDispatch(const Command& command);
+    /// 检查命令是否被指定的候选插件接受。检查结果缓存在命令中。
+    bool CheckCandidate(const Command& command, int candidate);
+    /// @brief 将命令分派给候选插件执行
+    /// @param cmd_checked 是否有任何一个插件认为命令参数合法
+    /// @return 是否执行成功
+    bool Dispatch(const Command& command, CommandMap& cmd_map, bool& cmd_checked);
+    /// 生成参数不合法时的错误信息，附带各候选插件的参数格式
+    std::string InvalidArgsMessage(const Command& command) const;
+    /// 命令访问谱面的范围：所有接受该命令的候选插件的范围之和
+    CmdFootprint CommandFootprint(const Command& command);
+    /// 命令是否只定义插件内的状态。接受命令的插件都这样声明时才成立
+    bool IsDefinition(const Command& command);
+    /// 执行一条根命令，错误信息记录到logger中。返回是否执行成功
+    bool RunRootCommand(const Command& command, CommandMap& cmd_map, ErrorCollector& logger);
+    /// 在当前线程上执行一条根命令。增量执行时记录它产生的日志
+    bool RunRecordedCommand(int time, const Command& command, CommandMap& cmd_map);
+    /// 增量执行时记录一条根命令产生的日志
+    void RecordCommandLog(int time, const Command& command, const std::string& text, int errors, int warnings);
+    /// 执行完毕的根命令移出命令表。没有成功执行的移动到failed_map中。迭代器会被引导到下一个命令
+    void RetireRootCommand(CommandMap::Iterator& iter, bool success, CommandMap& cmd_map, CommandMap& failed_map);
+    /// @brief 并行执行一组互不冲突的根命令。错误信息和执行结果按命令顺序提交，与依次执行时一致
+    /// @param group 按执行顺序排列的命令
+    void RunConcurrently(std::vector<CommandMap::Iterator>& group, CommandMap& cmd_map, CommandMap& failed_map);
+
+    /// 脚本命令按展开后各命令的范围计算的访问范围。只用于分析，不能用来安排并行执行
+    CmdFootprint ExpandedFootprint(int time, const Command& command);
+    /// 运行所有命令。record不为空时记录本次执行，并在previous有效时跳过没有变化的命令
+    int RunCommands(const ExecutionRecord* previous, const IndexedChart* previous_output, ExecutionRecord* record);
+    /// @brief 计算各表的输入和命令记录，并从命令表中取出只访问了没有变化的表的命令
+    /// @param reused_lanes 可以直接使用上次输出的表
+    /// @return 取出的命令数
+    int SkipUnchangedCommands(CommandMap& cmd_map, CommandMap& failed_map, const ExecutionRecord& previous,
+                              const IndexedChart* previous_output, ExecutionRecord& record,
+                              IndexedChart::LaneSet& reused_lanes);
 
 public:
+    /// @brief 构造一个新的上下文
+    /// @param paths 文件搜索路径，默认复制全局的搜索路径
+    explicit ApplicationBus(const PathManager& paths = PathManager::GetInstance(),
+                            const PluginRegistry& registry = PluginRegistry::Default());
     inline ~ApplicationBus();
-    /// 获取单例
+    /// 获取默认的上下文，供只处理一张谱面的调用方使用
     inline static ApplicationBus& GetInstance();
-
-    /// 新增一个命令插件
-    inline void AppendApplication(std::shared_ptr<IApplication>&& app);
-    /// 获取Logger
+    /// 获取当前线程上正在执行命令的上下文。没有时返回默认的上下文
+    inline static ApplicationBus& Current();
+
+    /// 获取文件搜索路径
+    inline PathManager& Paths();
+    /// 记录一个执行过程中读取的外部文件
+    inline void AddDependency(const std::string& path);
+    /// 执行过程中读取过的外部文件，不含谱面本身
+    inline const std::vector<std::string>& Dependencies() const;
+    /// 获取Logger。并行执行命令时，各线程获取的是自己的Logger
     inline ErrorCollector& GetErrorCollector();
-    /// 设置待处理的谱面
+    /// 设置并行执行命令的线程数。默认为1，即依次执行
+    inline void SetWorkerCount(int count);
+    /// 设置待处理的谱面（复制一份）
     inline void BindChart(const Chart& chart);
+    /// 设置待处理的谱面，接管其内容。谱面头和自定义fx原样带到处理结果中
+    inline void BindChart(Chart&& chart);
+    /// 只执行[start, end)内的根命令，其余命令原样写回注释。批处理和循环展开出的命令不受限制
+    inline void SetTimeWindow(int start, int end);
+    /// 时间范围内的根命令最远作用到的时刻，至少为范围的结束时刻。没有声明作用时长的命令不计入。
+    /// 成对的结束命令不在谱面中时返回INT_MAX
+    int WindowReach();
     /// 运行所有命令
     void RunCommands();
+    /// @brief 增量运行所有命令。输入和命令都与上次相同的表直接使用上次的输出，只访问这些表的命令不再执行
+    /// @param previous 上一次执行的记录
+    /// @param previous_output 上一次输出的谱面
+    /// @param record 本次执行的记录
+    /// @return 跳过的命令数
+    int RunCommandsIncremental(const ExecutionRecord& previous, const IndexedChart& previous_output,
+                               ExecutionRecord& record);
     /// 获取处理后的谱面
-    inline Chart GetChart();
+    inline const Chart& GetChart() const;
+    /// 取走处理后的谱面，不复制。之后需要重新BindChart
+    inline Chart TakeChart();
     /// 重置，清除谱面内容和错误记录
     void Reset();
 
@@ -154,6 +359,23 @@ public:
 
 /* #region inline functions */
 
+inline int PluginRegistry::DispatchID(const std::string& cmd) const
+{
+    auto entrance = this->dispatch_map.find(cmd);
+    return entrance != this->dispatch_map.end() ? entrance->second : kDefaultDispatch;
+}
+
+inline const std::vector<int>& PluginRegistry::Candidates(int dispatch_id) const
+{
+    return this->dispatch_table[dispatch_id];
+}
+
+inline const std::vector<int>* PluginRegistry::Compilers(const std::string& cmd) const
+{
+    auto entrance = this->compile_map.find(cmd);
+    return entrance != this->compile_map.end() ? &entrance->second : nullptr;
+}
+
 inline ApplicationBus::~ApplicationBus()
 {
     // apps released automatically
@@ -165,9 +387,27 @@ inline ApplicationBus& ApplicationBus::GetInstance()
     return bus;
 }
 
-inline void ApplicationBus::AppendApplication(std::shared_ptr<IApplication>&& app)
+inline ApplicationBus& ApplicationBus::Current()
+{
+    return current_bus != nullptr ? *current_bus : GetInstance();
+}
+
+inline PathManager& ApplicationBus::Paths()
+{
+    return this->path_manager;
+}
+
+inline void ApplicationBus::AddDependency(const std::string& path)
+{
+    if (std::find(this->dependencies.begin(), this->dependencies.end(), path) == this->dependencies.end())
+    {
+        this->dependencies.push_back(path);
+    }
+}
+
+inline const std::vector<std::string>& ApplicationBus::Dependencies() const
 {
-    this->app_list.push_back(std::forward<std::shared_ptr<IApplication>>(app));
+    return this->dependencies;
 }
 
 inline void ApplicationBus::BindChart(const Chart& chart)
@@ -176,14 +416,44 @@ inline void ApplicationBus::BindChart(const Chart& chart)
     this->ic_.ImportFromChart(this->chart_);
 }
 
-inline Chart ApplicationBus::GetChart()
+inline void ApplicationBus::BindChart(Chart&& chart)
+{
+    this->chart_ = std::move(chart);
+    this->ic_.ImportFromChart(this->chart_);
+}
+
+inline void ApplicationBus::SetTimeWindow(int start, int end)
+{
+    this->window_start = start;
+    this->window_end = end;
+}
+
+inline const Chart& ApplicationBus::GetChart() const
 {
     return this->chart_;
 }
 
+inline Chart ApplicationBus::TakeChart()
+{
+    // ic_的懒加载数据源指向chart_，一并清空
+    Chart chart = std::move(this->chart_);
+    this->chart_ = Chart();
+    this->ic_ = IndexedChart();
+    return chart;
+}
+
 inline ErrorCollector& ApplicationBus::GetErrorCollector()
 {
-    return this->err_collector;
+    return local_collector != nullptr ? *local_collector : this->err_collector;
+}
+
+inline void ApplicationBus::SetWorkerCount(int count)
+{
+    if (count != this->worker_count)
+    {
+        this->worker_count = count;
+        this->worker_pool.reset();
+    }
 }
 
 /* #endregion inline functions */
@@ -0,0 +1,208 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_streamer.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+#include "application_bus.h"
+#include "src/misc/utilities.h"
+
+using namespace std;
+
+bool ChartStreamer::ReadMeasure(std::istream& is)
+{
+    // 与Chart::ImportFromString相同的读法，自定义fx以#开头
+    while (!is.eof() && !is.fail() && is.peek() != '#')
+    {
+        // 空行，跳过
+        if (is.peek() == '\n')
+        {
+            is.get();
+            continue;
+        }
+
+        Measure measure;
+        measure.SetTimeSignature(this->numer, this->denom);
+        is >> measure;
+        if (measure.Empty())
+        {
+            continue;
+        }
+        measure.GetTimeSignature(this->numer, this->denom);
+        this->pending.push_back(std::move(measure));
+        return true;
+    }
+    this->input_done = true;
+    return false;
+}
+
+Chart ChartStreamer::BuildSlice(const Header& header) const
+{
+    Chart slice;
+    slice.GetHeader() = header;
+    if (this->context.has_value())
+    {
+        Measure measure = *this->context;
+        slice.AppendMeasure(measure);
+    }
+    for (const Measure& pending_measure : this->pending)
+    {
+        Measure measure = pending_measure;
+        slice.AppendMeasure(measure);
+    }
+    if (slice.Grid().MeasureCount() > 0)
+    {
+        Chart::ApplyStateMarks(slice[0], this->states);
+    }
+    return slice;
+}
+
+bool ChartStreamer::Run(std::istream& is, std::ostream& os, std::string& error)
+{
+    // 移除开头的BOM
+    if (is.peek() == 0xef)
+    {
+        char remove_bom[4];
+        is.read(remove_bom, 3);
+    }
+    Header header;
+    is >> header;
+
+    // 输出与Chart::ExportToString相同
+    os << "\xEF\xBB\xBF" << header << CRLF();
+
+    const int window = max(this->options.window, 1);
+    const int lookahead = max(this->options.lookahead, 0);
+    this->states.assign(MarkTypesCount, nullopt);
+    while (true)
+    {
+        while (!this->input_done && static_cast<int>(this->pending.size()) < window + lookahead)
+        {
+            this->ReadMeasure(is);
+        }
+        if (this->pending.empty())
+        {
+            break;
+        }
+
+        const int offset = this->context.has_value() ? 1 : 0;
+        const int window_count = min(window, static_cast<int>(this->pending.size()));
+        Chart slice, result;
+        ErrorCollector& logger = this->bus.GetErrorCollector();
+        while (true)
+        {
+            while (true)
+            {
+                slice = this->BuildSlice(header);
+                this->bus.BindChart(slice);
+                this->bus.SetTimeWindow(slice[offset].StartTime(), slice[offset + window_count - 1].EndTime());
+
+                // 窗口内的命令作用到读入范围以外时继续读入
+                const int reach = this->bus.WindowReach();
+                int slice_end = slice.TotalTime();
+                if (reach <= slice_end || this->input_done)
+                {
+                    break;
+                }
+                while (slice_end < reach && this->ReadMeasure(is))
+                {
+                    slice_end += this->pending.back().TotalTimespan();
+                }
+            }
+
+            // 这一轮可能重新执行，日志先留下来
+            const ErrorCollector saved = logger;
+            std::ostream& outer_output = logger.Output();
+            ostringstream round_log;
+            logger.SetOutput(&round_log);
+            logger.SetMeasureOffset(this->written - offset);
+            this->bus.RunCommands();
+            result = this->bus.TakeChart();
+
+            // 命令在末尾追加了小节。没有读到谱面末尾时，这些小节应该接在整张谱面之后，
+            // 所以读入剩下的全部小节，重新执行这一轮
+            if (result.Grid().MeasureCount() > slice.Grid().MeasureCount() && !this->input_done)
+            {
+                logger = saved;
+                while (this->ReadMeasure(is))
+                {
+                }
+                continue;
+            }
+            logger.SetOutput(&outer_output);
+            outer_output << round_log.str();
+            break;
+        }
+
+        const int measure_count = slice.Grid().MeasureCount();
+        bool lengths_kept = result.Grid().MeasureCount() >= measure_count;
+        for (int i = 0; lengths_kept && i < measure_count; ++i)
+        {
+            lengths_kept = result[i].TotalTimespan() == slice[i].TotalTimespan();
+        }
+        if (!lengths_kept)
+        {
+            error = "The lengths of the measures were changed, which can not be processed in streaming mode.";
+            return false;
+        }
+
+        // 写出窗口，窗口之后的小节换成执行后的结果
+        for (int i = 0; i < window_count; ++i)
+        {
+            if (this->context.has_value())
+            {
+                Chart::TrackStateMarks(*this->context, this->states);
+            }
+            this->context = result[offset + i];
+            os << *this->context << CRLF();
+        }
+        this->written += window_count;
+        this->pending.erase(this->pending.begin(), this->pending.begin() + window_count);
+        for (size_t i = 0; i < this->pending.size(); ++i)
+        {
+            this->pending[i] = result[offset + window_count + static_cast<int>(i)];
+        }
+        // 追加在谱面末尾的小节在之后的轮次中写出
+        for (int i = measure_count; i < result.Grid().MeasureCount(); ++i)
+        {
+            this->pending.push_back(result[i]);
+        }
+    }
+
+    // 自定义fx原样写出
+    string custom_fx;
+    while (!is.eof() && !is.fail())
+    {
+        string line;
+        getline(is, line);
+        custom_fx += line + CRLF();
+    }
+    if (is.fail() && !is.eof())
+    {
+        error = "Failed to read the chart.";
+        return false;
+    }
+    os << custom_fx;
+    return true;
+}
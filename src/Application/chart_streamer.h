@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <deque>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/Chart/chart.h"
+
+class ApplicationBus;
+
+/// @brief
+/// 流式处理：按小节窗口依次读入、执行和写出谱面，内存占用只与窗口大小有关。
+///
+/// 每一轮只执行窗口内的根命令。交给ApplicationBus的谱面还包括前一个已写出的小节，
+/// 以及窗口之后至少lookahead个小节；窗口内的命令作用得更远时（成对的结束命令、svfx的长度等），
+/// 继续向后读入直到覆盖为止。窗口之后的小节保留执行结果，在下一轮中接着处理。
+///
+/// 命令的作用超出读入的范围时，结果会与整体处理不同。命令在谱面末尾追加小节时，
+/// 读入剩下的全部小节后重新执行这一轮，追加的小节在之后的轮次中写出。
+class ChartStreamer
+{
+public:
+    struct Options
+    {
+        /// 每一轮执行的小节数
+        int window = 16;
+        /// 窗口之后至少读入的小节数
+        int lookahead = 8;
+    };
+
+private:
+    ApplicationBus& bus;
+    Options options;
+
+    // 读入时传递的拍号
+    int numer = 4, denom = 4;
+    // 已读入、还没有写出的小节。窗口之后的小节是上一轮执行后的结果
+    std::deque<Measure> pending;
+    // 最后写出的小节，作为下一轮的上文
+    std::optional<Measure> context;
+    // 上文之前最后生效的状态标记
+    std::vector<std::optional<Mark>> states;
+    // 已写出的小节数
+    int written = 0;
+    // 输入是否已经读完
+    bool input_done = false;
+
+public:
+    inline ChartStreamer(ApplicationBus& bus, const Options& options) : bus(bus), options(options) {}
+
+    /// 从is读入ksh，处理后写入os。失败时返回false，原因写入error
+    bool Run(std::istream& is, std::ostream& os, std::string& error);
+
+private:
+    /// 读入下一个小节到pending末尾。输入读完时返回false
+    bool ReadMeasure(std::istream& is);
+    /// 由上文和pending组成这一轮处理的谱面
+    Chart BuildSlice(const Header& header) const;
+};
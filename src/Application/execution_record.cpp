@@ -0,0 +1,192 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "execution_record.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "src/FileSystem/path_manager.h"
+#include "src/misc/utilities.h"
+
+using namespace std;
+
+/*
+记录文件格式（文本，每行一项）：
+    KSHRAM-RECORD <版本>
+    lane <编号> <输入哈希> <命令哈希> <输出哈希>
+    failed <时刻> <命令原文>
+    log <时刻> <错误数> <警告数> <命令原文>\t<日志>      （命令原文和日志中的\、换行和\t被转义）
+    depends <内容哈希> <路径>
+    output <输出文件的内容哈希>
+*/
+
+static constexpr int kRecordVersion = 2;
+
+static uint64_t FileHash(const string& path)
+{
+    return HashString(PathManager::LoadFile(path));
+}
+
+std::string ExecutionRecord::PathFor(const std::string& output_path)
+{
+    return output_path + ".kshram";
+}
+
+std::string ExecutionRecord::SnapshotPathFor(const std::string& output_path)
+{
+    return output_path + ".kshsnap";
+}
+
+bool ExecutionRecord::Load(const std::string& path)
+{
+    *this = ExecutionRecord();
+
+    ifstream fs(path);
+    string magic;
+    int version = 0;
+    if (!(fs >> magic >> version) || magic != "KSHRAM-RECORD" || version != kRecordVersion)
+    {
+        return false;
+    }
+
+    int lane_count = 0;
+    string line;
+    while (getline(fs, line))
+    {
+        istringstream ss(line);
+        string kind;
+        ss >> kind;
+        if (kind == "lane")
+        {
+            int lane;
+            LaneRecord record;
+            if (!(ss >> lane >> hex >> record.input >> record.commands >> record.output) || lane < 0 ||
+                lane >= kLaneCount)
+            {
+                return false;
+            }
+            this->lanes[lane] = record;
+            ++lane_count;
+        }
+        else if (kind == "failed")
+        {
+            int time;
+            string text;
+            if (!(ss >> time) || !getline(ss >> ws, text))
+            {
+                return false;
+            }
+            this->failed_commands.emplace(time, text);
+        }
+        else if (kind == "log")
+        {
+            int time;
+            CommandLog log;
+            string rest;
+            if (!(ss >> time >> log.errors >> log.warnings) || !getline(ss >> ws, rest))
+            {
+                return false;
+            }
+            size_t separator = rest.find('\t');
+            if (separator == string::npos)
+            {
+                return false;
+            }
+            log.text = UnescapeLine(rest.substr(separator + 1));
+            this->command_logs.emplace(make_pair(time, UnescapeLine(rest.substr(0, separator))), std::move(log));
+        }
+        else if (kind == "depends")
+        {
+            uint64_t hash;
+            string path;
+            if (!(ss >> hex >> hash) || !getline(ss >> ws, path))
+            {
+                return false;
+            }
+            this->dependencies.emplace_back(path, hash);
+        }
+        else if (kind == "output")
+        {
+            if (!(ss >> hex >> this->output_file))
+            {
+                return false;
+            }
+        }
+    }
+
+    // 表的数量变化说明记录来自其他版本的程序
+    this->valid = lane_count == kLaneCount;
+    return this->valid;
+}
+
+bool ExecutionRecord::Save(const std::string& path) const
+{
+    ofstream fs(path);
+    if (!fs)
+    {
+        return false;
+    }
+
+    fs << "KSHRAM-RECORD " << kRecordVersion << "\n";
+    for (int lane = 0; lane < kLaneCount; ++lane)
+    {
+        const LaneRecord& record = this->lanes[lane];
+        fs << "lane " << lane << hex << " " << record.input << " " << record.commands << " " << record.output
+           << dec << "\n";
+    }
+    for (auto& [time, text] : this->failed_commands)
+    {
+        fs << "failed " << time << " " << text << "\n";
+    }
+    for (auto& [key, log] : this->command_logs)
+    {
+        fs << "log " << key.first << " " << log.errors << " " << log.warnings << " " << EscapeLine(key.second) << "\t"
+           << EscapeLine(log.text) << "\n";
+    }
+    for (auto& [path, hash] : this->dependencies)
+    {
+        fs << "depends " << hex << hash << dec << " " << path << "\n";
+    }
+    fs << "output " << hex << this->output_file << dec << "\n";
+
+    return static_cast<bool>(fs);
+}
+
+void ExecutionRecord::RecordDependencies(const std::vector<std::string>& paths)
+{
+    this->dependencies.clear();
+    for (const string& path : paths)
+    {
+        this->dependencies.emplace_back(path, FileHash(path));
+    }
+}
+
+bool ExecutionRecord::DependenciesUnchanged() const
+{
+    for (auto& [path, hash] : this->dependencies)
+    {
+        if (FileHash(path) != hash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/Chart/indexed_chart.h"
+
+/// 一次执行的记录，保存在输出文件旁边，供下一次增量执行使用。
+///
+/// 按表记录执行前后的内容，以及访问了该表的所有命令。
+/// 下一次执行时，输入和命令都没有变化的表直接使用上一次的输出。
+class ExecutionRecord
+{
+public:
+    static constexpr int kLaneCount = static_cast<int>(IndexedChart::LaneSet().size());
+
+    /// 一个表的记录，均为哈希值
+    struct LaneRecord
+    {
+        /// 执行前的内容
+        uint64_t input = 0;
+        /// 访问这个表的命令（时刻和原文）
+        uint64_t commands = 0;
+        /// 执行后的内容
+        uint64_t output = 0;
+    };
+
+    std::array<LaneRecord, kLaneCount> lanes;
+    /// 根命令执行时产生的日志
+    struct CommandLog
+    {
+        std::string text;
+        int errors = 0;
+        int warnings = 0;
+    };
+
+    /// 执行失败、被写回注释的根命令（时刻，原文）
+    std::multiset<std::pair<int, std::string>> failed_commands;
+    /// 产生了日志的根命令（时刻，原文）。命令被跳过时重放这些日志
+    std::multimap<std::pair<int, std::string>, CommandLog> command_logs;
+    /// 执行时读取的外部文件（路径，内容哈希）。命令原文相同时，这些文件仍可能改变命令的结果
+    std::vector<std::pair<std::string, uint64_t>> dependencies;
+    /// 写出的输出文件的内容哈希。输出文件没有被改动时，上次的输出直接从快照读入
+    uint64_t output_file = 0;
+    /// 是否包含有效的记录
+    bool valid = false;
+
+public:
+    /// 读入记录文件。文件不存在或者格式不符时返回false
+    bool Load(const std::string& path);
+    /// 保存为记录文件
+    bool Save(const std::string& path) const;
+    /// 输出文件对应的记录文件路径
+    static std::string PathFor(const std::string& output_path);
+    /// 输出文件对应的快照文件路径，见ChartSnapshot
+    static std::string SnapshotPathFor(const std::string& output_path);
+
+    /// 记录外部文件当前的内容
+    void RecordDependencies(const std::vector<std::string>& paths);
+    /// 记录的外部文件是否都没有变化
+    bool DependenciesUnchanged() const;
+};
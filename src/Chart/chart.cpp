@@ -79,10 +79,12 @@ bool Chart::ImportFromString(const string& ksh) {
 		return false;
 	}
 
-	// 登记各小节起始时间
-	for (int i = 0; i < this->measures.size(); ++i) {
-		int time = this->measures[i].StartTime();
-		this->measure_at_time.insert(time, i);
+	// 登记小节网格
+	this->grid.Clear();
+	for (const Measure& measure : this->measures) {
+		int numer = 4, denom = 4;
+		measure.GetTimeSignature(numer, denom);
+		this->grid.AppendMeasure(numer, denom, measure.TotalTimespan());
 	}
 
 	return true;
@@ -305,6 +307,86 @@ IndexList<std::string> Chart::OtherItemIndexList() {
 
 /* #endregion */
 
+/* #region 小节范围 */
+
+/// 持续生效的标记。停止和FX音效只作用于所在的时刻，不补写
+static bool IsStateMark(MarkType type) {
+	return type != MarkType::Stop && type != MarkType::FXChip && type != MarkType::FXLong;
+}
+
+void Chart::TrackStateMarks(const Measure& measure, std::vector<std::optional<Mark>>& states) {
+	states.resize(MarkTypesCount);
+	for (int e = 0; e < measure.Length(); ++e) {
+		const Entry& entry = measure[e];
+		for (int i = 0; i < MarkTypesCount; ++i) {
+			MarkType type = MarkByIndex(i);
+			Side side = MarkSideByIndex(i);
+			if (IsStateMark(type) && entry.HasMark(type, side)) {
+				states[i] = *entry.FindLastMark(type, side);
+			}
+		}
+	}
+}
+
+void Chart::ApplyStateMarks(Measure& measure, const std::vector<std::optional<Mark>>& states) {
+	if (measure.Length() == 0) {
+		return;
+	}
+	Entry& head = measure[0];
+	for (const std::optional<Mark>& mark : states) {
+		if (mark.has_value() && !head.HasMark(mark->type, mark->side)) {
+			head.AddMark(*mark);
+		}
+	}
+}
+
+Chart Chart::ExtractMeasures(int first, int last) {
+	Chart slice;
+	slice.header = this->header;
+	slice.custom_fx = this->custom_fx;
+
+	first = std::max(first, 0);
+	last = std::min(last, static_cast<int>(this->measures.size()) - 1);
+	if (first > last) {
+		return slice;
+	}
+
+	for (int i = first; i <= last; ++i) {
+		slice.AppendMeasure(this->measures[i]);
+	}
+
+	// 补写之前最后生效的状态标记
+	std::vector<std::optional<Mark>> states(MarkTypesCount);
+	for (int m = 0; m < first; ++m) {
+		TrackStateMarks(this->measures[m], states);
+	}
+	ApplyStateMarks(slice.measures.front(), states);
+
+	return slice;
+}
+
+bool Chart::ReplaceMeasures(int first, int count, const Chart& slice, int slice_first) {
+	if (first < 0 || slice_first < 0 || first + count > static_cast<int>(this->measures.size())
+		|| slice_first + count > static_cast<int>(slice.measures.size())) {
+		return false;
+	}
+	for (int i = 0; i < count; ++i) {
+		if (this->measures[first + i].TotalTimespan() != slice.measures[slice_first + i].TotalTimespan()) {
+			return false;
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		Measure& measure = this->measures[first + i];
+		const int start_time = measure.StartTime();
+		measure = slice.measures[slice_first + i];
+		measure.StartTime() = start_time;
+	}
+	return true;
+}
+
+/* #endregion */
+
 /* #endregion */
 
 /* #region EntryIterator */
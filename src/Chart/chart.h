@@ -20,9 +20,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <optional>
+#include <vector>
+
 #include "src/Measure/measure.h"
 #include "src/Header/header.h"
 #include "src/IndexList/index_list.h"
+#include "measure_grid.h"
 
 // 暂时先这么弄，如果要做自定义fx的编辑再细化。
 using CustomFX = std::string;
@@ -40,8 +44,8 @@ private:
 	// 自定义FX
 	CustomFX custom_fx;
 
-	// 小节起始时间反查表
-	IndexList<int> measure_at_time;
+	// 小节网格（时间与小节的换算）
+	MeasureGrid grid;
 
 public:
 	Chart() = default;
@@ -91,6 +95,9 @@ public:
 	/// 谱面总长
 	inline int TotalTime();
 
+	/// 获取小节网格
+	inline const MeasureGrid& Grid() const;
+
 
 public:
 
@@ -118,6 +125,23 @@ public:
 	/// 在末尾加入小节
 	inline void AppendMeasure(Measure& measure);
 
+public:
+	/// @brief 取出一段小节组成新的谱面。头和自定义fx被复制，
+	/// 在first之前最后生效的BPM、拍号等状态标记补写在新谱面的第一条记录上。
+	/// @param first 起始小节序号（从0开始）
+	/// @param last 结束小节序号（包括在内）
+	Chart ExtractMeasures(int first, int last);
+
+	/// 将measure中持续生效的标记（BPM、拍号等）记入states，states按MarkIndex排列
+	static void TrackStateMarks(const Measure& measure, std::vector<std::optional<Mark>>& states);
+
+	/// 将states中的标记补写在measure的第一条记录上，已有同类标记时不补写
+	static void ApplyStateMarks(Measure& measure, const std::vector<std::optional<Mark>>& states);
+
+	/// 用slice中自slice_first开始的count个小节替换自first开始的小节。
+	/// 对应小节的长度不一致时不做替换，返回false。
+	bool ReplaceMeasures(int first, int count, const Chart& slice, int slice_first);
+
 public:
 	/// 逐个Entry访问的迭代器
 	class EntryIterator {
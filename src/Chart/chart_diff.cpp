@@ -0,0 +1,77 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_diff.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <ostream>
+
+using namespace std;
+
+/// 整个字符串是否为一个数值
+static bool ParseNumber(const string& text, double& value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size();
+}
+
+bool ChartDiff::SameValue(const std::string& a, const std::string& b) const
+{
+    if (a == b)
+    {
+        return true;
+    }
+    double num_a = 0.0, num_b = 0.0;
+    return ParseNumber(a, num_a) && ParseNumber(b, num_b) && fabs(num_a - num_b) <= this->tolerance;
+}
+
+bool ChartDiff::SameValue(const SpinEffect& a, const SpinEffect& b) const
+{
+    return DiffValueEqual(a, b);
+}
+
+void ChartDiff::AddEvent(std::string_view lane, int time, Kind kind, std::string old_value, std::string new_value)
+{
+    this->events.push_back(Event{string(lane), time, kind, std::move(old_value), std::move(new_value)});
+    ++this->kind_counts[static_cast<int>(kind)];
+}
+
+void ChartDiff::Print(std::ostream& os) const
+{
+    for (const Event& event : this->events)
+    {
+        os << event.lane << " @" << event.time << ": ";
+        switch (event.kind)
+        {
+        case Kind::Added: os << "+ " << event.new_value; break;
+        case Kind::Removed: os << "- " << event.old_value; break;
+        case Kind::Changed: os << event.old_value << " -> " << event.new_value; break;
+        }
+        os << "\n";
+    }
+    os << this->Count(Kind::Added) << " added, " << this->Count(Kind::Removed) << " removed, "
+       << this->Count(Kind::Changed) << " changed.\n";
+}
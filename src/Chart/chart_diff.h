@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/IndexList/index_list.h"
+#include "src/Entry/entry.h"
+
+/// @brief
+/// 两张IndexedChart之间按表比较的差异。
+///
+/// 对应的两个表按时刻归并，线性时间内得到每个表中新增、删除和改变的记录。
+/// 标记等字符串值在两边都是数值时按容差比较，因此"1.5"和"1.50"视为相同。
+/// 通过IndexedChart::DiffWith填充，IndexedChart::SameAs则只判断是否完全相同。
+class ChartDiff
+{
+public:
+    enum class Kind
+    {
+        Added,
+        Removed,
+        Changed
+    };
+
+    /// 一条差异
+    struct Event
+    {
+        /// 表名，与IndexedChart文本格式的section名相同
+        std::string lane;
+        int time;
+        Kind kind;
+        /// 原值。新增的记录为空。突变记录写作"突变前, 突变后"
+        std::string old_value;
+        /// 新值。删除的记录为空
+        std::string new_value;
+    };
+
+private:
+    double tolerance;
+    std::vector<Event> events;
+    std::size_t kind_counts[3] = {};
+
+public:
+    /// tolerance为数值比较的容差
+    inline explicit ChartDiff(double tolerance = 0.0);
+
+    /// 归并比较两个表，差异追加到末尾
+    template <typename T>
+    void CompareLane(std::string_view lane, const IndexList<T>& old_lst, const IndexList<T>& new_lst);
+
+    /// 两个表是否完全相同（不使用容差）。遇到第一处不同即返回
+    template <typename T>
+    static bool SameLane(const IndexList<T>& a, const IndexList<T>& b);
+
+    /// 是否没有差异
+    inline bool Empty() const;
+    /// 全部差异，按表和时刻排列
+    inline const std::vector<Event>& Events() const;
+    /// 某一类差异的数量
+    inline std::size_t Count(Kind kind) const;
+
+    /// 逐行打印差异，最后一行为统计
+    void Print(std::ostream& os) const;
+
+private:
+    /// 两个值在容差内是否相同
+    bool SameValue(int a, int b) const { return a == b; }
+    bool SameValue(const std::string& a, const std::string& b) const;
+    bool SameValue(const SpinEffect& a, const SpinEffect& b) const;
+
+    /// 记录的文本形式
+    template <typename T>
+    static std::string FormatEntry(const PairEntry<T>& entry);
+
+    void AddEvent(std::string_view lane, int time, Kind kind, std::string old_value, std::string new_value);
+};
+
+/* INLINE FUNCTION */
+
+#include "chart_diff_inline.h"
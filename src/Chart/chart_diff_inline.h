@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_diff.h"
+
+#include <string>
+#include <utility>
+
+inline ChartDiff::ChartDiff(double tolerance) : tolerance(tolerance) {}
+
+inline bool ChartDiff::Empty() const
+{
+    return this->events.empty();
+}
+
+inline const std::vector<ChartDiff::Event>& ChartDiff::Events() const
+{
+    return this->events;
+}
+
+inline std::size_t ChartDiff::Count(Kind kind) const
+{
+    return this->kind_counts[static_cast<int>(kind)];
+}
+
+/* #region 值的格式 */
+
+inline std::string DiffValueString(int value)
+{
+    return std::to_string(value);
+}
+
+inline const std::string& DiffValueString(const std::string& value)
+{
+    return value;
+}
+
+inline std::string DiffValueString(const SpinEffect& value)
+{
+    return value.ToString();
+}
+
+/// 两个值是否完全相同
+template <typename T>
+inline bool DiffValueEqual(const T& a, const T& b)
+{
+    return a == b;
+}
+
+inline bool DiffValueEqual(const SpinEffect& a, const SpinEffect& b)
+{
+    return a.ToString() == b.ToString();
+}
+
+template <typename T>
+std::string ChartDiff::FormatEntry(const PairEntry<T>& entry)
+{
+    std::string text(DiffValueString(entry.first()));
+    if (!entry.isSame())
+    {
+        text += ", ";
+        text += DiffValueString(entry.second());
+    }
+    return text;
+}
+
+/* #endregion */
+
+/* #region 归并比较 */
+
+template <typename T>
+void ChartDiff::CompareLane(std::string_view lane, const IndexList<T>& old_lst, const IndexList<T>& new_lst)
+{
+    auto old_iter = old_lst.begin(), new_iter = new_lst.begin();
+    while (old_iter != old_lst.end() || new_iter != new_lst.end())
+    {
+        if (new_iter == new_lst.end() || (old_iter != old_lst.end() && old_iter->first < new_iter->first))
+        {
+            this->AddEvent(lane, old_iter->first, Kind::Removed, FormatEntry(old_iter->second), std::string());
+            ++old_iter;
+        }
+        else if (old_iter == old_lst.end() || new_iter->first < old_iter->first)
+        {
+            this->AddEvent(lane, new_iter->first, Kind::Added, std::string(), FormatEntry(new_iter->second));
+            ++new_iter;
+        }
+        else
+        {
+            const auto& a = old_iter->second;
+            const auto& b = new_iter->second;
+            if (!this->SameValue(a.first(), b.first()) || !this->SameValue(a.second(), b.second()))
+            {
+                this->AddEvent(lane, old_iter->first, Kind::Changed, FormatEntry(a), FormatEntry(b));
+            }
+            ++old_iter;
+            ++new_iter;
+        }
+    }
+}
+
+template <typename T>
+bool ChartDiff::SameLane(const IndexList<T>& a, const IndexList<T>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (auto iter_a = a.begin(), iter_b = b.begin(); iter_a != a.end(); ++iter_a, ++iter_b)
+    {
+        if (iter_a->first != iter_b->first || !DiffValueEqual(iter_a->second.first(), iter_b->second.first()) ||
+            !DiffValueEqual(iter_a->second.second(), iter_b->second.second()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* #endregion */
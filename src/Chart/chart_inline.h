@@ -20,6 +20,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "chart.h"
 #include "src/FileSystem/path_manager.h"
 
@@ -65,7 +67,9 @@ inline Entry& Chart::operator()(int measure_id, int entry_id)
 
 inline int Chart::MeasureIDAtTime(int time)
 {
-    return this->measure_at_time.prevItem(time)->second.first();
+    // 超出范围时取首尾小节
+    int measure_id = this->grid.MeasureIDAtTime(time);
+    return std::max(0, std::min(measure_id, static_cast<int>(this->measures.size()) - 1));
 }
 
 inline Measure& Chart::MeasureAtTime(int time)
@@ -119,11 +123,20 @@ inline int Chart::TotalTime()
     }
 }
 
+inline const MeasureGrid& Chart::Grid() const
+{
+    return this->grid;
+}
+
 inline void Chart::AppendMeasure(Measure& measure)
 {
     int start_time = this->TotalTime();
     this->measures.push_back(measure);
     this->measures.back().StartTime() = start_time;
+
+    int numer = 4, denom = 4;
+    measure.GetTimeSignature(numer, denom);
+    this->grid.AppendMeasure(numer, denom, measure.TotalTimespan());
 }
 
 /* #endregion */
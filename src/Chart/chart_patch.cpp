@@ -0,0 +1,521 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_patch.h"
+
+#include <deque>
+#include <sstream>
+
+#include "src/misc/utilities.h"
+
+using namespace std;
+
+/*
+补丁文件为文本，每行一项：
+    KSHRAM-PATCH <版本>
+    measures <原小节数> <新小节数>
+    header <原哈希> <新文本>
+    measure <序号> <原哈希> <新文本>
+    tail <原哈希> <新文本>
+    edit header <原哈希>              （行级改动，后面接着各处改动）
+    edit measure <序号> <原哈希>
+    edit tail <原哈希>
+    hunk <起始行> <行数> <新文本>
+哈希为十六进制，新文本经过EscapeLine转义。行号从0开始，指原文本中的行。
+*/
+
+static constexpr int kPatchVersion = 2;
+/// 原文本和新文本行数的乘积超过这个值时不再逐行比较，只去掉首尾相同的行
+static constexpr size_t kMaxDiffCells = size_t(1) << 22;
+/// 每处行级改动在补丁文件中除文本以外大约占用的长度
+static constexpr size_t kHunkOverhead = 16;
+
+/// ksh文本切分后的各部分，均指向原文本
+struct ChartParts
+{
+    string_view header;
+    vector<string_view> measures;
+    string_view tail;
+};
+
+/// 按"--"行切分。每一部分包括结尾的"--"行
+static ChartParts SplitChart(string_view ksh)
+{
+    ChartParts parts;
+    bool in_header = true;
+    size_t part_start = 0, line_start = 0;
+    while (line_start < ksh.size())
+    {
+        size_t line_end = ksh.find('\n', line_start);
+        line_end = line_end == string_view::npos ? ksh.size() : line_end + 1;
+
+        string_view line = ksh.substr(line_start, line_end - line_start);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        {
+            line.remove_suffix(1);
+        }
+        if (line == "--")
+        {
+            string_view part = ksh.substr(part_start, line_end - part_start);
+            if (in_header)
+            {
+                parts.header = part;
+                in_header = false;
+            }
+            else
+            {
+                parts.measures.push_back(part);
+            }
+            part_start = line_end;
+        }
+        line_start = line_end;
+    }
+
+    // 没有"--"行时全部视为谱面头
+    if (in_header)
+    {
+        parts.header = ksh;
+    }
+    else
+    {
+        parts.tail = ksh.substr(part_start);
+    }
+    return parts;
+}
+
+/// 去掉回车和BOM之后的哈希值
+static uint64_t PartHash(string_view part)
+{
+    if (part.substr(0, 3) == "\xEF\xBB\xBF")
+    {
+        part.remove_prefix(3);
+    }
+    uint64_t hash = kHashSeed;
+    for (char c : part)
+    {
+        if (c != '\r')
+        {
+            HashBytes(hash, &c, 1);
+        }
+    }
+    return hash;
+}
+
+/// 切分为行，每行包括结尾的换行
+static vector<string_view> SplitLines(string_view text)
+{
+    vector<string_view> lines;
+    size_t line_start = 0;
+    while (line_start < text.size())
+    {
+        size_t line_end = text.find('\n', line_start);
+        line_end = line_end == string_view::npos ? text.size() : line_end + 1;
+        lines.push_back(text.substr(line_start, line_end - line_start));
+        line_start = line_end;
+    }
+    return lines;
+}
+
+/// 比较用的行内容，与PartHash一样忽略回车
+static string LineKey(string_view line)
+{
+    string key;
+    key.reserve(line.size());
+    for (char c : line)
+    {
+        if (c != '\r')
+        {
+            key += c;
+        }
+    }
+    return key;
+}
+
+/// 逐行比较两段文本，得到从old_part到new_part的行级改动
+static vector<ChartPatch::Hunk> DiffLines(string_view old_part, string_view new_part)
+{
+    const vector<string_view> old_lines = SplitLines(old_part), new_lines = SplitLines(new_part);
+    vector<string> old_keys, new_keys;
+    for (string_view line : old_lines)
+    {
+        old_keys.push_back(LineKey(line));
+    }
+    for (string_view line : new_lines)
+    {
+        new_keys.push_back(LineKey(line));
+    }
+
+    // 去掉首尾相同的行
+    size_t prefix = 0, suffix = 0;
+    while (prefix < old_keys.size() && prefix < new_keys.size() && old_keys[prefix] == new_keys[prefix])
+    {
+        ++prefix;
+    }
+    while (suffix < old_keys.size() - prefix && suffix < new_keys.size() - prefix &&
+           old_keys[old_keys.size() - 1 - suffix] == new_keys[new_keys.size() - 1 - suffix])
+    {
+        ++suffix;
+    }
+    const size_t n = old_keys.size() - prefix - suffix, m = new_keys.size() - prefix - suffix;
+
+    vector<ChartPatch::Hunk> hunks;
+    auto add_hunk = [&](size_t old_begin, size_t old_end, size_t new_begin, size_t new_end) {
+        if (old_begin == old_end && new_begin == new_end)
+        {
+            return;
+        }
+        string text;
+        for (size_t j = new_begin; j < new_end; ++j)
+        {
+            text += new_lines[prefix + j];
+        }
+        hunks.push_back(ChartPatch::Hunk{static_cast<int>(prefix + old_begin), static_cast<int>(old_end - old_begin),
+                                         std::move(text)});
+    };
+    if (n == 0 || m == 0 || n * m > kMaxDiffCells)
+    {
+        add_hunk(0, n, 0, m);
+        return hunks;
+    }
+
+    // 最长公共子序列。lcs[i * (m + 1) + j]为两段中间部分分别从第i、j行起的公共行数
+    vector<uint32_t> lcs((n + 1) * (m + 1), 0);
+    auto at = [m](size_t i, size_t j) { return i * (m + 1) + j; };
+    for (size_t i = n; i-- > 0;)
+    {
+        for (size_t j = m; j-- > 0;)
+        {
+            lcs[at(i, j)] = old_keys[prefix + i] == new_keys[prefix + j] ? lcs[at(i + 1, j + 1)] + 1
+                                                                         : max(lcs[at(i + 1, j)], lcs[at(i, j + 1)]);
+        }
+    }
+
+    // 沿公共子序列走一遍，不在其中的连续行组成一处改动
+    size_t i = 0, j = 0, old_begin = 0, new_begin = 0;
+    while (i < n || j < m)
+    {
+        if (i < n && j < m && old_keys[prefix + i] == new_keys[prefix + j])
+        {
+            add_hunk(old_begin, i, new_begin, j);
+            old_begin = ++i;
+            new_begin = ++j;
+        }
+        else if (j < m && (i == n || lcs[at(i, j + 1)] >= lcs[at(i + 1, j)]))
+        {
+            ++j;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    add_hunk(old_begin, n, new_begin, m);
+    return hunks;
+}
+
+/// 在old_part上应用行级改动。改动的位置超出范围或者互相重叠时返回false
+static bool ApplyHunks(string_view old_part, const vector<ChartPatch::Hunk>& hunks, string& output)
+{
+    const vector<string_view> lines = SplitLines(old_part);
+    size_t next = 0;
+    for (const ChartPatch::Hunk& hunk : hunks)
+    {
+        if (hunk.start < 0 || hunk.count < 0 || static_cast<size_t>(hunk.start) < next ||
+            static_cast<size_t>(hunk.start) + hunk.count > lines.size())
+        {
+            return false;
+        }
+        for (; next < static_cast<size_t>(hunk.start); ++next)
+        {
+            output += lines[next];
+        }
+        output += hunk.text;
+        next += hunk.count;
+    }
+    for (; next < lines.size(); ++next)
+    {
+        output += lines[next];
+    }
+    return true;
+}
+
+ChartPatch ChartPatch::Diff(std::string_view old_ksh, std::string_view new_ksh)
+{
+    ChartParts old_parts = SplitChart(old_ksh), new_parts = SplitChart(new_ksh);
+    ChartPatch patch;
+    patch.old_measure_count = static_cast<int>(old_parts.measures.size());
+    patch.new_measure_count = static_cast<int>(new_parts.measures.size());
+
+    auto compare = [&patch](int index, string_view old_part, string_view new_part) {
+        uint64_t old_hash = PartHash(old_part);
+        if (old_hash == PartHash(new_part))
+        {
+            return;
+        }
+        // 行级改动更短时只记录改动的行
+        vector<Hunk> hunks = DiffLines(old_part, new_part);
+        size_t hunks_size = 0;
+        for (const Hunk& hunk : hunks)
+        {
+            hunks_size += hunk.text.size() + kHunkOverhead;
+        }
+        if (hunks_size < new_part.size())
+        {
+            patch.changes.push_back(Change{index, old_hash, string(), std::move(hunks)});
+        }
+        else
+        {
+            patch.changes.push_back(Change{index, old_hash, string(new_part), {}});
+        }
+    };
+
+    compare(kHeader, old_parts.header, new_parts.header);
+    for (int i = 0; i < patch.new_measure_count; ++i)
+    {
+        if (i < patch.old_measure_count)
+        {
+            compare(i, old_parts.measures[i], new_parts.measures[i]);
+        }
+        else
+        {
+            patch.changes.push_back(Change{i, 0, string(new_parts.measures[i]), {}});
+        }
+    }
+    compare(kTail, old_parts.tail, new_parts.tail);
+    return patch;
+}
+
+bool ChartPatch::Apply(std::string_view old_ksh, std::string& output, std::string& error) const
+{
+    ChartParts parts = SplitChart(old_ksh);
+    if (static_cast<int>(parts.measures.size()) != this->old_measure_count)
+    {
+        error = "The chart has " + to_string(parts.measures.size()) + " measures, but the patch expects " +
+                to_string(this->old_measure_count) + ".";
+        return false;
+    }
+
+    // 新增的小节必须都由补丁给出
+    vector<bool> provided(this->new_measure_count, false);
+    for (int i = 0; i < min(this->old_measure_count, this->new_measure_count); ++i)
+    {
+        provided[i] = true;
+    }
+    parts.measures.resize(this->new_measure_count);
+    // 应用了行级改动的部分
+    deque<string> edited;
+
+    for (const Change& change : this->changes)
+    {
+        string_view* target = change.index == kHeader ? &parts.header
+                              : change.index == kTail ? &parts.tail
+                              : (change.index >= 0 && change.index < this->new_measure_count)
+                                  ? &parts.measures[change.index]
+                                  : nullptr;
+        if (target == nullptr)
+        {
+            error = "Measure " + to_string(change.index) + " is out of range.";
+            return false;
+        }
+        bool is_new_measure = change.index >= this->old_measure_count && change.index != kTail;
+        if (is_new_measure && !change.hunks.empty())
+        {
+            error = "Measure " + to_string(change.index) + " is new but the patch edits its lines.";
+            return false;
+        }
+        if (!is_new_measure && PartHash(*target) != change.old_hash)
+        {
+            error = change.index == kHeader ? "The header has been changed since the patch was made."
+                    : change.index == kTail ? "The custom effects have been changed since the patch was made."
+                                            : "Measure " + to_string(change.index) +
+                                                  " has been changed since the patch was made.";
+            return false;
+        }
+        if (change.hunks.empty())
+        {
+            *target = change.text;
+        }
+        else
+        {
+            edited.emplace_back();
+            if (!ApplyHunks(*target, change.hunks, edited.back()))
+            {
+                error = "The line edits of part " + to_string(change.index) + " are out of range.";
+                return false;
+            }
+            *target = edited.back();
+        }
+        if (change.index >= 0 && change.index < this->new_measure_count)
+        {
+            provided[change.index] = true;
+        }
+    }
+
+    for (int i = 0; i < this->new_measure_count; ++i)
+    {
+        if (!provided[i])
+        {
+            error = "Measure " + to_string(i) + " is missing from the patch.";
+            return false;
+        }
+    }
+
+    output.clear();
+    output += parts.header;
+    for (string_view measure : parts.measures)
+    {
+        output += measure;
+    }
+    output += parts.tail;
+    return true;
+}
+
+std::string ChartPatch::ExportToString() const
+{
+    ostringstream ss;
+    ss << "KSHRAM-PATCH " << kPatchVersion << "\n";
+    ss << "measures " << this->old_measure_count << " " << this->new_measure_count << "\n";
+    for (const Change& change : this->changes)
+    {
+        if (!change.hunks.empty())
+        {
+            ss << "edit ";
+        }
+        if (change.index == kHeader)
+        {
+            ss << "header ";
+        }
+        else if (change.index == kTail)
+        {
+            ss << "tail ";
+        }
+        else
+        {
+            ss << "measure " << change.index << " ";
+        }
+        ss << hex << change.old_hash << dec;
+        if (change.hunks.empty())
+        {
+            ss << " " << EscapeLine(change.text) << "\n";
+            continue;
+        }
+        ss << "\n";
+        for (const Hunk& hunk : change.hunks)
+        {
+            ss << "hunk " << hunk.start << " " << hunk.count << " " << EscapeLine(hunk.text) << "\n";
+        }
+    }
+    return ss.str();
+}
+
+bool ChartPatch::ImportFromString(const std::string& content)
+{
+    istringstream fs(content);
+    string magic;
+    int version = 0;
+    if (!(fs >> magic >> version) || magic != "KSHRAM-PATCH" || version != kPatchVersion)
+    {
+        return false;
+    }
+
+    *this = ChartPatch();
+    bool has_counts = false;
+    // 上一项是否为还没有读到改动的行级改动
+    bool editing = false;
+    string line;
+    while (getline(fs, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        istringstream ss(line);
+        string kind;
+        if (!(ss >> kind))
+        {
+            continue;
+        }
+
+        if (kind == "hunk")
+        {
+            Hunk hunk;
+            string text;
+            if (!editing || !(ss >> hunk.start >> hunk.count))
+            {
+                return false;
+            }
+            getline(ss, text);
+            hunk.text = UnescapeLine(text.empty() ? text : text.substr(1));
+            this->changes.back().hunks.push_back(std::move(hunk));
+            continue;
+        }
+        // 行级改动至少有一处
+        if (editing && this->changes.back().hunks.empty())
+        {
+            return false;
+        }
+        editing = false;
+
+        if (kind == "measures")
+        {
+            has_counts = static_cast<bool>(ss >> this->old_measure_count >> this->new_measure_count);
+            continue;
+        }
+
+        if (kind == "edit")
+        {
+            editing = true;
+            if (!(ss >> kind))
+            {
+                return false;
+            }
+        }
+        Change change;
+        if (kind == "header")
+        {
+            change.index = kHeader;
+        }
+        else if (kind == "tail")
+        {
+            change.index = kTail;
+        }
+        else if (kind != "measure" || !(ss >> change.index))
+        {
+            return false;
+        }
+        if (!(ss >> hex >> change.old_hash >> dec))
+        {
+            return false;
+        }
+        if (!editing)
+        {
+            // 哈希之后恰好有一个空格，文本本身可能以空白开头
+            string text;
+            getline(ss, text);
+            change.text = UnescapeLine(text.empty() ? text : text.substr(1));
+        }
+        this->changes.push_back(std::move(change));
+    }
+    if (editing && this->changes.back().hunks.empty())
+    {
+        return false;
+    }
+    return has_counts && this->old_measure_count >= 0 && this->new_measure_count >= 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief
+/// 两份ksh文本之间以小节为单位的差异。
+///
+/// 文本按"--"行切分为谱面头、各小节和结尾（自定义效果的定义）。补丁只记录有变化的部分，
+/// 每一项为位置、原文本的哈希值，以及新文本或者部分内的行级改动（取较短的一种）。
+/// 应用时先核对原文本的哈希值，不一致时拒绝应用。
+/// 比较时忽略回车和开头的BOM，应用时没有变化的部分和行保留原文。
+class ChartPatch
+{
+public:
+    /// 谱面头的位置
+    static constexpr int kHeader = -1;
+    /// 结尾的位置
+    static constexpr int kTail = INT_MAX;
+
+    /// 一处行级改动：将原文本从第start行起的count行替换为text（可以是多行，也可以为空）
+    struct Hunk
+    {
+        int start;
+        int count;
+        std::string text;
+    };
+
+    /// 有变化的一部分
+    struct Change
+    {
+        /// 小节序号，或者kHeader、kTail
+        int index;
+        /// 原文本的哈希值。新增的小节为0
+        uint64_t old_hash;
+        /// 新文本。hunks不为空时不使用
+        std::string text;
+        /// 行级改动，按行号排列。不为空时在原文本上逐处替换
+        std::vector<Hunk> hunks;
+    };
+
+private:
+    int old_measure_count = 0;
+    int new_measure_count = 0;
+    std::vector<Change> changes;
+
+public:
+    /// 比较两份ksh文本，得到从old_ksh到new_ksh的补丁
+    static ChartPatch Diff(std::string_view old_ksh, std::string_view new_ksh);
+
+    /// 对old_ksh应用补丁，结果写入output。原文本与补丁不符时返回false，原因写入error
+    bool Apply(std::string_view old_ksh, std::string& output, std::string& error) const;
+
+    /// 是否没有任何变化
+    bool Empty() const { return this->changes.empty() && this->old_measure_count == this->new_measure_count; }
+    /// 有变化的各部分，按位置排列
+    const std::vector<Change>& Changes() const { return this->changes; }
+
+    /// 导出为补丁文件的文本
+    std::string ExportToString() const;
+    /// 读入补丁文件。格式不符时返回false
+    bool ImportFromString(const std::string& content);
+};
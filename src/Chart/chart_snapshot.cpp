@@ -0,0 +1,291 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_snapshot.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "src/misc/utilities.h"
+
+#if defined(WIN32) || defined(WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static constexpr char kMagic[8] = {'K', 'S', 'H', 'S', 'N', 'A', 'P', '\0'};
+static constexpr uint32_t kByteOrder = 0x01020304;
+static constexpr size_t kAlignment = 8;
+
+static void PadTo(string& buffer, size_t alignment)
+{
+    buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+static uint64_t Checksum(const char* data, size_t size)
+{
+    uint64_t hash = kHashSeed;
+    HashBytes(hash, data, size);
+    return hash;
+}
+
+/* #region Builder */
+
+ChartSnapshot::StringRef ChartSnapshot::Builder::AddString(const std::string& str)
+{
+    StringRef ref{static_cast<uint32_t>(this->pool.size()), static_cast<uint32_t>(str.size())};
+    this->pool += str;
+    return ref;
+}
+
+void ChartSnapshot::Builder::AddLane(ValueKind kind, const void* items, size_t count, size_t item_size)
+{
+    const char* bytes = static_cast<const char*>(items);
+    LaneHeader header{this->lanes.size(), static_cast<uint32_t>(count), kind, Checksum(bytes, count * item_size)};
+    this->lane_headers.push_back(header);
+    this->lanes.append(bytes, count * item_size);
+    PadTo(this->lanes, kAlignment);
+}
+
+std::string ChartSnapshot::Builder::Finish() const
+{
+    const size_t lanes_offset = sizeof(Header) + sizeof(LaneHeader) * this->lane_headers.size();
+    const size_t pool_offset = lanes_offset + this->lanes.size();
+
+    Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.lane_count = static_cast<uint32_t>(this->lane_headers.size());
+    header.total_time = this->total_time;
+    header.pool_offset = pool_offset;
+    header.pool_size = this->pool.size();
+    header.pool_checksum = Checksum(this->pool.data(), this->pool.size());
+    header.table_checksum = 0;
+
+    string output;
+    output.reserve(pool_offset + this->pool.size());
+    output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (LaneHeader lane : this->lane_headers)
+    {
+        lane.offset += lanes_offset;
+        output.append(reinterpret_cast<const char*>(&lane), sizeof(lane));
+    }
+    header.table_checksum = Checksum(output.data(), output.size());
+    memcpy(&output[offsetof(Header, table_checksum)], &header.table_checksum, sizeof(header.table_checksum));
+    output += this->lanes;
+    output += this->pool;
+    return output;
+}
+
+/* #endregion */
+
+/* #region Reader */
+
+ChartSnapshot::~ChartSnapshot()
+{
+    this->Close();
+}
+
+void ChartSnapshot::Close()
+{
+    if (this->mapped)
+    {
+#if defined(WIN32) || defined(WIN64)
+        UnmapViewOfFile(this->data);
+#else
+        munmap(const_cast<char*>(this->data), this->size);
+#endif
+    }
+    this->owned.clear();
+    this->data = nullptr;
+    this->size = 0;
+    this->mapped = false;
+}
+
+bool ChartSnapshot::Assign(std::string content)
+{
+    this->Close();
+    this->owned = std::move(content);
+    this->data = this->owned.data();
+    this->size = this->owned.size();
+    if (!this->Verify())
+    {
+        this->Close();
+        return false;
+    }
+    return true;
+}
+
+bool ChartSnapshot::Open(const std::string& path)
+{
+    this->Close();
+
+#if defined(WIN32) || defined(WIN64)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+        return false;
+    }
+    // 映射的视图在句柄关闭之后仍然有效
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr)
+    {
+        return false;
+    }
+    this->size = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+    this->size = static_cast<size_t>(st.st_size);
+#endif
+
+    this->data = static_cast<const char*>(view);
+    this->mapped = true;
+    if (!this->Verify())
+    {
+        this->Close();
+        return false;
+    }
+    return true;
+}
+
+bool ChartSnapshot::Save(const std::string& path, const std::string& content)
+{
+    // 先写入临时文件再改名，已经映射了旧文件的读者不受影响
+    const string temp = path + ".tmp";
+    {
+        ofstream fs(temp, ios::binary | ios::trunc);
+        if (!fs || !fs.write(content.data(), static_cast<streamsize>(content.size())))
+        {
+            return false;
+        }
+    }
+    error_code ec;
+    filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ChartSnapshot::Verify() const
+{
+    if (this->size < sizeof(Header))
+    {
+        return false;
+    }
+    const Header& header = this->GetHeader();
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byte_order != kByteOrder)
+    {
+        return false;
+    }
+
+    // 先检查范围，再计算校验值，避免读到文件之外
+    if (header.lane_count > (this->size - sizeof(Header)) / sizeof(LaneHeader) ||
+        header.pool_offset > this->size || header.pool_size > this->size - header.pool_offset)
+    {
+        return false;
+    }
+    if (Checksum(this->data + header.pool_offset, header.pool_size) != header.pool_checksum)
+    {
+        return false;
+    }
+    // 总时长等没有其他校验的字段由表头的校验值覆盖
+    string table(this->data, sizeof(Header) + sizeof(LaneHeader) * header.lane_count);
+    memset(&table[offsetof(Header, table_checksum)], 0, sizeof(header.table_checksum));
+    if (Checksum(table.data(), table.size()) != header.table_checksum)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.lane_count; ++i)
+    {
+        const LaneHeader& lane = this->GetLaneHeader(i);
+        size_t item_size = lane.kind == IntValue      ? sizeof(IntItem)
+                           : lane.kind == StringValue ? sizeof(StringItem)
+                           : lane.kind == SpinValue   ? sizeof(SpinItem)
+                                                      : 0;
+        if (item_size == 0 || lane.offset % kAlignment != 0 || lane.offset > header.pool_offset ||
+            lane.count > (header.pool_offset - lane.offset) / item_size)
+        {
+            return false;
+        }
+        if (Checksum(this->data + lane.offset, lane.count * item_size) != lane.checksum)
+        {
+            return false;
+        }
+        // 字符串的位置都要落在字符串池之内
+        if (lane.kind == StringValue)
+        {
+            const StringItem* items = reinterpret_cast<const StringItem*>(this->data + lane.offset);
+            for (uint32_t j = 0; j < lane.count; ++j)
+            {
+                for (const StringRef& ref : {items[j].first, items[j].second})
+                {
+                    if (ref.offset > header.pool_size || ref.size > header.pool_size - ref.offset)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* #endregion */
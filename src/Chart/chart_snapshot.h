@@ -0,0 +1,183 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/Entry/entry.h"
+#include "src/IndexList/index_list.h"
+
+/// @brief
+/// IndexedChart的二进制快照。
+///
+/// 文件依次为文件头、各表的表头、各表的定长记录数组和字符串池，所有数据按本机字节序存放，
+/// 并对齐到8字节。文件可以直接映射到内存读取，读入时不需要逐条解析文本。
+/// 表头、各表和字符串池分别有校验值，打开时检查。
+///
+/// 快照只用于缓存等本机上的用途，不保证在不同的平台之间通用。
+class ChartSnapshot
+{
+public:
+    static constexpr uint32_t kVersion = 2;
+
+    /// 表中记录的类型
+    enum ValueKind : uint32_t
+    {
+        IntValue,
+        StringValue,
+        SpinValue,
+    };
+
+    /// 文件头
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        /// 写入时的字节序标记，读入时不符说明来自其他平台
+        uint32_t byte_order;
+        uint32_t lane_count;
+        int32_t total_time;
+        uint64_t pool_offset;
+        uint64_t pool_size;
+        uint64_t pool_checksum;
+        /// 文件头（本项记为0）和各表表头的校验值
+        uint64_t table_checksum;
+    };
+
+    /// 表头
+    struct LaneHeader
+    {
+        uint64_t offset;
+        uint32_t count;
+        uint32_t kind;
+        uint64_t checksum;
+    };
+
+    /// 字符串在字符串池中的位置
+    struct StringRef
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /// 回转特效的各项参数
+    struct SpinData
+    {
+        int32_t spin;
+        int32_t side;
+        int32_t length;
+        int32_t params[3];
+    };
+
+    /// 一条记录：时刻、是否为单个值，以及前后两个值
+    template <typename V>
+    struct Item
+    {
+        int32_t time;
+        int32_t same;
+        V first;
+        V second;
+    };
+
+    using IntItem = Item<int32_t>;
+    using StringItem = Item<StringRef>;
+    using SpinItem = Item<SpinData>;
+
+    /// 逐表写入快照
+    class Builder
+    {
+    private:
+        std::vector<LaneHeader> lane_headers;
+        /// 各表的记录，表头中的位置暂时相对于这里
+        std::string lanes;
+        std::string pool;
+        int total_time = 0;
+
+        StringRef AddString(const std::string& str);
+        void AddLane(ValueKind kind, const void* items, size_t count, size_t item_size);
+
+    public:
+        explicit Builder(int total_time) : total_time(total_time) {}
+
+        /// 按编号顺序添加下一个表
+        inline void AddLane(const IndexList<int>& lst);
+        /// 按编号顺序添加下一个表
+        inline void AddLane(const IndexList<std::string>& lst);
+        /// 按编号顺序添加下一个表
+        inline void AddLane(const IndexList<SpinEffect>& lst);
+
+        /// 生成快照的全部内容
+        std::string Finish() const;
+    };
+
+private:
+    /// 不是映射的文件时，由自身持有数据
+    std::string owned;
+    const char* data = nullptr;
+    size_t size = 0;
+    /// data是否指向映射的文件
+    bool mapped = false;
+
+    /// 检查文件头、各表的范围和校验值
+    bool Verify() const;
+    /// 解除映射
+    void Close();
+
+    inline const Header& GetHeader() const;
+    inline const LaneHeader& GetLaneHeader(int lane) const;
+    inline std::string_view GetString(const StringRef& ref) const;
+
+    inline static int ToValue(int32_t value, const ChartSnapshot&) { return value; }
+    inline static std::string ToValue(const StringRef& ref, const ChartSnapshot& snapshot);
+    inline static SpinEffect ToValue(const SpinData& spin, const ChartSnapshot&);
+
+public:
+    ChartSnapshot() = default;
+    ChartSnapshot(const ChartSnapshot&) = delete;
+    ChartSnapshot& operator=(const ChartSnapshot&) = delete;
+    ~ChartSnapshot();
+
+    /// 映射快照文件。文件不存在或者内容无效时返回false
+    bool Open(const std::string& path);
+    /// 使用内存中的快照内容。内容无效时返回false
+    bool Assign(std::string content);
+    /// 将Builder生成的快照内容写入文件
+    static bool Save(const std::string& path, const std::string& content);
+    /// 是否持有有效的快照
+    inline bool Valid() const;
+
+    /// 表的数量
+    inline int LaneCount() const;
+    /// 谱面总时长
+    inline int TotalTime() const;
+
+    /// 将第lane个表读入lst。记录的类型与lst不符时返回false
+    template <typename T>
+    bool ReadLane(int lane, IndexList<T>& lst) const;
+};
+
+/* INLINE FUNCTION */
+
+#include "chart_snapshot_inline.h"
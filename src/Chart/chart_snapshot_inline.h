@@ -0,0 +1,152 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "chart_snapshot.h"
+
+#include <type_traits>
+#include <vector>
+
+/* #region Builder */
+
+inline void ChartSnapshot::Builder::AddLane(const IndexList<int>& lst)
+{
+    std::vector<IntItem> items;
+    items.reserve(lst.size());
+    for (const auto& [time, val] : lst)
+    {
+        items.push_back(IntItem{time, val.isSame(), val.first(), val.second()});
+    }
+    this->AddLane(IntValue, items.data(), items.size(), sizeof(IntItem));
+}
+
+inline void ChartSnapshot::Builder::AddLane(const IndexList<std::string>& lst)
+{
+    std::vector<StringItem> items;
+    items.reserve(lst.size());
+    for (const auto& [time, val] : lst)
+    {
+        StringRef first = this->AddString(val.first());
+        StringRef second = val.isSame() ? first : this->AddString(val.second());
+        items.push_back(StringItem{time, val.isSame(), first, second});
+    }
+    this->AddLane(StringValue, items.data(), items.size(), sizeof(StringItem));
+}
+
+inline void ChartSnapshot::Builder::AddLane(const IndexList<SpinEffect>& lst)
+{
+    auto to_data = [](const SpinEffect& se) {
+        return SpinData{static_cast<int32_t>(se.spin), static_cast<int32_t>(se.side), se.length,
+                        {se.params[0], se.params[1], se.params[2]}};
+    };
+    std::vector<SpinItem> items;
+    items.reserve(lst.size());
+    for (const auto& [time, val] : lst)
+    {
+        items.push_back(SpinItem{time, val.isSame(), to_data(val.first()), to_data(val.second())});
+    }
+    this->AddLane(SpinValue, items.data(), items.size(), sizeof(SpinItem));
+}
+
+/* #endregion */
+
+/* #region Reader */
+
+inline bool ChartSnapshot::Valid() const
+{
+    return this->data != nullptr;
+}
+
+inline const ChartSnapshot::Header& ChartSnapshot::GetHeader() const
+{
+    return *reinterpret_cast<const Header*>(this->data);
+}
+
+inline const ChartSnapshot::LaneHeader& ChartSnapshot::GetLaneHeader(int lane) const
+{
+    return reinterpret_cast<const LaneHeader*>(this->data + sizeof(Header))[lane];
+}
+
+inline std::string_view ChartSnapshot::GetString(const StringRef& ref) const
+{
+    return std::string_view(this->data + this->GetHeader().pool_offset + ref.offset, ref.size);
+}
+
+inline int ChartSnapshot::LaneCount() const
+{
+    return this->Valid() ? static_cast<int>(this->GetHeader().lane_count) : 0;
+}
+
+inline int ChartSnapshot::TotalTime() const
+{
+    return this->Valid() ? this->GetHeader().total_time : 0;
+}
+
+inline std::string ChartSnapshot::ToValue(const StringRef& ref, const ChartSnapshot& snapshot)
+{
+    return std::string(snapshot.GetString(ref));
+}
+
+inline SpinEffect ChartSnapshot::ToValue(const SpinData& spin, const ChartSnapshot&)
+{
+    SpinEffect se;
+    se.spin = static_cast<Spin>(spin.spin);
+    se.side = static_cast<Side>(spin.side);
+    se.length = spin.length;
+    for (int i = 0; i < 3; ++i)
+    {
+        se.params[i] = spin.params[i];
+    }
+    return se;
+}
+
+template <typename T>
+bool ChartSnapshot::ReadLane(int lane, IndexList<T>& lst) const
+{
+    using ItemType = std::conditional_t<std::is_same_v<T, int>, IntItem,
+                                        std::conditional_t<std::is_same_v<T, SpinEffect>, SpinItem, StringItem>>;
+    constexpr ValueKind kind =
+        std::is_same_v<T, int> ? IntValue : std::is_same_v<T, SpinEffect> ? SpinValue : StringValue;
+
+    if (lane < 0 || lane >= this->LaneCount() || this->GetLaneHeader(lane).kind != kind)
+    {
+        return false;
+    }
+
+    const LaneHeader& header = this->GetLaneHeader(lane);
+    const ItemType* items = reinterpret_cast<const ItemType*>(this->data + header.offset);
+    lst.clear();
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        const ItemType& item = items[i];
+        if (item.same)
+        {
+            lst.append(item.time, PairEntry<T>(ToValue(item.first, *this)));
+        }
+        else
+        {
+            lst.append(item.time, PairEntry<T>(ToValue(item.first, *this), ToValue(item.second, *this)));
+        }
+    }
+    return true;
+}
+
+/* #endregion */
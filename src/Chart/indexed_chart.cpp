@@ -19,7 +19,12 @@
 */
 
 #include "indexed_chart.h"
+#include "chart_diff.h"
+#include "src/misc/keywords.h"
+#include "src/misc/utilities.h"
 
+#include <charconv>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <numeric>
@@ -30,39 +35,153 @@ using namespace std;
 
 void IndexedChart::ImportFromChart(Chart& chart)
 {
-    this->total_time = chart.TotalTime();
+    *this = IndexedChart();
+    this->total_time.value = chart.TotalTime();
+    // 各表在首次访问时再建立
+    this->source_chart = &chart;
+    this->lane_loaded.reset();
+}
+
+void IndexedChart::LoadLane(int lane) const
+{
+    if (this->lane_loaded[lane])
+    {
+        return;
+    }
+    this->lane_loaded.set(lane);
+
+    Chart& chart = *this->source_chart;
     // BT
-    for (int i = 0; i < 4; ++i)
+    if (lane < FXLane)
+    {
+        this->bt_lists[lane - BTLane] = chart.BTIndexList(BTByIndex(lane - BTLane));
+    }
+    // FX
+    else if (lane < KnobLane)
+    {
+        this->fx_lists[lane - FXLane] = chart.FXIndexList(FXByIndex(lane - FXLane));
+    }
+    // Knob
+    else if (lane < MarkLane)
+    {
+        this->knob_lists[lane - KnobLane] = chart.KnobIndexList(KnobByIndex(lane - KnobLane));
+    }
+    // Mark
+    else if (lane < SpinEffectLane)
+    {
+        int i = lane - MarkLane;
+        this->mark_lists[i] = chart.MarkIndexList(MarkByIndex(i), MarkSideByIndex(i));
+    }
+    // Spin Effect
+    else if (lane == SpinEffectLane)
+    {
+        this->spin_effect_list = chart.SpinEffectList();
+    }
+    // Comment
+    else if (lane == CommentLane)
     {
-        BT bt = BTByIndex(i);
-        this->bt_lists[i] = chart.BTIndexList(bt);
+        this->comment_list = chart.CommentIndexList();
     }
+    // Other Items
+    else if (lane == OtherItemsLane)
+    {
+        this->other_items_list = chart.OtherItemIndexList();
+    }
+}
 
-    // FX, Knob
-    for (int i = 0; i < 2; ++i)
+void IndexedChart::LoadAllLanes() const
+{
+    for (int lane = 0; lane < LanesCount; ++lane)
     {
-        FX fx = FXByIndex(i);
-        Knob knob = KnobByIndex(i);
-        this->fx_lists[i] = chart.FXIndexList(fx);
-        this->knob_lists[i] = chart.KnobIndexList(knob);
+        this->LoadLane(lane);
     }
+}
 
-    // Mark
-    for (int i = 0; i < MarkTypesCount; ++i)
+void IndexedChart::PreloadLanes(const LaneSet& lanes) const
+{
+    for (int lane = 0; lane < LanesCount; ++lane)
     {
-        MarkType mark = MarkByIndex(i);
-        Side side = MarkSideByIndex(i);
-        this->mark_lists[i] = chart.MarkIndexList(mark, side);
+        if (lanes[lane])
+        {
+            this->LoadLane(lane);
+        }
     }
+}
 
-    // Spin Effect
-    this->spin_effect_list = chart.SpinEffectList();
+template <typename Func>
+void IndexedChart::VisitLane(int lane, Func&& func) const
+{
+    this->LoadLane(lane);
+    if (lane < FXLane)
+    {
+        func(this->bt_lists[lane - BTLane]);
+    }
+    else if (lane < KnobLane)
+    {
+        func(this->fx_lists[lane - FXLane]);
+    }
+    else if (lane < MarkLane)
+    {
+        func(this->knob_lists[lane - KnobLane]);
+    }
+    else if (lane < SpinEffectLane)
+    {
+        func(this->mark_lists[lane - MarkLane]);
+    }
+    else if (lane == SpinEffectLane)
+    {
+        func(this->spin_effect_list);
+    }
+    else if (lane == CommentLane)
+    {
+        func(this->comment_list);
+    }
+    else if (lane == OtherItemsLane)
+    {
+        func(this->other_items_list);
+    }
+}
 
-    // Comment
-    this->comment_list = chart.CommentIndexList();
+static inline void HashValue(uint64_t& hash, const SpinEffect& value)
+{
+    HashValue(hash, value.ToString());
+}
 
-    // Other Items
-    this->other_items_list = chart.OtherItemIndexList();
+uint64_t IndexedChart::LaneHash(int lane) const
+{
+    uint64_t hash = kHashSeed;
+    this->VisitLane(lane, [&hash](const auto& lst) {
+        for (auto iter = lst.begin(); iter != lst.end(); ++iter)
+        {
+            HashValue(hash, iter->first);
+            HashValue(hash, iter->second.first());
+            HashValue(hash, iter->second.second());
+        }
+    });
+    return hash;
+}
+
+void IndexedChart::CopyLanes(const IndexedChart& other, const LaneSet& lanes)
+{
+    for (int lane = 0; lane < LanesCount; ++lane)
+    {
+        if (!lanes[lane])
+        {
+            continue;
+        }
+        // 索引表都是mutable的，VisitLane给出的是可修改的引用
+        other.VisitLane(lane, [&](const auto& src) {
+            this->VisitLane(lane, [&](auto& dst) {
+                // 两边是同一个表，类型一致
+                if constexpr (std::is_same_v<std::decay_t<decltype(src)>, std::decay_t<decltype(dst)>>)
+                {
+                    dst = src;
+                }
+            });
+        });
+        this->TouchLane(lane);
+        this->UpdateTotalTime(other.total_time.value);
+    }
 }
 
 /* #region Export -> Chart 辅助函数 */
@@ -122,6 +241,11 @@ int TimespanOfKnobList(IndexList<int>& map, int start_time, int length)
             last_iter_time = iter->first;
             last_iter_is_knob_end = (iter->second.second() == -1);
         }
+        // 表尾的终点落在小节最后一行时，后面需要留出一行写入终止
+        else if (last_iter_is_knob_end && start_time + length - last_iter_time <= timespan)
+        {
+            timespan = FinerTimespan(timespan);
+        }
     }
 
     return timespan;
@@ -334,7 +458,7 @@ void Write(Measure& measure, IndexList<string>& sub_map, Others, Side)
 
 template <typename TList, typename EnumType, std::enable_if_t<std::is_void_v<typename TList::IsIndexList>, bool> = true,
           typename T = typename TList::Component>
-void WriteFromMap(Measure& measure, TList& item_map, EnumType write_type, Side side = Side::L)
+void WriteFromMap(Measure& measure, const TList& item_map, EnumType write_type, Side side = Side::L)
 {
     int start_time = measure.StartTime();
     int length = measure.TotalTimespan();
@@ -353,7 +477,7 @@ void WriteFromMap(Measure& measure, TList& item_map, EnumType write_type, Side s
 
 // Knob偏特化
 template <>
-void WriteFromMap(Measure& measure, IndexList<int>& item_map, Knob write_type, Side side)
+void WriteFromMap(Measure& measure, const IndexList<int>& item_map, Knob write_type, Side side)
 {
     int start_time = measure.StartTime();
     int length = measure.TotalTimespan();
@@ -370,6 +494,76 @@ void WriteFromMap(Measure& measure, IndexList<int>& item_map, Knob write_type, S
     Write(measure, sub_map, write_type, side);
 }
 
+/* #region 未加载表：直接从源小节写入 */
+
+// 源小节中是否存在对应内容
+inline bool HasItem(const Entry& entry, MarkType mark, Side side) { return entry.HasMark(mark, side); }
+inline bool HasItem(const Entry& entry, Spin, Side) { return entry.GetSpinEffect().spin != Spin::None; }
+inline bool HasItem(const Entry& entry, Comment, Side) { return !entry.Comments().empty(); }
+inline bool HasItem(const Entry& entry, Others, Side) { return !entry.OtherItems().empty(); }
+
+// 将源记录的内容写入新记录，与经由索引表写入的结果相同
+void CopyItem(Entry& entry, const Entry& source, MarkType mark, Side side)
+{
+    const string& first_val = source.FindFirstMark(mark, side)->value;
+    entry.AddMark(Mark(mark, side, first_val));
+
+    if (source.HasMultipleMarks(mark, side))
+    {
+        const string& last_val = source.FindLastMark(mark, side)->value;
+        if (last_val != first_val)
+        {
+            entry.AddMark(Mark(mark, side, last_val));
+        }
+    }
+}
+
+void CopyItem(Entry& entry, const Entry& source, Spin, Side)
+{
+    entry.GetSpinEffect() = source.GetSpinEffect();
+}
+
+void CopyItem(Entry& entry, const Entry& source, Comment, Side)
+{
+    entry.Comments() = source.Comments();
+}
+
+void CopyItem(Entry& entry, const Entry& source, Others, Side)
+{
+    entry.OtherItems() = source.OtherItems();
+}
+
+// 对于拍号与起始时间都相同的源小节，不经过索引表直接写入
+template <typename EnumType>
+void WriteFromSource(Measure& measure, const Measure& source, EnumType write_type, Side side = Side::L)
+{
+    int length = source.TotalTimespan();
+
+    // 获取divisor
+    int timespan = 48;
+    for (int time = 0; time < length; time += source.EntryTimespan())
+    {
+        if (HasItem(source.EntryByLocalTime(time), write_type, side))
+        {
+            timespan = gcd(timespan, time);
+        }
+    }
+
+    measure.ExpandToTimespan(timespan);
+
+    // 写入
+    for (int time = 0; time < length; time += source.EntryTimespan())
+    {
+        const Entry& source_entry = source.EntryByLocalTime(time);
+        if (HasItem(source_entry, write_type, side))
+        {
+            CopyItem(measure.EntryByLocalTime(time), source_entry, write_type, side);
+        }
+    }
+}
+
+/* #endregion */
+
 /* #endregion */
 
 /* Note:
@@ -388,14 +582,22 @@ Chart IndexedChart::ExportToChart()
 {
     Chart output;
     // STEP 1 根据time signature表创建各小节
-    int time = 0, i = 0;
+    // 顺序扫过拍号表，每个小节使用其起始时刻及之前最后一个拍号
+    int time = 0;
     int sig_numer = 4, sig_denom = 4;
-    IndexList<string>& sig_list = this->mark_lists[MarkIndex(MarkType::TimeSignature)];
-    while (time < this->total_time)
+    IndexList<string>& sig_list = this->MarkList(MarkType::TimeSignature);
+    auto next_mark = sig_list.begin();
+    while (time < this->total_time.value)
     {
-        auto last_mark = sig_list.prevItem(time);
-        if (last_mark != sig_list.end())
+        bool sig_changed = false;
+        while (next_mark != sig_list.end() && next_mark->first <= time)
+        {
+            ++next_mark;
+            sig_changed = true;
+        }
+        if (sig_changed)
         {
+            auto last_mark = std::prev(next_mark);
             auto [numer, denom] = ReadRatioI(last_mark->second.first());
             sig_numer = numer; sig_denom = denom;
         }
@@ -403,50 +605,115 @@ Chart IndexedChart::ExportToChart()
         Measure new_measure = Measure::BlankMeasure(sig_numer, sig_denom);
         new_measure.SetTimeSignature(sig_numer, sig_denom);
         output.AppendMeasure(new_measure);
-        output.measure_at_time.insert(std::pair{time, i});
 
         time += new_measure.TotalTimespan();
-        i += 1;
     }
 
     // STEP 2 填入信息
-    for (auto& measure : output.measures)
-    {
+    // 只读访问，以免导出使衍生数据失效
+    const IndexedChart& self = *this;
+    for (size_t measure_id = 0; measure_id < output.measures.size(); ++measure_id)
+    {
+        Measure& measure = output.measures[measure_id];
+        // 小节划分与源谱面一致时，未加载的表可以直接从源小节写入
+        const Measure* source = nullptr;
+        if (this->source_chart != nullptr && measure_id < this->source_chart->measures.size())
+        {
+            const Measure& source_measure = this->source_chart->measures[measure_id];
+            if (source_measure.StartTime() == measure.StartTime() &&
+                source_measure.TotalTimespan() == measure.TotalTimespan())
+            {
+                source = &source_measure;
+            }
+        }
+
         // BT
         for (int i = 0; i < 4; ++i)
         {
             BT bt = BTByIndex(i);
-            WriteFromMap(measure, this->bt_lists[i], bt);
+            WriteFromMap(measure, self.BTList(bt), bt);
         }
         // FX
-        WriteFromMap(measure, this->fx_lists[0], FX::L);
-        WriteFromMap(measure, this->fx_lists[1], FX::R);
+        WriteFromMap(measure, self.FXList(FX::L), FX::L);
+        WriteFromMap(measure, self.FXList(FX::R), FX::R);
         // 旋钮
-        WriteFromMap(measure, this->knob_lists[0], Knob::L);
-        WriteFromMap(measure, this->knob_lists[1], Knob::R);
+        WriteFromMap(measure, self.KnobList(Knob::L), Knob::L);
+        WriteFromMap(measure, self.KnobList(Knob::R), Knob::R);
 
         // Marks
         for (int i = 0; i < MarkTypesCount; ++i)
         {
             MarkType mark = MarkByIndex(i);
             Side side = MarkSideByIndex(i);
-            WriteFromMap(measure, this->mark_lists[i], mark, side);
+            if (source != nullptr && !this->lane_loaded[MarkLane + i])
+            {
+                WriteFromSource(measure, *source, mark, side);
+                // BPM表在0时刻会补上谱面头中的初始值
+                if (mark == MarkType::BPM && measure.StartTime() == 0 && !source->EntryByIndex(0).HasMark(mark))
+                {
+                    std::string init_bpm = this->source_chart->header.GetMarkValue("t");
+                    measure.EntryByIndex(0).AddMark(Mark(mark, side, init_bpm));
+                }
+            }
+            else
+            {
+                WriteFromMap(measure, self.MarkList(mark, side), mark, side);
+            }
         }
 
         // SpinEffect
-        WriteFromMap(measure, this->spin_effect_list, Spin::None);
+        if (source != nullptr && !this->lane_loaded[SpinEffectLane])
+        {
+            WriteFromSource(measure, *source, Spin::None);
+        }
+        else
+        {
+            WriteFromMap(measure, self.SpinEffectList(), Spin::None);
+        }
         // Comments
-        WriteFromMap(measure, this->comment_list, Comment::Others);
-        // SpinEffect
-        WriteFromMap(measure, this->other_items_list, Others::Others);
+        if (source != nullptr && !this->lane_loaded[CommentLane])
+        {
+            WriteFromSource(measure, *source, Comment::Others);
+        }
+        else
+        {
+            WriteFromMap(measure, self.CommentList(), Comment::Others);
+        }
+        // Other Items
+        if (source != nullptr && !this->lane_loaded[OtherItemsLane])
+        {
+            WriteFromSource(measure, *source, Others::Others);
+        }
+        else
+        {
+            WriteFromMap(measure, self.OtherItemsList(), Others::Others);
+        }
     }
 
     return output;
 }
 
-/* #region Import <- File 辅助函数 */
+/* #region 文本格式 */
 
 /*
+* IndexedChart文本格式。每个表为一节，节内每行一条记录：
+*
+*   total_time=<总时长>
+*   -----------
+*   section <表名>
+*   <时刻> : <值>
+*   <时刻> : <突变前的值>, <突变后的值>
+*   （空行）
+*   section <表名>
+*   ...
+*
+* 写出时使用CRLF换行，读入时也接受LF。
+* 表名见g_SectionKeywords，顺序为BT-A ~ BT-D，FX-L，FX-R，Knob-L，Knob-R，
+* 各类标记（与ksh标记关键字相同），Spin Effect，Comments，Other Items。未知的表名被跳过。
+*
+* 字符串值中的 \ , 回车和换行分别写作 \\ \, \r \n，其余字符原样写出（包括首尾的空白），
+* 因此 KSH -> IndexedChart -> 文本 -> IndexedChart -> KSH 不会丢失内容。
+*
 * BT-A ~ BT-D			0, 0~3
 * FX-L					1, 0
 * FX-R					1, 1
@@ -456,274 +723,411 @@ Chart IndexedChart::ExportToChart()
 * Marks					3, 0-17
 * 
 * Spin Effect			4, 0
-* Comment				5, 0
+* Comments				5, 0
 * Other Items			6, 0
-* 
 */
 
-int modeToID(const std::string& mode)
+static const string kSectionSeparator = "-----------";
+
+static void AppendEscaped(string& output, string_view text)
 {
-    if (mode == "BT-A" || mode == "FX-L" || mode == "Knob-L" || mode == "t" || mode == "Spin Effect" ||
-        mode == "Comment" || mode == "Other Items")
-    {
-        return 0;
-    }
-    else if (mode == "BT-B" || mode == "FX-R" || mode == "Knob-R" || mode == "beat")
-    {
-        return 1;
-    }
-    else if (mode == "BT-C" || mode == "fx-l")
-    {
-        return 2;
-    }
-    else if (mode == "BT-D" || mode == "fx-r")
-    {
-        return 3;
-    }
-    else if (mode == "fx-l_se")
+    for (char c : text)
     {
-        return 4;
-    }
-    else if (mode == "fx-r_se")
-    {
-        return 5;
-    }
-    else if (mode == "laserrange_l")
-    {
-        return 6;
-    }
-    else if (mode == "laserrange_r")
-    {
-        return 7;
-    }
-    else if (mode == "filtertype")
-    {
-        return 8;
-    }
-    else if (mode == "pfiltergain")
-    {
-        return 9;
+        switch (c)
+        {
+        case '\\': output += "\\\\"; break;
+        case ',': output += "\\,"; break;
+        case '\r': output += "\\r"; break;
+        case '\n': output += "\\n"; break;
+        default: output += c; break;
+        }
     }
-    else if (mode == "chokkakuse")
+}
+
+/// 在text中查找第一个未转义的逗号
+static size_t FindUnescapedComma(string_view text)
+{
+    for (size_t i = 0; i < text.size(); ++i)
     {
-        return 10;
+        if (text[i] == '\\')
+        {
+            ++i;
+        }
+        else if (text[i] == ',')
+        {
+            return i;
+        }
     }
-    else if (mode == "chokkakuvol")
+    return string_view::npos;
+}
+
+static string Unescape(string_view text)
+{
+    string output;
+    output.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i)
     {
-        return 11;
+        if (text[i] == '\\' && i + 1 < text.size())
+        {
+            char c = text[++i];
+            output += c == 'r' ? '\r' : c == 'n' ? '\n' : c;
+        }
+        else
+        {
+            output += text[i];
+        }
     }
-    else if (mode == "tilt")
+    return output;
+}
+
+static bool ParseInt(string_view text, int& value)
+{
+    // 允许两侧有空白
+    size_t begin = text.find_first_not_of(' ');
+    size_t end = text.find_last_not_of(' ');
+    if (begin == string_view::npos)
     {
-        return 12;
+        return false;
     }
-    else if (mode == "zoom_top")
+    auto [ptr, ec] = from_chars(text.data() + begin, text.data() + end + 1, value);
+    return ec == errc() && ptr == text.data() + end + 1;
+}
+
+static inline void AppendValue(string& output, int value)
+{
+    output += to_string(value);
+}
+
+static inline void AppendValue(string& output, const string& value)
+{
+    AppendEscaped(output, value);
+}
+
+static inline void AppendValue(string& output, const SpinEffect& value)
+{
+    output += value.ToString();
+}
+
+/// 将一个表写为文本，不含结尾的换行
+template <typename T>
+static void AppendLane(string& output, const IndexList<T>& lst)
+{
+    bool first_line = true;
+    for (const auto& [time, val] : lst)
     {
-        return 13;
+        if (!first_line)
+        {
+            output += CRLF();
+        }
+        first_line = false;
+        output += to_string(time);
+        output += " : ";
+        AppendValue(output, val.first());
+        if (!val.isSame())
+        {
+            output += ", ";
+            AppendValue(output, val.second());
+        }
     }
-    else if (mode == "zoom_bottom")
-    {
-        return 14;
+}
+
+bool IndexedChart::InsertData(int map_type, int map_id, int time, string_view val)
+{
+    // 突变记录的两个值以", "分隔
+    string_view first = val, second;
+    bool same = true;
+    size_t comma = FindUnescapedComma(val);
+    if (comma != string_view::npos)
+    {
+        first = val.substr(0, comma);
+        second = val.substr(comma + 1);
+        if (!second.empty() && second[0] == ' ')
+        {
+            second.remove_prefix(1);
+        }
+        same = false;
     }
-    else if (mode == "zoom_side")
+
+    if (map_type >= 0 && map_type <= 2)
     {
-        return 15;
+        // BT, FX, 旋钮
+        int begin = 0, end = 0;
+        if (!ParseInt(first, begin) || (!same && !ParseInt(second, end)))
+        {
+            return false;
+        }
+        IndexList<int>& lst = map_type == 0 ? this->bt_lists[map_id]
+                              : map_type == 1 ? this->fx_lists[map_id]
+                                              : this->knob_lists[map_id];
+        if (same)
+        {
+            lst.insert(time, begin);
+        }
+        else
+        {
+            lst.insert(time, begin, end);
+        }
     }
-    else if (mode == "stop")
+    else if (map_type == 4)
     {
-        return 16;
+        // Spin Effect
+        this->spin_effect_list.insert(time, SpinEffect(Unescape(first)));
     }
-    else if (mode == "center_split")
+    else if (map_type == 3 || map_type == 5 || map_type == 6)
     {
-        return 17;
+        // Marks, Comments, Other Items
+        if (map_id == -1)
+        {
+            // 未知的标记，跳过
+            return true;
+        }
+        IndexList<string>& lst = map_type == 3 ? this->mark_lists[map_id]
+                                 : map_type == 5 ? this->comment_list
+                                                 : this->other_items_list;
+        if (same)
+        {
+            lst.insert(time, Unescape(first));
+        }
+        else
+        {
+            lst.insert(time, Unescape(first), Unescape(second));
+        }
     }
     else
     {
-        return -1;
+        // 没有所属的section
+        return false;
     }
+    return true;
 }
 
-int modeToType(const std::string& mode)
+bool IndexedChart::ImportTextLine(string_view line, SectionKeyword& section)
 {
-    if (mode == "BT-A" || mode == "BT-B" || mode == "BT-C" || mode == "BT-D")
+    if (!line.empty() && line.back() == '\r')
     {
-        return 0;
+        line.remove_suffix(1);
     }
-    else if (mode == "FX-L" || mode == "FX-R")
+
+    if (line.empty() || line == kSectionSeparator)
     {
-        return 1;
+        return true;
     }
-    else if (mode == "Knob-L" || mode == "Knob-R")
+    if (line.substr(0, 11) == "total_time=")
     {
-        return 2;
+        int total_time = 0;
+        if (!ParseInt(line.substr(11), total_time))
+        {
+            return false;
+        }
+        this->total_time.value = total_time;
+        return true;
     }
-    else if (mode == "Spin Effect")
+    if (line.substr(0, 8) == "section ")
     {
-        return 4;
+        // 未知的section视作无效的标记表
+        section = g_SectionKeywords.Get(line.substr(8), SectionKeyword{3, -1});
+        return true;
     }
-    else if (mode == "Comments")
+
+    size_t split_pos = line.find(" : ");
+    int time = 0;
+    if (split_pos == string_view::npos || !ParseInt(line.substr(0, split_pos), time))
     {
-        return 5;
+        return false;
     }
-    else if (mode == "Other Items")
+    return this->InsertData(section.type, section.id, time, line.substr(split_pos + 3));
+}
+
+bool IndexedChart::ImportFromString(string_view content)
+{
+    *this = IndexedChart();
+    this->TouchAllLanes();
+
+    SectionKeyword section{-1, -1};
+    while (!content.empty())
     {
-        return 6;
+        size_t line_end = content.find('\n');
+        if (!this->ImportTextLine(content.substr(0, line_end), section))
+        {
+            return false;
+        }
+        content.remove_prefix(line_end == string_view::npos ? content.size() : line_end + 1);
     }
-    else
+    return true;
+}
+
+bool IndexedChart::ImportFromStream(istream& is)
+{
+    *this = IndexedChart();
+    this->TouchAllLanes();
+
+    SectionKeyword section{-1, -1};
+    string line;
+    while (getline(is, line))
     {
-        return 3;  // marks
+        if (!this->ImportTextLine(line, section))
+        {
+            return false;
+        }
     }
+    return true;
 }
 
-void IndexedChart::InsertData(int map_type, int map_id, int time, const std::string& val)
+std::string IndexedChart::ExportToString() const
 {
-    if (map_type == 0)
-    {
-        // BT
-        this->bt_lists[map_id].insert(time, stoi(val));
+    this->LoadAllLanes();
+    string output;
+    output += "total_time=" + to_string(this->total_time.value) + CRLF();
+    output += kSectionSeparator + CRLF();
+
+    for (int lane = 0; lane < LanesCount; ++lane)
+    {
+        output += "section " + LaneName(lane) + CRLF();
+        this->VisitLane(lane, [&output](const auto& lst) {
+            AppendLane(output, lst);
+        });
+        if (lane + 1 < LanesCount)
+        {
+            output += CRLF();
+        }
     }
-    else if (map_type == 1)
+
+    return output;
+}
+
+void IndexedChart::ExportToStream(std::ostream& os) const
+{
+    os << this->ExportToString();
+}
+
+std::ostream& operator<<(std::ostream& os, const IndexedChart& ic)
+{
+    ic.ExportToStream(os);
+    return os;
+}
+
+/* #endregion */
+
+/* #region 比较 */
+
+std::string IndexedChart::LaneName(int lane)
+{
+    if (lane < FXLane)
     {
-        // FX
-        this->fx_lists[map_id].insert(time, stoi(val));
+        return string("BT-") + static_cast<char>('A' + lane - BTLane);
     }
-    else if (map_type == 2)
+    else if (lane < KnobLane)
     {
-        // Knobs
-        auto val_list = Split(val, ',');
-        int begin = stoi(val_list[0]);
-        if (val_list.size() > 1)
-        {
-            int end = stoi(val_list[1]);
-            this->knob_lists[map_id].insert(time, begin, end);
-        }
-        else
-        {
-            this->knob_lists[map_id].insert(time, begin);
-        }
+        return lane == FXLane ? "FX-L" : "FX-R";
     }
-    else if (map_type == 3)
+    else if (lane < MarkLane)
     {
-        // Marks
-        if (map_id == -1)
-        {
-            // ERROR
-            return;
-        }
-        auto val_list = Split(val, ',');
-        if (val_list.size() > 1)
-        {
-            this->mark_lists[map_id].insert(time, val_list[0], val_list[1]);
-        }
-        else
-        {
-            this->mark_lists[map_id].insert(time, val_list[0]);
-        }
+        return lane == KnobLane ? "Knob-L" : "Knob-R";
     }
-    else if (map_type == 4)
+    else if (lane < SpinEffectLane)
     {
-        // Spin Effect
-        this->spin_effect_list.insert(time, val);
+        int i = lane - MarkLane;
+        return MarkStr(MarkByIndex(i), MarkSideByIndex(i));
     }
-    else if (map_type == 5)
+    else if (lane == SpinEffectLane)
     {
-        // Comments
-        this->comment_list.insert(time, val);
+        return "Spin Effect";
     }
-    else if (map_type == 6)
+    else if (lane == CommentLane)
     {
-        // Other Items
-        this->other_items_list.insert(time, val);
+        return "Comments";
     }
+    return "Other Items";
 }
 
-/* #endregion */
-
-bool IndexedChart::ImportFromString(const std::string& content)
+void IndexedChart::DiffWith(const IndexedChart& other, ChartDiff& diff) const
 {
-    istringstream ss(content);
-
-    int type = -1, map_id = -1;
-    int split_pos = -1;
-
-    while (!ss.eof())
+    for (int lane = 0; lane < LanesCount; ++lane)
     {
-        std::string line;
-        getline(ss, line);
+        const string name = LaneName(lane);
+        this->VisitLane(lane, [&](const auto& old_lst) {
+            other.VisitLane(lane, [&](const auto& new_lst) {
+                // 两边是同一个表，类型一致
+                if constexpr (std::is_same_v<std::decay_t<decltype(old_lst)>, std::decay_t<decltype(new_lst)>>)
+                {
+                    diff.CompareLane(name, old_lst, new_lst);
+                }
+            });
+        });
+    }
+}
 
-        if (BeginWith(line, "total_time"))
-        {
-            this->total_time = stoi(line.substr(11));
-        }
-        else if (BeginWith(line, "section"))
-        {
-            std::string mode_str = line.substr(8);
-            type = modeToType(mode_str);
-            map_id = modeToID(mode_str);
-        }
-        else if ((split_pos = line.find(':')) != string::npos)
+bool IndexedChart::SameAs(const IndexedChart& other) const
+{
+    for (int lane = 0; lane < LanesCount; ++lane)
+    {
+        bool same = true;
+        this->VisitLane(lane, [&](const auto& a) {
+            other.VisitLane(lane, [&](const auto& b) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(a)>, std::decay_t<decltype(b)>>)
+                {
+                    same = ChartDiff::SameLane(a, b);
+                }
+            });
+        });
+        if (!same)
         {
-            int time = stoi(line.substr(0, split_pos - 1));
-            this->InsertData(type, map_id, time, line.substr(split_pos + 2));
+            return false;
         }
     }
-
     return true;
 }
 
-std::string IndexedChart::ExportToString()
-{
-    ostringstream ss;
-    ss << *this;
-    return ss.str();
-}
+/* #endregion */
 
-std::ostream& operator<<(std::ostream& os, IndexedChart ic)
-{
-    os << "total_time=" << ic.total_time << CRLF();
-    os << "-----------" << CRLF();
+/* #region 二进制快照 */
 
-    for (int i = 0; i < 4; ++i)
+bool IndexedChart::ImportFromSnapshot(const ChartSnapshot& snapshot)
+{
+    if (snapshot.LaneCount() != LanesCount)
     {
-        os << "section BT-" << static_cast<char>('A' + i) << CRLF();
-        os << ic.bt_lists[i] << CRLF();
+        return false;
     }
 
-    os << "section FX-L" << CRLF();
-    os << ic.fx_lists[0] << CRLF();
-    os << "section FX-R" << CRLF();
-    os << ic.fx_lists[1] << CRLF();
-
-    os << "section Knob-L" << CRLF();
-    os << ic.knob_lists[0] << CRLF();
-    os << "section Knob-R" << CRLF();
-    os << ic.knob_lists[1] << CRLF();
-
-    for (int i = 0; i < MarkTypesCount; ++i)
+    *this = IndexedChart();
+    bool success = true;
+    for (int lane = 0; lane < LanesCount; ++lane)
     {
-        MarkType mark = MarkByIndex(i);
-        Side side = MarkSideByIndex(i);
-        os << "section " << MarkStr(mark, side) << CRLF();
-        os << ic.mark_lists[i] << CRLF();
+        this->VisitLane(lane, [&](auto& lst) {
+            success = snapshot.ReadLane(lane, lst) && success;
+        });
     }
+    this->total_time.value = snapshot.TotalTime();
+    this->TouchAllLanes();
+    return success;
+}
 
-    os << "section Spin Effect" << CRLF();
-    os << ic.spin_effect_list << CRLF();
-
-    os << "section Comments" << CRLF();
-    os << ic.comment_list << CRLF();
-
-    os << "section Other Items" << CRLF();
-    os << ic.other_items_list;
-
-    return os;
+std::string IndexedChart::ExportToSnapshot() const
+{
+    ChartSnapshot::Builder builder(this->total_time.value);
+    for (int lane = 0; lane < LanesCount; ++lane)
+    {
+        this->VisitLane(lane, [&](const auto& lst) {
+            builder.AddLane(lst);
+        });
+    }
+    return builder.Finish();
 }
 
 /* #endregion */
 
+/* #endregion */
+
 /* #region 数据统计 */
 
 int IndexedChart::CalculateTotalTime() const
 {
+    this->LoadAllLanes();
+    if (this->calculated_total_time_version == this->TotalVersion())
+    {
+        return this->calculated_total_time;
+    }
+
     int total_time = 0;
     // BT
     for (auto& lst : this->bt_lists)
@@ -758,6 +1162,8 @@ int IndexedChart::CalculateTotalTime() const
     // Others
     total_time = max(total_time, other_items_list.last().first);
 
+    this->calculated_total_time = total_time;
+    this->calculated_total_time_version = this->TotalVersion();
     return total_time;
 }
 
@@ -765,12 +1171,62 @@ int IndexedChart::CalculateTotalTime() const
 
 /* #region 衍生表计算 */
 
-IndexList<double> IndexedChart::KnobPosList(Knob knob) const
+const TempoMap& IndexedChart::GetTempoMap() const
+{
+    int bpm_lane = MarkLane + MarkIndex(MarkType::BPM);
+    int stop_lane = MarkLane + MarkIndex(MarkType::Stop);
+    if (!this->StampIsCurrent(this->tempo_map_stamp, bpm_lane, stop_lane))
+    {
+        // 表在别处被整体修改过，无法得知修改的位置
+        this->tempo_map.Invalidate();
+    }
+    if (this->tempo_map.Dirty())
+    {
+        this->LoadLane(bpm_lane);
+        this->LoadLane(stop_lane);
+        this->tempo_map.Update(this->mark_lists[bpm_lane - MarkLane], this->mark_lists[stop_lane - MarkLane]);
+    }
+    this->tempo_map_stamp = this->CurrentStamp(bpm_lane, stop_lane);
+    return this->tempo_map;
+}
+
+const KnobSegmentIndex& IndexedChart::KnobSegments(Knob knob) const
+{
+    int knob_id = KnobIndex(knob);
+    int knob_lane = KnobLane + knob_id;
+    int laser2x_lane = MarkLane + MarkIndex(MarkType::Laser2x, ToSide(knob));
+    KnobSegmentIndex& knob_index = this->knob_segments[knob_id];
+    if (!this->StampIsCurrent(this->knob_segments_stamp[knob_id], knob_lane, laser2x_lane))
+    {
+        knob_index.Invalidate();
+    }
+    if (knob_index.Dirty())
+    {
+        this->LoadLane(knob_lane);
+        this->LoadLane(laser2x_lane);
+        knob_index.Update(this->knob_lists[knob_id], this->mark_lists[laser2x_lane - MarkLane]);
+    }
+    this->knob_segments_stamp[knob_id] = this->CurrentStamp(knob_lane, laser2x_lane);
+    return knob_index;
+}
+
+const IndexList<double>& IndexedChart::KnobPosList(Knob knob) const
 {
-    auto& knob_list = this->knob_lists[KnobIndex(knob)];
-    auto& laser2x_list = this->mark_lists[MarkIndex(MarkType::Laser2x, ToSide(knob))];
+    int knob_id = KnobIndex(knob);
+    int knob_lane = KnobLane + knob_id;
+    int laser2x_lane = MarkLane + MarkIndex(MarkType::Laser2x, ToSide(knob));
+    IndexList<double>& output = this->knob_pos_lists[knob_id];
+    if (this->StampIsCurrent(this->knob_pos_stamp[knob_id], knob_lane, laser2x_lane))
+    {
+        return output;
+    }
+
+    this->LoadLane(knob_lane);
+    this->LoadLane(laser2x_lane);
+    auto& knob_list = this->knob_lists[knob_id];
+    auto& laser2x_list = this->mark_lists[laser2x_lane - MarkLane];
 
-    IndexList<double> output;
+    output = IndexList<double>();
 
     bool continuing_knob = false;
     bool laser2x = false;
@@ -804,6 +1260,7 @@ IndexList<double> IndexedChart::KnobPosList(Knob knob) const
         }
     }
 
+    this->knob_pos_stamp[knob_id] = this->CurrentStamp(knob_lane, laser2x_lane);
     return output;
 }
 
@@ -811,6 +1268,43 @@ IndexList<double> IndexedChart::KnobPosList(Knob knob) const
 
 /* #region modify */
 
+void IndexedChart::TouchKnobLane(Knob knob, int start_time)
+{
+    int knob_id = KnobIndex(knob);
+    int knob_lane = KnobLane + knob_id;
+    int laser2x_lane = MarkLane + MarkIndex(MarkType::Laser2x, ToSide(knob));
+    // 修改前仍然有效的旋钮索引只需从修改处开始重建
+    bool index_current = this->StampIsCurrent(this->knob_segments_stamp[knob_id], knob_lane, laser2x_lane);
+    this->TouchLane(knob_lane);
+    if (index_current)
+    {
+        this->knob_segments[knob_id].Invalidate(start_time);
+        this->knob_segments_stamp[knob_id] = this->CurrentStamp(knob_lane, laser2x_lane);
+    }
+}
+
+void IndexedChart::TouchMarkLane(MarkType mark, Side side, int start_time)
+{
+    int mark_lane = MarkLane + MarkIndex(mark, side);
+    if (mark == MarkType::BPM || mark == MarkType::Stop)
+    {
+        // 修改前仍然有效的节奏表只需从修改处开始重建
+        int bpm_lane = MarkLane + MarkIndex(MarkType::BPM);
+        int stop_lane = MarkLane + MarkIndex(MarkType::Stop);
+        bool map_current = this->StampIsCurrent(this->tempo_map_stamp, bpm_lane, stop_lane);
+        this->TouchLane(mark_lane);
+        if (map_current)
+        {
+            this->tempo_map.Invalidate(start_time);
+            this->tempo_map_stamp = this->CurrentStamp(bpm_lane, stop_lane);
+        }
+    }
+    else
+    {
+        this->TouchLane(mark_lane);
+    }
+}
+
 void IndexedChart::ReplaceBT(BT bt, const IndexList<int>& lst, int offset)
 {
     // 空输入保护
@@ -819,7 +1313,7 @@ void IndexedChart::ReplaceBT(BT bt, const IndexList<int>& lst, int offset)
         return;
     }
     
-    IndexList<int>& bt_list = this->bt_lists[BTIndex(bt)];
+    IndexList<int>& bt_list = this->BTList(bt);
     int start_time = lst.first().first + offset;
     int end_time = lst.last().first + offset;
     this->UpdateTotalTime(end_time);
@@ -844,7 +1338,7 @@ void IndexedChart::ReplaceFX(FX fx, const IndexList<int>& lst, int offset)
         return;
     }
     
-    IndexList<int>& fx_list = this->fx_lists[FXIndex(fx)];
+    IndexList<int>& fx_list = this->FXList(fx);
     int start_time = lst.first().first + offset;
     int end_time = lst.last().first + offset;
     this->UpdateTotalTime(end_time);
@@ -869,10 +1363,13 @@ void IndexedChart::ReplaceKnob(Knob knob, const IndexList<int>& lst, int offset)
         return;
     }
 
+    // 直接访问，以便只让旋钮索引从修改处开始失效
+    this->LoadLane(KnobLane + KnobIndex(knob));
     IndexList<int>& knob_list = this->knob_lists[KnobIndex(knob)];
     int start_time = lst.first().first + offset;
     int end_time = lst.last().first + offset;
     this->UpdateTotalTime(end_time);
+    this->TouchKnobLane(knob, start_time);
 
     knob_list.erase(start_time, end_time);
 
@@ -894,10 +1391,13 @@ void IndexedChart::ReplaceMark(MarkType mark, const IndexList<string>& lst, int
         return;
     }
 
+    // 直接访问，以便只让衍生数据从修改处开始失效
+    this->LoadLane(MarkLane + MarkIndex(mark));
     IndexList<string>& mark_list = this->mark_lists[MarkIndex(mark)];
     int start_time = lst.first().first + offset;
     int end_time = lst.last().first + offset;
     this->UpdateTotalTime(end_time);
+    this->TouchMarkLane(mark, Side::L, start_time);
 
     mark_list.erase(start_time, end_time);
 
@@ -919,10 +1419,13 @@ void IndexedChart::ReplaceMark(MarkType mark, Side side, const IndexList<string>
         return;
     }
 
+    // 直接访问，以便只让衍生数据从修改处开始失效
+    this->LoadLane(MarkLane + MarkIndex(mark, side));
     IndexList<string>& mark_list = this->mark_lists[MarkIndex(mark, side)];
     int start_time = lst.first().first + offset;
     int end_time = lst.last().first + offset;
     this->UpdateTotalTime(end_time);
+    this->TouchMarkLane(mark, side, start_time);
 
     mark_list.erase(start_time, end_time);
 
@@ -938,6 +1441,8 @@ void IndexedChart::ReplaceMark(MarkType mark, Side side, const IndexList<string>
 
 void IndexedChart::Offset(int offset_val)
 {
+    this->LoadAllLanes();
+    this->TouchAllLanes();
     // BT
     for (int i = 0; i < 4; ++i)
     {
@@ -963,7 +1468,7 @@ void IndexedChart::Offset(int offset_val)
     this->spin_effect_list = this->spin_effect_list.offset(offset_val);
     this->other_items_list = this->other_items_list.offset(offset_val);
 
-    this->total_time += offset_val;
+    this->total_time.value += offset_val;
 }
 
 /* #endregion */
@@ -973,6 +1478,7 @@ void IndexedChart::Offset(int offset_val)
 IndexedChart IndexedChart::Slice(int start_time, int length) const
 {
     IndexedChart output;
+    this->LoadAllLanes();
 
     int end_time = start_time + length;
     // BT
@@ -1000,7 +1506,7 @@ IndexedChart IndexedChart::Slice(int start_time, int length) const
     output.spin_effect_list = this->spin_effect_list.surroundingSublist(start_time, end_time);
     output.other_items_list = this->other_items_list.surroundingSublist(start_time, end_time);
 
-    output.total_time = start_time + length;
+    output.total_time.value = start_time + length;
 
     return output;
 }
@@ -20,14 +20,35 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
+#include <bitset>
+#include <climits>
+#include <iosfwd>
+#include <string_view>
+
 #include "src/IndexList/index_list.h"
+#include "src/misc/keywords.h"
 #include "chart.h"
+#include "knob_segment_index.h"
+#include "chart_snapshot.h"
+#include "tempo_map.h"
+
+class ChartDiff;
 
 /// @brief
 /// 使用有序表存储每种谱面要素的谱面。暂不包含头（谱面信息）和自定义fx的部分。
 ///
 /// 易于进行查询和修改。
 ///
+/// 从Chart导入时各索引表是懒加载的：首次通过访问器取用时才从源谱面建表，
+/// 导出时未加载的标记类表直接从源谱面的小节中写出。
+/// 源谱面需要在导出或所有表加载完之前保持有效。
+///
+/// 节奏表、旋钮索引、旋钮位置表和总时长等衍生数据会被缓存，
+/// 并通过各表的修改计数判断是否过期。非常量的访问器和修改操作都视为对表的修改。
+///
+/// 多个线程可以同时修改不同的表，前提是事先用PreloadLanes加载了这些表。
+///
 /// @note
 /// 因为懒，大部分方法没有做常量的版本。
 class IndexedChart {
@@ -39,22 +60,75 @@ public:
 	using SpinEffectListType = IndexList<SpinEffect>;
 	using CommentListType = IndexList<std::string>;
 private:
-	int total_time = 0;
+	/// 各索引表在懒加载标记中的编号
+	enum LaneID : int {
+		BTLane = 0,
+		FXLane = BTLane + 4,
+		KnobLane = FXLane + 2,
+		MarkLane = KnobLane + 2,
+		SpinEffectLane = MarkLane + MarkTypesCount,
+		CommentLane,
+		OtherItemsLane,
+		LanesCount
+	};
+
+public:
+	/// 一组索引表，用于声明命令访问谱面的范围
+	using LaneSet = std::bitset<LanesCount>;
+
+private:
+	/// 总时长。不同的表被并行修改时会同时更新它，因此使用原子量
+	struct TotalTime {
+		std::atomic<int> value{0};
+
+		TotalTime() = default;
+		TotalTime(const TotalTime& other) : value(other.value.load()) {}
+		TotalTime& operator=(const TotalTime& other) { value.store(other.value.load()); return *this; }
+	};
+
+	TotalTime total_time;
+
+	// 懒加载的数据源。仅在存在未加载的表时会被访问。
+	Chart* source_chart = nullptr;
+	// 各表是否已加载
+	mutable std::bitset<LanesCount> lane_loaded = std::bitset<LanesCount>().set();
 
 	// BT
-	IndexList<int> bt_lists[4];
+	mutable IndexList<int> bt_lists[4];
 	// FX
-	IndexList<int> fx_lists[2];
+	mutable IndexList<int> fx_lists[2];
 	// 旋钮
-	IndexList<int> knob_lists[2];
+	mutable IndexList<int> knob_lists[2];
 	// Marks
-	IndexList<std::string> mark_lists[MarkTypesCount];
+	mutable IndexList<std::string> mark_lists[MarkTypesCount];
 	// SpinEffects
-	IndexList<SpinEffect> spin_effect_list;
+	mutable IndexList<SpinEffect> spin_effect_list;
 	// Comments
-	IndexList<std::string> comment_list;
+	mutable IndexList<std::string> comment_list;
 	// Other Items
-	IndexList<std::string> other_items_list;
+	mutable IndexList<std::string> other_items_list;
+
+	// 各表的修改计数。非常量访问和修改操作都会使其递增。
+	mutable unsigned int lane_versions[LanesCount] = {};
+
+	/// 衍生数据建立时，所依赖的两个表的修改计数
+	struct LaneStamp {
+		unsigned int first = UINT_MAX;
+		unsigned int second = UINT_MAX;
+	};
+
+	// 节奏表（由BPM表和停止表衍生）
+	mutable TempoMap tempo_map;
+	mutable LaneStamp tempo_map_stamp;
+	// 旋钮关键点索引（由旋钮表和外扩标记表衍生）
+	mutable KnobSegmentIndex knob_segments[2];
+	mutable LaneStamp knob_segments_stamp[2];
+	// 旋钮位置表（由旋钮表和外扩标记表衍生）
+	mutable IndexList<double> knob_pos_lists[2];
+	mutable LaneStamp knob_pos_stamp[2];
+	// 总时长（由所有表衍生）
+	mutable int calculated_total_time = 0;
+	mutable unsigned int calculated_total_time_version = UINT_MAX;
 
 
 public:
@@ -63,47 +137,126 @@ public:
 	/// 构造并从chart导入数据
 	inline IndexedChart(Chart& chart);
 
-	/// 从chart导入数据
+	/// 从chart导入数据。各表在首次访问时才真正建立。
 	void ImportFromChart(Chart& chart);
 	/// 将自身数据导出为chart（可进一步转换为.ksh）
 	Chart ExportToChart();
 
-	/// [调试中] 从IndexedChart格式的文本读入
-	bool ImportFromString(const std::string& content);
-	/// [调试中] 导出为IndexedChart文本字符串
-	std::string ExportToString();
+	/// 从IndexedChart格式的文本读入。格式见indexed_chart.cpp，遇到无法解析的行时返回false
+	bool ImportFromString(std::string_view content);
+	/// 从流中逐行读入IndexedChart格式的文本
+	bool ImportFromStream(std::istream& is);
+	/// 导出为IndexedChart文本字符串
+	std::string ExportToString() const;
+	/// 将IndexedChart文本写入流
+	void ExportToStream(std::ostream& os) const;
+
+	/// 从二进制快照读入。快照的表结构与当前版本不符时返回false
+	bool ImportFromSnapshot(const ChartSnapshot& snapshot);
+	/// 导出为二进制快照，见ChartSnapshot
+	std::string ExportToSnapshot() const;
 
-	/// 将自身数据打印为 时间:值 的形式
-	friend std::ostream& operator <<(std::ostream& os, IndexedChart ic);
+	/// 与other逐表比较，差异追加到diff。other视为新的一方
+	void DiffWith(const IndexedChart& other, ChartDiff& diff) const;
+	/// 各表的内容是否与other完全相同。遇到第一处不同即返回
+	bool SameAs(const IndexedChart& other) const;
+
+	/// 将自身数据打印为IndexedChart文本
+	friend std::ostream& operator <<(std::ostream& os, const IndexedChart& ic);
 
 private:
+	/// 从源谱面加载指定的表（已加载时无操作）
+	void LoadLane(int lane) const;
+	/// 表名，与IndexedChart文本格式的section名相同
+	static std::string LaneName(int lane);
+	/// 以lane对应的索引表调用func
+	template <typename Func>
+	void VisitLane(int lane, Func&& func) const;
+	/// 加载全部的表
+	void LoadAllLanes() const;
+	/// 记录指定的表被修改
+	inline void TouchLane(int lane);
+	/// 记录全部的表被修改
+	inline void TouchAllLanes();
+	/// 记录旋钮表自start_time起被修改
+	void TouchKnobLane(Knob knob, int start_time);
+	/// 记录标记表自start_time起被修改
+	void TouchMarkLane(MarkType mark, Side side, int start_time);
+	/// 获取两个表当前的修改计数
+	inline LaneStamp CurrentStamp(int lane_a, int lane_b) const;
+	/// 衍生数据是否与所依赖的两个表一致
+	inline bool StampIsCurrent(const LaneStamp& stamp, int lane_a, int lane_b) const;
+	/// 所有表的修改计数之和。按需求和而不单独计数，使不同的表可以被并行修改
+	inline unsigned int TotalVersion() const;
 	/// 计算当前谱面总时长
 	int CalculateTotalTime() const;
-	/// 插入指定数据
-	void InsertData(int type, int map_id, int time, const std::string& val);
+	/// 插入文本格式中的一条记录。值无法解析时返回false
+	bool InsertData(int type, int map_id, int time, std::string_view val);
+	/// 读入文本格式中的一行，section为当前所在的节
+	bool ImportTextLine(std::string_view line, SectionKeyword& section);
 
 public:
 	/// 使用所给时间更新总时间(仅当所给时间大于总时间时起效)
 	inline void UpdateTotalTime(int time);
-	// 获取各索引表
+	/// 谱面总时长
+	inline int TotalTime() const;
+	// 获取各索引表（非常量版本视为对表的修改）
 	/// 获取BT索引表
 	inline IndexList<int>& BTList(BT bt);
+	/// 获取BT索引表
+	inline const IndexList<int>& BTList(BT bt) const;
 	/// 获取FX索引表
 	inline IndexList<int>& FXList(FX fx);
+	/// 获取FX索引表
+	inline const IndexList<int>& FXList(FX fx) const;
 	/// 获取旋钮索引表
 	inline IndexList<int>& KnobList(Knob knob);
+	/// 获取旋钮索引表
+	inline const IndexList<int>& KnobList(Knob knob) const;
 	/// 获取各类标记的索引表
 	inline IndexList<std::string>& MarkList(MarkType mark, Side side);
+	/// 获取各类标记的索引表
+	inline const IndexList<std::string>& MarkList(MarkType mark, Side side) const;
 	/// 获取回转特特效索引表
 	inline IndexList<SpinEffect>& SpinEffectList();
+	/// 获取回转特特效索引表
+	inline const IndexList<SpinEffect>& SpinEffectList() const;
 	/// 获取注释的索引表
 	inline IndexList<std::string>& CommentList();
+	/// 获取注释的索引表
+	inline const IndexList<std::string>& CommentList() const;
 	/// 获取其他内容的索引表
 	inline IndexList<std::string>& OtherItemsList();
+	/// 获取其他内容的索引表
+	inline const IndexList<std::string>& OtherItemsList() const;
 
 	// 衍生内容计算
+	/// 获取节奏表。BPM表或停止表改变后会在下次获取时增量更新。
+	const TempoMap& GetTempoMap() const;
+	/// 获取旋钮关键点索引。旋钮表或外扩标记表改变后会在下次获取时增量更新。
+	const KnobSegmentIndex& KnobSegments(Knob knob) const;
 	/// 获取旋钮位置表。计算时会考虑旋钮外扩，最终范围在-25 ~ 75之间。
-	IndexList<double> KnobPosList(Knob knob) const;
+	const IndexList<double>& KnobPosList(Knob knob) const;
+
+	// 访问范围
+	/// BT表
+	static inline LaneSet LanesOf(BT bt);
+	/// FX表
+	static inline LaneSet LanesOf(FX fx);
+	/// 旋钮表，以及旋钮衍生数据所依赖的外扩标记表
+	static inline LaneSet LanesOf(Knob knob);
+	/// 标记表
+	static inline LaneSet LanesOf(MarkType mark, Side side = Side::L);
+	/// 节奏表所依赖的BPM表和停止表
+	static inline LaneSet TempoLanes();
+	/// 注释表，即命令本身所在的表
+	static inline LaneSet CommentLanes();
+	/// 预先加载指定的表。多个线程同时访问谱面之前调用，使各线程不会触发懒加载
+	void PreloadLanes(const LaneSet& lanes) const;
+	/// 表内容的哈希值，用于判断两次执行之间表是否变化。lane为LaneSet中的编号
+	uint64_t LaneHash(int lane) const;
+	/// 用other中的内容替换指定的表
+	void CopyLanes(const IndexedChart& other, const LaneSet& lanes);
 
 	// 修改各类子表的部分
 	/// 替换一段BT表的内容
@@ -130,8 +283,8 @@ public:
 
 };
 
-/// [调试中] 导出为IndexedChart文本
-std::ostream& operator <<(std::ostream& os, IndexedChart ic);
+/// 导出为IndexedChart文本
+std::ostream& operator <<(std::ostream& os, const IndexedChart& ic);
 
 /* INLINE FUNCTION */
 
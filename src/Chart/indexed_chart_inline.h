@@ -28,39 +28,160 @@ inline IndexedChart::IndexedChart(Chart& chart) {
 
 
 inline void IndexedChart::UpdateTotalTime(int time) {
-	if (this->total_time < time) {
-		total_time = time;
+	int current = this->total_time.value.load();
+	while (current < time && !this->total_time.value.compare_exchange_weak(current, time)) {
 	}
 }
 
+inline int IndexedChart::TotalTime() const {
+	return this->total_time.value.load();
+}
+
+inline void IndexedChart::TouchLane(int lane) {
+	++this->lane_versions[lane];
+}
+
+inline void IndexedChart::TouchAllLanes() {
+	for (int lane = 0; lane < LanesCount; ++lane) {
+		this->TouchLane(lane);
+	}
+}
+
+inline IndexedChart::LaneStamp IndexedChart::CurrentStamp(int lane_a, int lane_b) const {
+	return LaneStamp{this->lane_versions[lane_a], this->lane_versions[lane_b]};
+}
+
+inline bool IndexedChart::StampIsCurrent(const LaneStamp& stamp, int lane_a, int lane_b) const {
+	return stamp.first == this->lane_versions[lane_a] && stamp.second == this->lane_versions[lane_b];
+}
+
+inline unsigned int IndexedChart::TotalVersion() const {
+	unsigned int total = 0;
+	for (unsigned int version : this->lane_versions) {
+		total += version;
+	}
+	return total;
+}
+
+/* #region 访问范围 */
+
+inline IndexedChart::LaneSet IndexedChart::LanesOf(BT bt) {
+	return LaneSet().set(BTLane + BTIndex(bt));
+}
+
+inline IndexedChart::LaneSet IndexedChart::LanesOf(FX fx) {
+	return LaneSet().set(FXLane + FXIndex(fx));
+}
+
+inline IndexedChart::LaneSet IndexedChart::LanesOf(Knob knob) {
+	return LaneSet()
+		.set(KnobLane + KnobIndex(knob))
+		.set(MarkLane + MarkIndex(MarkType::Laser2x, ToSide(knob)));
+}
+
+inline IndexedChart::LaneSet IndexedChart::LanesOf(MarkType mark, Side side) {
+	return LaneSet().set(MarkLane + MarkIndex(mark, side));
+}
+
+inline IndexedChart::LaneSet IndexedChart::TempoLanes() {
+	return LanesOf(MarkType::BPM) | LanesOf(MarkType::Stop);
+}
+
+inline IndexedChart::LaneSet IndexedChart::CommentLanes() {
+	return LaneSet().set(CommentLane);
+}
+
+/* #endregion */
+
+/* #region 非常量访问器 */
+
 inline IndexList<int>& IndexedChart::BTList(BT bt) {
 	int i = BTIndex(bt);
+	this->LoadLane(BTLane + i);
+	this->TouchLane(BTLane + i);
 	return this->bt_lists[i];
 }
 
 inline IndexList<int>& IndexedChart::FXList(FX fx) {
 	int i = FXIndex(fx);
+	this->LoadLane(FXLane + i);
+	this->TouchLane(FXLane + i);
 	return this->fx_lists[i];
 }
 
 inline IndexList<int>& IndexedChart::KnobList(Knob knob) {
 	int i = KnobIndex(knob);
+	this->LoadLane(KnobLane + i);
+	this->TouchLane(KnobLane + i);
 	return this->knob_lists[i];
 }
 
 inline IndexList<std::string>& IndexedChart::MarkList(MarkType mark, Side side = Side::L) {
 	int i = MarkIndex(mark, side);
+	this->LoadLane(MarkLane + i);
+	this->TouchLane(MarkLane + i);
 	return this->mark_lists[i];
 }
 
 inline IndexList<SpinEffect>& IndexedChart::SpinEffectList() {
+	this->LoadLane(SpinEffectLane);
+	this->TouchLane(SpinEffectLane);
 	return this->spin_effect_list;
 }
 
 inline IndexList<std::string>& IndexedChart::CommentList() {
+	this->LoadLane(CommentLane);
+	this->TouchLane(CommentLane);
 	return this->comment_list;
 }
 
 inline IndexList<std::string>& IndexedChart::OtherItemsList() {
+	this->LoadLane(OtherItemsLane);
+	this->TouchLane(OtherItemsLane);
 	return this->other_items_list;
 }
+
+/* #endregion */
+
+/* #region 常量访问器 */
+
+inline const IndexList<int>& IndexedChart::BTList(BT bt) const {
+	int i = BTIndex(bt);
+	this->LoadLane(BTLane + i);
+	return this->bt_lists[i];
+}
+
+inline const IndexList<int>& IndexedChart::FXList(FX fx) const {
+	int i = FXIndex(fx);
+	this->LoadLane(FXLane + i);
+	return this->fx_lists[i];
+}
+
+inline const IndexList<int>& IndexedChart::KnobList(Knob knob) const {
+	int i = KnobIndex(knob);
+	this->LoadLane(KnobLane + i);
+	return this->knob_lists[i];
+}
+
+inline const IndexList<std::string>& IndexedChart::MarkList(MarkType mark, Side side = Side::L) const {
+	int i = MarkIndex(mark, side);
+	this->LoadLane(MarkLane + i);
+	return this->mark_lists[i];
+}
+
+inline const IndexList<SpinEffect>& IndexedChart::SpinEffectList() const {
+	this->LoadLane(SpinEffectLane);
+	return this->spin_effect_list;
+}
+
+inline const IndexList<std::string>& IndexedChart::CommentList() const {
+	this->LoadLane(CommentLane);
+	return this->comment_list;
+}
+
+inline const IndexList<std::string>& IndexedChart::OtherItemsList() const {
+	this->LoadLane(OtherItemsLane);
+	return this->other_items_list;
+}
+
+/* #endregion */
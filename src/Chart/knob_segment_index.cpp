@@ -0,0 +1,216 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "knob_segment_index.h"
+
+using namespace std;
+
+/* #region 建立索引 */
+
+void KnobSegmentIndex::Update(const IndexList<int>& knob_list, const IndexList<std::string>& laser2x_list)
+{
+    if (!this->Dirty())
+    {
+        return;
+    }
+
+    // 保留失效时刻之前的关键点。失效点前一个点的部分标记依赖于后一个点，所以一并重建。
+    int keep = this->NextIndex(this->dirty_from - 1);
+    keep = max(0, keep - 1);
+    auto lane_iter = keep == 0 ? knob_list.begin() : knob_list.nextItem(this->points[keep].time - 1);
+    this->points.resize(keep);
+
+    for (; lane_iter != knob_list.end(); ++lane_iter)
+    {
+        KeyPoint point{};
+        point.time = lane_iter->first;
+        point.start_val = lane_iter->second.first();
+        point.end_val = lane_iter->second.second();
+        this->points.push_back(point);
+    }
+
+    int n = this->Size();
+
+    // 正向：只依赖此点及之前的点
+    for (int i = keep; i < n; ++i)
+    {
+        KeyPoint& point = this->points[i];
+        const KeyPoint* prev = i == 0 ? nullptr : &this->points[i - 1];
+
+        point.slam = point.start_val != point.end_val && point.start_val != -1 && point.end_val != -1;
+        point.start = prev == nullptr || prev->end_val == -1;
+        point.slam_count = prev == nullptr ? 0 : prev->slam_count + (prev->slam ? 1 : 0);
+        point.last_slam_time = point.slam ? point.time : (prev == nullptr ? -1 : prev->last_slam_time);
+        point.last_void = point.end_val == -1 ? i : (prev == nullptr ? -1 : prev->last_void);
+        point.last_end =
+            (point.end_val == -1 && point.start_val != -1) ? i : (prev == nullptr ? 0 : prev->last_end);
+
+        int slam_6_before = this->Find(point.time - 6);
+        point.slam_6_before = slam_6_before >= 0 && this->points[slam_6_before].slam;
+    }
+
+    // 依赖后一个点的标记
+    for (int i = keep; i < n; ++i)
+    {
+        KeyPoint& point = this->points[i];
+        if (i + 1 < n)
+        {
+            const KeyPoint& next = this->points[i + 1];
+            point.slam_to_void = point.start_val != point.end_val && next.start_val != next.end_val &&
+                                 next.start_val == point.end_val && next.end_val == -1 &&
+                                 next.time - point.time <= 6;  // 时间差小于1/8拍
+        }
+        else
+        {
+            point.slam_to_void = false;
+        }
+
+        // 外扩标记记在旋钮起点上
+        int laser_start = point.last_void + 1;
+        point.laser2x = laser_start < n && laser2x_list.hasKey(this->points[laser_start].time);
+    }
+
+    // 反向：依赖此点及之后的点。保留部分只需更新到值不再变化为止。
+    for (int i = n - 1; i >= 0; --i)
+    {
+        KeyPoint& point = this->points[i];
+        int next_void = point.start_val == -1 ? i : (i + 1 < n ? this->points[i + 1].next_void : n);
+        if (i < keep && point.next_void == next_void)
+        {
+            break;
+        }
+        point.next_void = next_void;
+    }
+
+    this->dirty_from = INT_MAX;
+}
+
+/* #endregion */
+
+/* #region 查询 */
+
+bool KnobSegmentIndex::IsSlam(int time) const
+{
+    int i = this->Find(time);
+    return i >= 0 && this->points[i].slam;
+}
+
+bool KnobSegmentIndex::IsStart(int time) const
+{
+    int i = this->Find(time);
+    return i >= 0 && this->points[i].start;
+}
+
+bool KnobSegmentIndex::IsNormalEnd(int time) const
+{
+    int i = this->Find(time);
+    return i >= 0 && this->points[i].end_val == -1;
+}
+
+bool KnobSegmentIndex::IsEnd(int time) const
+{
+    int i = this->Find(time);
+    return i >= 0 && (this->points[i].end_val == -1 || this->points[i].slam_to_void);
+}
+
+bool KnobSegmentIndex::ExistsSlam(int start, int end) const
+{
+    int n = this->Size();
+    if (n == 0)
+    {
+        return false;
+    }
+
+    auto slam_count = [&](int i) {
+        return i < n ? this->points[i].slam_count : this->points[n - 1].slam_count + (this->points[n - 1].slam ? 1 : 0);
+    };
+    int first = this->NextIndex(start - 1);
+    int last = this->NextIndex(end);
+    return first < last && slam_count(last) > slam_count(first);
+}
+
+int KnobSegmentIndex::LastSlam(int time) const
+{
+    int i = this->PrevIndex(time);
+    return i >= 0 ? this->points[i].last_slam_time : -1;
+}
+
+bool KnobSegmentIndex::IsLaser2x(int time) const
+{
+    int i = this->PrevIndex(time + 1);
+    return i >= 0 && this->points[i].laser2x;
+}
+
+std::pair<int, double> KnobSegmentIndex::NextStartPos(int time) const
+{
+    int n = this->Size();
+    int i = this->NextIndex(time - 1);
+    if (i == n)
+    {
+        return {-1, -1};
+    }
+    if (i == 0)
+    {
+        return {this->points[0].time, this->points[0].start_val};
+    }
+
+    // 上一个点之后第一个断开点的下一个点
+    i = this->points[i - 1].next_void;
+    if (i != n)
+    {
+        ++i;
+    }
+    if (i == n)
+    {
+        return {-1, -1};
+    }
+    return {this->points[i].time, this->points[i].start_val};
+}
+
+std::pair<int, double> KnobSegmentIndex::LastEndPos(int time) const
+{
+    int i = this->PrevIndex(time);
+    if (i < 0)
+    {
+        return {-1, -1};
+    }
+
+    const KeyPoint& end_point = this->points[this->points[i].last_end];
+    return {end_point.time, end_point.start_val};
+}
+
+std::pair<int, double> KnobSegmentIndex::LastEndPos_BeforeSlam(int time) const
+{
+    int i = this->PrevIndex(time);
+    if (i < 0)
+    {
+        return {-1, -1};
+    }
+
+    i = this->points[i].last_end;
+    // 结束位置有直角时，取直角开始的位置
+    if (this->points[i].slam_6_before && i > 0)
+    {
+        --i;
+    }
+    return {this->points[i].time, this->points[i].start_val};
+}
+
+/* #endregion */
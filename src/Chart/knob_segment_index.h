@@ -0,0 +1,118 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/IndexList/index_list.h"
+
+/// @brief
+/// 旋钮关键点索引。将单侧旋钮表展开为连续数组，并预先计算直角、起止、外扩等分类，
+/// 使Shared/knob_query中的各种查询只需一次二分查找。
+///
+/// 更新是增量的：只重建失效时刻之后的关键点。
+class KnobSegmentIndex
+{
+public:
+    /// 旋钮关键点及其预计算信息
+    struct KeyPoint
+    {
+        /// 时刻
+        int time;
+        /// 起始值
+        int start_val;
+        /// 结束值
+        int end_val;
+
+        /// 是直角（突变前后都不是-1）
+        bool slam;
+        /// 是直角，且直角结束后立刻断开
+        bool slam_to_void;
+        /// 是旋钮的起始点
+        bool start;
+        /// 所在旋钮是外扩的（与IsLaser2x的判定一致）
+        bool laser2x;
+        /// 6个单位之前恰好有一个直角
+        bool slam_6_before;
+
+        /// 不晚于此点的最后一个直角的时刻。不存在时为-1。
+        int last_slam_time;
+        /// 不晚于此点的最后一个断开点（结束值为-1）的下标。不存在时为-1。
+        int last_void;
+        /// 不早于此点的第一个起始值为-1的点的下标。不存在时为点数。
+        int next_void;
+        /// 不晚于此点的最后一个通常结束点的下标。不存在时为0。
+        int last_end;
+        /// 此点之前（不含此点）的直角数量
+        int slam_count;
+    };
+
+private:
+    std::vector<KeyPoint> points;
+    // 从该时刻开始的关键点需要重建
+    int dirty_from = 0;
+
+public:
+    KnobSegmentIndex() = default;
+
+    /// 使指定时刻及之后的关键点失效
+    inline void Invalidate(int from_time = 0);
+
+    /// 是否需要重建
+    inline bool Dirty() const;
+
+    /// 根据旋钮表和外扩标记表重建失效的部分
+    void Update(const IndexList<int>& knob_list, const IndexList<std::string>& laser2x_list);
+
+    /// 获取所有关键点
+    inline const std::vector<KeyPoint>& Points() const;
+
+    /// 关键点数量
+    inline int Size() const;
+
+    /// 恰好位于指定时刻的关键点下标。不存在时返回-1。
+    inline int Find(int time) const;
+
+    /// 不晚于指定时刻的最后一个关键点下标。不存在时返回-1。
+    inline int PrevIndex(int time) const;
+
+    /// 晚于指定时刻的第一个关键点下标。不存在时返回点数。
+    inline int NextIndex(int time) const;
+
+    /* #region 查询：语义与Shared/knob_query一致 */
+
+    bool IsSlam(int time) const;
+    bool IsStart(int time) const;
+    bool IsNormalEnd(int time) const;
+    bool IsEnd(int time) const;
+    bool ExistsSlam(int start, int end) const;
+    int LastSlam(int time) const;
+    bool IsLaser2x(int time) const;
+    std::pair<int, double> NextStartPos(int time) const;
+    std::pair<int, double> LastEndPos(int time) const;
+    std::pair<int, double> LastEndPos_BeforeSlam(int time) const;
+
+    /* #endregion */
+};
+
+#include "knob_segment_index_inline.h"
@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <climits>
+
+#include "knob_segment_index.h"
+
+inline void KnobSegmentIndex::Invalidate(int from_time)
+{
+    if (from_time < this->dirty_from)
+    {
+        this->dirty_from = from_time;
+    }
+}
+
+inline bool KnobSegmentIndex::Dirty() const
+{
+    return this->dirty_from != INT_MAX;
+}
+
+inline const std::vector<KnobSegmentIndex::KeyPoint>& KnobSegmentIndex::Points() const
+{
+    return this->points;
+}
+
+inline int KnobSegmentIndex::Size() const
+{
+    return static_cast<int>(this->points.size());
+}
+
+inline int KnobSegmentIndex::Find(int time) const
+{
+    int i = this->PrevIndex(time);
+    return (i >= 0 && this->points[i].time == time) ? i : -1;
+}
+
+inline int KnobSegmentIndex::PrevIndex(int time) const
+{
+    return this->NextIndex(time) - 1;
+}
+
+inline int KnobSegmentIndex::NextIndex(int time) const
+{
+    auto iter = std::upper_bound(this->points.begin(), this->points.end(), time,
+                                 [](int t, const KeyPoint& point) { return t < point.time; });
+    return static_cast<int>(iter - this->points.begin());
+}
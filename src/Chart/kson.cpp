@@ -0,0 +1,1078 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "kson.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "src/misc/json.h"
+#include "src/misc/keywords.h"
+#include "src/misc/utilities.h"
+
+using namespace std;
+
+/// KSON与本工具的时间单位之比
+static constexpr int kTimeScale = 5;
+/// 旋钮位置的最大值，对应KSON中的1.0
+static constexpr int kKnobMax = 50;
+/// 直角旋钮的两个关键点之间的间隔（1/32小节）
+static constexpr int kSlamSpan = 6;
+
+static const char* const kDifficulties[] = {"light", "challenge", "extended", "infinite"};
+
+/// meta中的文本信息：KSON键，谱面头键
+static const pair<const char*, const char*> kMetaStrings[] = {
+    {"title", "title"},
+    {"artist", "artist"},
+    {"chart_author", "effect"},
+    {"jacket_filename", "jacket"},
+    {"jacket_author", "illustrator"},
+    {"disp_bpm", "t"},
+    {"information", "information"},
+};
+
+/// KSON中没有对应项、写入impl.kshram的标记
+static const pair<MarkType, Side> kImplMarks[] = {
+    {MarkType::FXLong, Side::L},  {MarkType::FXLong, Side::R},   {MarkType::FXChip, Side::L},
+    {MarkType::FXChip, Side::R},  {MarkType::Filter, Side::L},   {MarkType::KnobVolume, Side::L},
+    {MarkType::SlamSound, Side::L}, {MarkType::SlamVolume, Side::L},
+};
+
+static inline int64_t ToKsonTime(int time)
+{
+    return static_cast<int64_t>(time) * kTimeScale;
+}
+
+static inline int FromKsonTime(double y)
+{
+    return static_cast<int>(lround(y / kTimeScale));
+}
+
+static bool ParseNumber(const string& text, double& value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    auto [ptr, ec] = from_chars(text.data(), text.data() + text.size(), value);
+    return ec == errc() && ptr == text.data() + text.size();
+}
+
+static string FormatNumber(double value)
+{
+    char digits[32];
+    auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+    return string(digits, end);
+}
+
+/* #region 导出 */
+
+/// 标记的值能解析为数字时写为数字，否则写为字符串
+static void WriteMarkValue(JsonWriter& writer, const string& value)
+{
+    double number;
+    if (ParseNumber(value, number))
+    {
+        writer.Number(number);
+    }
+    else
+    {
+        writer.String(value);
+    }
+}
+
+/// 写为[[y, v], [y, [v, vf]], ...]
+static void WriteGraph(JsonWriter& writer, const IndexList<string>& lst)
+{
+    writer.BeginArray();
+    for (const auto& [time, val] : lst)
+    {
+        writer.BeginArray().Int(ToKsonTime(time));
+        if (val.isSame())
+        {
+            WriteMarkValue(writer, val.first());
+        }
+        else
+        {
+            writer.BeginArray();
+            WriteMarkValue(writer, val.first());
+            WriteMarkValue(writer, val.second());
+            writer.EndArray();
+        }
+        writer.EndArray();
+    }
+    writer.EndArray();
+}
+
+/// 写为[[y, "text"], ...]。有两个值的记录写为同一时刻的两项
+static void WriteTextEvents(JsonWriter& writer, const IndexList<string>& lst)
+{
+    writer.BeginArray();
+    for (const auto& [time, val] : lst)
+    {
+        writer.BeginArray().Int(ToKsonTime(time)).String(val.first()).EndArray();
+        if (!val.isSame())
+        {
+            writer.BeginArray().Int(ToKsonTime(time)).String(val.second()).EndArray();
+        }
+    }
+    writer.EndArray();
+}
+
+/// 单键写为y，长键写为[y, l]
+static void WriteNotes(JsonWriter& writer, const IndexList<int>& lst)
+{
+    writer.BeginArray();
+    int hold_start = -1;
+    for (const auto& [time, val] : lst)
+    {
+        // 单键为1，长键起点为2，长键终点为0
+        int state = val.first();
+        if (state == 1)
+        {
+            writer.Int(ToKsonTime(time));
+        }
+        else if (state == 2 && hold_start < 0)
+        {
+            hold_start = time;
+        }
+        else if (state == 0 && hold_start >= 0)
+        {
+            writer.BeginArray().Int(ToKsonTime(hold_start)).Int(ToKsonTime(time - hold_start)).EndArray();
+            hold_start = -1;
+        }
+    }
+    writer.EndArray();
+}
+
+/// 旋钮表写为各段[y, [[ry, v], [ry, [v, vf]], ...], w]
+static void WriteLaser(JsonWriter& writer, const IndexList<int>& knob, const IndexList<string>& range)
+{
+    writer.BeginArray();
+    bool in_section = false;
+    int section_start = 0;
+    auto end_section = [&]() {
+        writer.EndArray();
+        bool wide = range.hasKey(section_start) && range.startVal(section_start) == "2x";
+        writer.Int(wide ? 2 : 1).EndArray();
+        in_section = false;
+    };
+
+    for (const auto& [time, val] : knob)
+    {
+        // 不在旋钮段中的-1表示没有旋钮
+        if (!in_section)
+        {
+            if (val.first() < 0)
+            {
+                continue;
+            }
+            in_section = true;
+            section_start = time;
+            writer.BeginArray().Int(ToKsonTime(time)).BeginArray();
+        }
+
+        // 第二个值为-1表示旋钮段在此结束，与第一个值不同表示直角
+        writer.BeginArray().Int(ToKsonTime(time - section_start));
+        const double v = static_cast<double>(val.first()) / kKnobMax;
+        if (val.second() >= 0 && val.second() != val.first())
+        {
+            writer.BeginArray().Number(v).Number(static_cast<double>(val.second()) / kKnobMax).EndArray();
+        }
+        else
+        {
+            writer.Number(v);
+        }
+        writer.EndArray();
+
+        if (val.second() < 0)
+        {
+            end_section();
+        }
+    }
+    if (in_section)
+    {
+        end_section();
+    }
+    writer.EndArray();
+}
+
+/// 写为[[小节序号, [分子, 分母]], ...]
+static void WriteTimeSignatures(JsonWriter& writer, const IndexList<string>& beats)
+{
+    writer.BeginArray();
+    int measure = 0, last_time = 0, measure_span = 192;
+    for (const auto& [time, val] : beats)
+    {
+        measure += (time - last_time) / measure_span;
+        auto [numer, denom] = ReadRatioI(val.first());
+        writer.BeginArray().Int(measure).BeginArray().Int(numer).Int(denom).EndArray().EndArray();
+        last_time = time;
+        measure_span = max(1, 192 * numer / max(1, denom));
+    }
+    writer.EndArray();
+}
+
+/// 写为[[y, l], ...]
+static void WriteStops(JsonWriter& writer, const IndexList<string>& stops)
+{
+    writer.BeginArray();
+    for (const auto& [time, val] : stops)
+    {
+        double length;
+        if (ParseNumber(val.first(), length))
+        {
+            writer.BeginArray().Int(ToKsonTime(time)).Number(length * kTimeScale).EndArray();
+        }
+    }
+    writer.EndArray();
+}
+
+/// 写为[[y, d, l], ...]，摇摆效果另有参数
+static void WriteSpins(JsonWriter& writer, const IndexList<SpinEffect>& spins, Spin type)
+{
+    writer.BeginArray();
+    for (const auto& [time, val] : spins)
+    {
+        const SpinEffect& se = val.first();
+        if (se.spin != type)
+        {
+            continue;
+        }
+        writer.BeginArray().Int(ToKsonTime(time)).Int(se.side == Side::L ? -1 : 1).Int(ToKsonTime(se.length));
+        if (type == Spin::Shake)
+        {
+            writer.BeginObject()
+                .Key("scale").Int(se.params[0])
+                .Key("repeat").Int(se.params[1])
+                .Key("decay_order").Int(se.params[2])
+                .EndObject();
+        }
+        writer.EndArray();
+    }
+    writer.EndArray();
+}
+
+static void WriteMeta(JsonWriter& writer, const Header& header)
+{
+    writer.Key("meta").BeginObject();
+    for (auto [kson_key, ksh_key] : kMetaStrings)
+    {
+        if (header.HasMark(ksh_key))
+        {
+            writer.Key(kson_key).String(header.GetMarkValue(ksh_key));
+        }
+    }
+    if (header.HasMark("difficulty"))
+    {
+        const string difficulty = header.GetMarkValue("difficulty");
+        for (int i = 0; i < 4; ++i)
+        {
+            if (difficulty == kDifficulties[i])
+            {
+                writer.Key("difficulty").Int(i);
+            }
+        }
+    }
+    double number;
+    if (header.HasMark("level") && ParseNumber(header.GetMarkValue("level"), number))
+    {
+        writer.Key("level").Number(number);
+    }
+    writer.EndObject();
+
+    writer.Key("audio").BeginObject().Key("bgm").BeginObject();
+    if (header.HasMark("m"))
+    {
+        // 多个音频文件时只取第一个
+        const string music = header.GetMarkValue("m");
+        writer.Key("filename").String(music.substr(0, music.find(';')));
+    }
+    if (header.HasMark("mvol") && ParseNumber(header.GetMarkValue("mvol"), number))
+    {
+        writer.Key("vol").Number(number / 100.0);
+    }
+    if (header.HasMark("o") && ParseNumber(header.GetMarkValue("o"), number))
+    {
+        writer.Key("offset").Number(number);
+    }
+    writer.Key("preview").BeginObject();
+    if (header.HasMark("po") && ParseNumber(header.GetMarkValue("po"), number))
+    {
+        writer.Key("offset").Number(number);
+    }
+    if (header.HasMark("plength") && ParseNumber(header.GetMarkValue("plength"), number))
+    {
+        writer.Key("duration").Number(number);
+    }
+    writer.EndObject().EndObject().EndObject();
+
+    if (header.HasMark("total") && ParseNumber(header.GetMarkValue("total"), number))
+    {
+        writer.Key("gauge").BeginObject().Key("total").Number(number).EndObject();
+    }
+}
+
+void ExportToKson(const IndexedChart& chart, const Header& header, std::ostream& os)
+{
+    JsonWriter writer(os);
+    writer.BeginObject();
+    writer.Key("format_version").Int(1);
+    WriteMeta(writer, header);
+
+    writer.Key("beat").BeginObject();
+    writer.Key("bpm");
+    WriteGraph(writer, chart.MarkList(MarkType::BPM, Side::L));
+    writer.Key("time_sig");
+    WriteTimeSignatures(writer, chart.MarkList(MarkType::TimeSignature, Side::L));
+    writer.Key("stop");
+    WriteStops(writer, chart.MarkList(MarkType::Stop, Side::L));
+    writer.EndObject();
+
+    writer.Key("note").BeginObject();
+    writer.Key("bt").BeginArray();
+    for (int i = 0; i < 4; ++i)
+    {
+        WriteNotes(writer, chart.BTList(BTByIndex(i)));
+    }
+    writer.EndArray();
+    writer.Key("fx").BeginArray();
+    for (int i = 0; i < 2; ++i)
+    {
+        WriteNotes(writer, chart.FXList(FXByIndex(i)));
+    }
+    writer.EndArray();
+    writer.Key("laser").BeginArray();
+    for (int i = 0; i < 2; ++i)
+    {
+        Knob knob = KnobByIndex(i);
+        WriteLaser(writer, chart.KnobList(knob), chart.MarkList(MarkType::Laser2x, ToSide(knob)));
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    writer.Key("camera").BeginObject();
+    writer.Key("tilt");
+    WriteGraph(writer, chart.MarkList(MarkType::Tilt, Side::L));
+    writer.Key("cam").BeginObject();
+    writer.Key("body").BeginObject();
+    writer.Key("zoom");
+    WriteGraph(writer, chart.MarkList(MarkType::ZoomBottom, Side::L));
+    writer.Key("rotation_x");
+    WriteGraph(writer, chart.MarkList(MarkType::ZoomTop, Side::L));
+    writer.Key("shift_x");
+    WriteGraph(writer, chart.MarkList(MarkType::ZoomSide, Side::L));
+    writer.Key("center_split");
+    WriteGraph(writer, chart.MarkList(MarkType::LaneSplit, Side::L));
+    writer.EndObject();
+    writer.Key("pattern").BeginObject().Key("laser").BeginObject().Key("slam_event").BeginObject();
+    writer.Key("spin");
+    WriteSpins(writer, chart.SpinEffectList(), Spin::Circle);
+    writer.Key("half_spin");
+    WriteSpins(writer, chart.SpinEffectList(), Spin::Side);
+    writer.Key("swing");
+    WriteSpins(writer, chart.SpinEffectList(), Spin::Shake);
+    writer.EndObject().EndObject().EndObject();
+    writer.EndObject();
+    writer.EndObject();
+
+    writer.Key("editor").BeginObject().Key("comment");
+    WriteTextEvents(writer, chart.CommentList());
+    writer.EndObject();
+
+    writer.Key("impl").BeginObject().Key("kshram").BeginObject();
+    writer.Key("total_time").Int(chart.TotalTime());
+    writer.Key("header").BeginObject();
+    for (const auto& [key, value] : header.Items())
+    {
+        writer.Key(key).String(value);
+    }
+    writer.EndObject();
+    writer.Key("marks").BeginObject();
+    for (auto [mark, side] : kImplMarks)
+    {
+        const IndexList<string>& lst = chart.MarkList(mark, side);
+        if (!lst.empty())
+        {
+            writer.Key(MarkStr(mark, side));
+            WriteTextEvents(writer, lst);
+        }
+    }
+    writer.EndObject();
+    writer.Key("other_items");
+    WriteTextEvents(writer, chart.OtherItemsList());
+    writer.EndObject().EndObject();
+
+    writer.EndObject();
+}
+
+/* #endregion */
+
+/* #region 读入 */
+
+/// 逐个读取对象中的键。read需要读掉键对应的值，不认识的键用SkipValue跳过
+template <typename Func>
+static void ReadObject(JsonReader& reader, Func&& read)
+{
+    if (!reader.BeginObject())
+    {
+        return;
+    }
+    string key;
+    while (reader.NextKey(key))
+    {
+        read(key);
+    }
+}
+
+/// 逐个读取数组中的元素，read(i)读取第i个元素
+template <typename Func>
+static void ReadArray(JsonReader& reader, Func&& read)
+{
+    if (!reader.BeginArray())
+    {
+        return;
+    }
+    for (int i = 0; reader.NextElement(); ++i)
+    {
+        read(i);
+    }
+}
+
+/// 跳过数组中剩余的元素
+static void SkipRest(JsonReader& reader)
+{
+    while (reader.NextElement())
+    {
+        reader.SkipValue();
+    }
+}
+
+/// 读取数字或字符串形式的标记值
+static void ReadMarkValue(JsonReader& reader, string& value)
+{
+    if (reader.Peek() == JsonReader::Type::Number)
+    {
+        double number = 0.0;
+        reader.ReadNumber(number);
+        value = FormatNumber(number);
+    }
+    else
+    {
+        reader.ReadString(value);
+    }
+}
+
+/// 读取[y, ...]形式的元素开头的y
+static int ReadEventTime(JsonReader& reader)
+{
+    double y = 0.0;
+    reader.BeginArray();
+    reader.NextElement();
+    reader.ReadNumber(y);
+    return FromKsonTime(y);
+}
+
+/// 读取[[y, v], [y, [v, vf]], ...]
+static void ReadGraph(JsonReader& reader, IndexList<string>& lst)
+{
+    ReadArray(reader, [&](int) {
+        int time = ReadEventTime(reader);
+        string first, second;
+        reader.NextElement();
+        if (reader.Peek() == JsonReader::Type::Array)
+        {
+            reader.BeginArray();
+            reader.NextElement();
+            ReadMarkValue(reader, first);
+            reader.NextElement();
+            ReadMarkValue(reader, second);
+            SkipRest(reader);
+            lst.insert(time, std::move(first), std::move(second));
+        }
+        else
+        {
+            ReadMarkValue(reader, first);
+            lst.insert(time, std::move(first));
+        }
+        // 曲线参数等
+        SkipRest(reader);
+    });
+}
+
+/// 读取[[y, "text"], ...]。同一时刻的第二项作为记录的第二个值
+static void ReadTextEvents(JsonReader& reader, IndexList<string>& lst)
+{
+    ReadArray(reader, [&](int) {
+        int time = ReadEventTime(reader);
+        string text;
+        reader.NextElement();
+        ReadMarkValue(reader, text);
+        SkipRest(reader);
+        if (lst.hasKey(time))
+        {
+            lst.setEndVal(time, text);
+        }
+        else
+        {
+            lst.insert(time, std::move(text));
+        }
+    });
+}
+
+/// 读取单键y和长键[y, l]
+static void ReadNotes(JsonReader& reader, IndexList<int>& lst)
+{
+    ReadArray(reader, [&](int) {
+        double y = 0.0, length = 0.0;
+        if (reader.Peek() == JsonReader::Type::Number)
+        {
+            reader.ReadNumber(y);
+        }
+        else
+        {
+            reader.BeginArray();
+            reader.NextElement();
+            reader.ReadNumber(y);
+            if (reader.NextElement())
+            {
+                reader.ReadNumber(length);
+                SkipRest(reader);
+            }
+        }
+
+        if (length > 0)
+        {
+            lst.insert(FromKsonTime(y), 2);
+            lst.insert(FromKsonTime(y + length), 0);
+        }
+        else
+        {
+            lst.insert(FromKsonTime(y), 1);
+        }
+    });
+}
+
+/// 读取各段[y, [[ry, v], [ry, [v, vf]], ...], w]
+static void ReadLaser(JsonReader& reader, IndexList<int>& knob, IndexList<string>& range)
+{
+    auto to_knob = [](double v) {
+        return clamp(static_cast<int>(lround(v * kKnobMax)), 0, kKnobMax);
+    };
+    ReadArray(reader, [&](int) {
+        double y = 0.0;
+        reader.BeginArray();
+        reader.NextElement();
+        reader.ReadNumber(y);
+
+        // 各关键点：时刻，起始值，终止值
+        vector<tuple<int, int, int>> points;
+        reader.NextElement();
+        ReadArray(reader, [&](int) {
+            double ry = 0.0, v = 0.0, vf = 0.0;
+            reader.BeginArray();
+            reader.NextElement();
+            reader.ReadNumber(ry);
+            reader.NextElement();
+            if (reader.Peek() == JsonReader::Type::Array)
+            {
+                reader.BeginArray();
+                reader.NextElement();
+                reader.ReadNumber(v);
+                reader.NextElement();
+                reader.ReadNumber(vf);
+                SkipRest(reader);
+            }
+            else
+            {
+                reader.ReadNumber(v);
+                vf = v;
+            }
+            SkipRest(reader);
+            points.emplace_back(FromKsonTime(y + ry), to_knob(v), to_knob(vf));
+        });
+
+        int width = 1;
+        if (reader.NextElement())
+        {
+            reader.ReadInt(width);
+            SkipRest(reader);
+        }
+        if (points.empty() || reader.Failed())
+        {
+            return;
+        }
+
+        for (size_t i = 0; i + 1 < points.size(); ++i)
+        {
+            auto [time, v, vf] = points[i];
+            knob.insert(time, v, vf);
+        }
+        // 最后一个关键点的第二个值为-1。以直角结束时，补上直角之后的关键点
+        auto [time, v, vf] = points.back();
+        if (v != vf)
+        {
+            knob.insert(time, v, vf);
+            knob.insert(time + kSlamSpan, vf, -1);
+        }
+        else
+        {
+            knob.insert(time, v, -1);
+        }
+        if (width == 2)
+        {
+            range.insert(get<0>(points.front()), string("2x"));
+        }
+    });
+}
+
+/// 读取[[小节序号, [分子, 分母]], ...]
+static void ReadTimeSignatures(JsonReader& reader, IndexList<string>& beats)
+{
+    int last_measure = 0, time = 0, measure_span = 192;
+    ReadArray(reader, [&](int) {
+        int measure = 0, numer = 4, denom = 4;
+        reader.BeginArray();
+        reader.NextElement();
+        reader.ReadInt(measure);
+        reader.NextElement();
+        reader.BeginArray();
+        reader.NextElement();
+        reader.ReadInt(numer);
+        reader.NextElement();
+        reader.ReadInt(denom);
+        SkipRest(reader);
+        SkipRest(reader);
+
+        time += (measure - last_measure) * measure_span;
+        last_measure = measure;
+        measure_span = max(1, 192 * numer / max(1, denom));
+        beats.insert(time, to_string(numer) + "/" + to_string(denom));
+    });
+}
+
+/// 读取[[y, l], ...]
+static void ReadStops(JsonReader& reader, IndexList<string>& stops)
+{
+    ReadArray(reader, [&](int) {
+        int time = ReadEventTime(reader);
+        double length = 0.0;
+        reader.NextElement();
+        reader.ReadNumber(length);
+        SkipRest(reader);
+        stops.insert(time, to_string(FromKsonTime(length)));
+    });
+}
+
+/// 读取[[y, d, l], ...]，摇摆效果另有参数
+static void ReadSpins(JsonReader& reader, IndexList<SpinEffect>& spins, Spin type)
+{
+    ReadArray(reader, [&](int) {
+        SpinEffect se;
+        se.spin = type;
+        int time = ReadEventTime(reader);
+        int direction = 1;
+        double length = 0.0;
+        reader.NextElement();
+        reader.ReadInt(direction);
+        reader.NextElement();
+        reader.ReadNumber(length);
+        se.side = direction < 0 ? Side::L : Side::R;
+        se.length = FromKsonTime(length);
+        if (reader.NextElement())
+        {
+            ReadObject(reader, [&](const string& key) {
+                int* param = key == "scale" ? &se.params[0]
+                             : key == "repeat" ? &se.params[1]
+                             : key == "decay_order" ? &se.params[2]
+                                                    : nullptr;
+                if (param != nullptr)
+                {
+                    reader.ReadInt(*param);
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+            SkipRest(reader);
+        }
+        spins.insert(time, se);
+    });
+}
+
+/// 读取meta中的谱面信息
+static void ReadMeta(JsonReader& reader, Header& header)
+{
+    ReadObject(reader, [&](const string& key) {
+        auto found = find_if(begin(kMetaStrings), end(kMetaStrings),
+                             [&](const auto& item) { return key == item.first; });
+        string value;
+        if (found != end(kMetaStrings))
+        {
+            ReadMarkValue(reader, value);
+            header.SetMarkValue(found->second, value);
+        }
+        else if (key == "difficulty")
+        {
+            int difficulty = 0;
+            reader.ReadInt(difficulty);
+            header.SetMarkValue("difficulty", kDifficulties[clamp(difficulty, 0, 3)]);
+        }
+        else if (key == "level")
+        {
+            ReadMarkValue(reader, value);
+            header.SetMarkValue("level", value);
+        }
+        else
+        {
+            reader.SkipValue();
+        }
+    });
+}
+
+/// 读取audio.bgm中的音频信息
+static void ReadBgm(JsonReader& reader, Header& header)
+{
+    ReadObject(reader, [&](const string& key) {
+        double number = 0.0;
+        if (key == "filename")
+        {
+            string filename;
+            reader.ReadString(filename);
+            header.SetMarkValue("m", filename);
+        }
+        else if (key == "vol" && reader.ReadNumber(number))
+        {
+            header.SetMarkValue("mvol", FormatNumber(number * 100.0));
+        }
+        else if (key == "offset" && reader.ReadNumber(number))
+        {
+            header.SetMarkValue("o", FormatNumber(number));
+        }
+        else if (key == "preview")
+        {
+            ReadObject(reader, [&](const string& key) {
+                string value;
+                if (key == "offset" || key == "duration")
+                {
+                    ReadMarkValue(reader, value);
+                    header.SetMarkValue(key == "offset" ? "po" : "plength", value);
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else if (!reader.Failed())
+        {
+            reader.SkipValue();
+        }
+    });
+}
+
+static void ReadCamera(JsonReader& reader, IndexedChart& chart)
+{
+    ReadObject(reader, [&](const string& key) {
+        if (key == "tilt")
+        {
+            ReadGraph(reader, chart.MarkList(MarkType::Tilt));
+        }
+        else if (key == "cam")
+        {
+            ReadObject(reader, [&](const string& key) {
+                if (key == "body")
+                {
+                    ReadObject(reader, [&](const string& key) {
+                        MarkType mark = key == "zoom"           ? MarkType::ZoomBottom
+                                        : key == "rotation_x"   ? MarkType::ZoomTop
+                                        : key == "shift_x"      ? MarkType::ZoomSide
+                                        : key == "center_split" ? MarkType::LaneSplit
+                                                                : MarkType::Error;
+                        if (mark != MarkType::Error)
+                        {
+                            ReadGraph(reader, chart.MarkList(mark));
+                        }
+                        else
+                        {
+                            reader.SkipValue();
+                        }
+                    });
+                }
+                else if (key == "pattern")
+                {
+                    ReadObject(reader, [&](const string& key) {
+                        if (key != "laser")
+                        {
+                            reader.SkipValue();
+                            return;
+                        }
+                        ReadObject(reader, [&](const string& key) {
+                            if (key != "slam_event")
+                            {
+                                reader.SkipValue();
+                                return;
+                            }
+                            ReadObject(reader, [&](const string& key) {
+                                Spin spin = key == "spin"        ? Spin::Circle
+                                            : key == "half_spin" ? Spin::Side
+                                            : key == "swing"     ? Spin::Shake
+                                                                 : Spin::None;
+                                if (spin != Spin::None)
+                                {
+                                    ReadSpins(reader, chart.SpinEffectList(), spin);
+                                }
+                                else
+                                {
+                                    reader.SkipValue();
+                                }
+                            });
+                        });
+                    });
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else
+        {
+            reader.SkipValue();
+        }
+    });
+}
+
+/// 读取impl.kshram中本工具自己的内容
+static void ReadImpl(JsonReader& reader, IndexedChart& chart, Header& header, int& total_time, bool& has_header)
+{
+    ReadObject(reader, [&](const string& key) {
+        if (key == "total_time")
+        {
+            reader.ReadInt(total_time);
+        }
+        else if (key == "header")
+        {
+            has_header = true;
+            ReadObject(reader, [&](const string& key) {
+                string value;
+                reader.ReadString(value);
+                header.SetMarkValue(key, value);
+            });
+        }
+        else if (key == "marks")
+        {
+            ReadObject(reader, [&](const string& key) {
+                SectionKeyword section = g_SectionKeywords.Get(key, SectionKeyword{-1, -1});
+                if (section.type == 3)
+                {
+                    ReadTextEvents(reader, chart.MarkList(MarkByIndex(section.id), MarkSideByIndex(section.id)));
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else if (key == "other_items")
+        {
+            ReadTextEvents(reader, chart.OtherItemsList());
+        }
+        else
+        {
+            reader.SkipValue();
+        }
+    });
+}
+
+/// 谱面中最后一条记录的时刻
+static int LastEventTime(IndexedChart& chart)
+{
+    int last = 0;
+    auto update = [&last](const auto& lst) {
+        if (!lst.empty())
+        {
+            last = max(last, lst.last().first);
+        }
+    };
+    for (int i = 0; i < 4; ++i)
+    {
+        update(chart.BTList(BTByIndex(i)));
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        update(chart.FXList(FXByIndex(i)));
+        update(chart.KnobList(KnobByIndex(i)));
+    }
+    for (int i = 0; i < MarkTypesCount; ++i)
+    {
+        update(chart.MarkList(MarkByIndex(i), MarkSideByIndex(i)));
+    }
+    update(chart.SpinEffectList());
+    update(chart.CommentList());
+    update(chart.OtherItemsList());
+    return last;
+}
+
+bool ImportFromKson(std::string_view content, IndexedChart& chart, Header& header)
+{
+    chart = IndexedChart();
+    header = Header();
+    // 只有标准项时，谱面头由meta等项拼出
+    Header meta_header;
+    bool has_header = false;
+    int total_time = -1;
+    for (int i = 0; i < 2; ++i)
+    {
+        chart.KnobList(KnobByIndex(i)).insert(0, -1);
+    }
+
+    JsonReader reader(content);
+    ReadObject(reader, [&](const string& key) {
+        if (key == "meta")
+        {
+            ReadMeta(reader, meta_header);
+        }
+        else if (key == "beat")
+        {
+            ReadObject(reader, [&](const string& key) {
+                if (key == "bpm")
+                {
+                    ReadGraph(reader, chart.MarkList(MarkType::BPM));
+                }
+                else if (key == "time_sig")
+                {
+                    ReadTimeSignatures(reader, chart.MarkList(MarkType::TimeSignature));
+                }
+                else if (key == "stop")
+                {
+                    ReadStops(reader, chart.MarkList(MarkType::Stop));
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else if (key == "gauge")
+        {
+            ReadObject(reader, [&](const string& key) {
+                string value;
+                if (key == "total")
+                {
+                    ReadMarkValue(reader, value);
+                    meta_header.SetMarkValue("total", value);
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else if (key == "note")
+        {
+            ReadObject(reader, [&](const string& key) {
+                if (key == "bt")
+                {
+                    ReadArray(reader, [&](int i) {
+                        i < 4 ? ReadNotes(reader, chart.BTList(BTByIndex(i))) : (void)reader.SkipValue();
+                    });
+                }
+                else if (key == "fx")
+                {
+                    ReadArray(reader, [&](int i) {
+                        i < 2 ? ReadNotes(reader, chart.FXList(FXByIndex(i))) : (void)reader.SkipValue();
+                    });
+                }
+                else if (key == "laser")
+                {
+                    ReadArray(reader, [&](int i) {
+                        if (i < 2)
+                        {
+                            Knob knob = KnobByIndex(i);
+                            ReadLaser(reader, chart.KnobList(knob), chart.MarkList(MarkType::Laser2x, ToSide(knob)));
+                        }
+                        else
+                        {
+                            reader.SkipValue();
+                        }
+                    });
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else if (key == "audio")
+        {
+            ReadObject(reader, [&](const string& key) {
+                key == "bgm" ? ReadBgm(reader, meta_header) : (void)reader.SkipValue();
+            });
+        }
+        else if (key == "camera")
+        {
+            ReadCamera(reader, chart);
+        }
+        else if (key == "editor")
+        {
+            ReadObject(reader, [&](const string& key) {
+                key == "comment" ? ReadTextEvents(reader, chart.CommentList()) : (void)reader.SkipValue();
+            });
+        }
+        else if (key == "impl")
+        {
+            ReadObject(reader, [&](const string& key) {
+                if (key == "kshram")
+                {
+                    ReadImpl(reader, chart, header, total_time, has_header);
+                }
+                else
+                {
+                    reader.SkipValue();
+                }
+            });
+        }
+        else
+        {
+            reader.SkipValue();
+        }
+    });
+
+    if (reader.Failed() || !reader.AtEnd())
+    {
+        return false;
+    }
+    if (!has_header)
+    {
+        header = meta_header;
+    }
+    // 没有记录总时长时，保证最后一条记录所在的小节被导出
+    chart.UpdateTotalTime(total_time >= 0 ? total_time : LastEventTime(chart) + 1);
+    return true;
+}
+
+/* #endregion */
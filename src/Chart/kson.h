@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iosfwd>
+#include <string_view>
+
+#include "src/Header/header.h"
+#include "indexed_chart.h"
+
+/*
+KSON是以JSON表示的K-Shoot Mania谱面格式。KSON的时间单位为每拍240，是本工具的5倍。
+
+谱面中KSON有对应项的内容写入KSON的标准位置：
+    BT、FX、旋钮（宽度取自laserrange标记）    note
+    BPM、拍号、停止                           beat
+    tilt、zoom_top/bottom/side、center_split  camera
+    回转特效                                  camera.cam.pattern.laser.slam_event
+    注释                                      editor.comment
+    谱面头中的常用信息                        meta, audio.bgm, gauge
+其余内容（FX效果、滤波器、直角音等标记，其他内容，完整的谱面头和总时长）写入impl.kshram，
+读入时由此还原，使经过KSON的转换不丢失内容。
+*/
+
+/// 将谱面导出为KSON。header提供谱面信息
+void ExportToKson(const IndexedChart& chart, const Header& header, std::ostream& os);
+/// 从KSON读入谱面和谱面信息。格式有误时返回false
+bool ImportFromKson(std::string_view content, IndexedChart& chart, Header& header);
@@ -0,0 +1,97 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "measure_grid.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// 向下取整的除法（时间可能为负）
+inline int FloorDiv(int a, int b)
+{
+    int q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+void MeasureGrid::AppendMeasure(int numer, int denom, int length)
+{
+    // 与最后一段的拍号相同时并入最后一段
+    if (this->segments.empty() || this->segments.back().numer != numer || this->segments.back().denom != denom ||
+        this->segments.back().measure_length != length)
+    {
+        this->segments.push_back(Segment{this->total_time, this->measure_count, length, numer, denom});
+    }
+
+    this->measure_count += 1;
+    this->total_time += length;
+}
+
+const MeasureGrid::Segment& MeasureGrid::SegmentAtTime(int time) const
+{
+    static const Segment kDefaultSegment{0, 0, 192, 4, 4};
+    if (this->segments.empty())
+    {
+        return kDefaultSegment;
+    }
+
+    // 最后一个起始时间不大于time的段
+    auto iter = upper_bound(this->segments.begin(), this->segments.end(), time,
+                            [](int t, const Segment& seg) { return t < seg.start_time; });
+    if (iter == this->segments.begin())
+    {
+        return this->segments.front();
+    }
+    return *(iter - 1);
+}
+
+const MeasureGrid::Segment& MeasureGrid::SegmentOfMeasure(int measure_id) const
+{
+    static const Segment kDefaultSegment{0, 0, 192, 4, 4};
+    if (this->segments.empty())
+    {
+        return kDefaultSegment;
+    }
+
+    auto iter = upper_bound(this->segments.begin(), this->segments.end(), measure_id,
+                            [](int id, const Segment& seg) { return id < seg.first_measure; });
+    if (iter == this->segments.begin())
+    {
+        return this->segments.front();
+    }
+    return *(iter - 1);
+}
+
+int MeasureGrid::MeasureIDAtTime(int time) const
+{
+    const Segment& seg = this->SegmentAtTime(time);
+    return seg.first_measure + FloorDiv(time - seg.start_time, seg.measure_length);
+}
+
+int MeasureGrid::MeasureStartTime(int measure_id) const
+{
+    const Segment& seg = this->SegmentOfMeasure(measure_id);
+    return seg.start_time + (measure_id - seg.first_measure) * seg.measure_length;
+}
+
+int MeasureGrid::MeasureLength(int measure_id) const
+{
+    return this->SegmentOfMeasure(measure_id).measure_length;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+/// @brief
+/// 小节网格。拍号不变的连续小节合并为一段，
+/// 段内时间与小节的换算直接计算，跨段时二分查找。
+///
+/// 超出末尾的时间按最后一段的拍号顺延；没有任何小节时视为4/4拍。
+class MeasureGrid
+{
+public:
+    /// 拍号不变的一段连续小节
+    struct Segment
+    {
+        /// 段起始时间（单位：1/48拍）
+        int start_time;
+        /// 段内第一个小节的ID
+        int first_measure;
+        /// 段内单个小节的时长
+        int measure_length;
+        /// 拍号（分子）
+        int numer;
+        /// 拍号（分母）
+        int denom;
+    };
+
+private:
+    std::vector<Segment> segments;
+    int measure_count = 0;
+    int total_time = 0;
+
+public:
+    MeasureGrid() = default;
+
+    /// 清空
+    inline void Clear();
+
+    /// 在末尾追加一个小节
+    void AppendMeasure(int numer, int denom, int length);
+
+    /// 小节数量
+    inline int MeasureCount() const;
+
+    /// 所有小节的总时长
+    inline int TotalTime() const;
+
+    /// 获取所有的段
+    inline const std::vector<Segment>& Segments() const;
+
+    /// 获取指定时间所在的小节ID（小节包括起始时间，不包括结束时间）
+    int MeasureIDAtTime(int time) const;
+
+    /// 获取小节的起始时间
+    int MeasureStartTime(int measure_id) const;
+
+    /// 获取小节的时长
+    int MeasureLength(int measure_id) const;
+
+private:
+    /// 获取指定时间所在的段
+    const Segment& SegmentAtTime(int time) const;
+
+    /// 获取指定小节所在的段
+    const Segment& SegmentOfMeasure(int measure_id) const;
+};
+
+#include "measure_grid_inline.h"
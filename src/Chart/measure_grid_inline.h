@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "measure_grid.h"
+
+inline void MeasureGrid::Clear()
+{
+    this->segments.clear();
+    this->measure_count = 0;
+    this->total_time = 0;
+}
+
+inline int MeasureGrid::MeasureCount() const
+{
+    return this->measure_count;
+}
+
+inline int MeasureGrid::TotalTime() const
+{
+    return this->total_time;
+}
+
+inline const std::vector<MeasureGrid::Segment>& MeasureGrid::Segments() const
+{
+    return this->segments;
+}
@@ -0,0 +1,178 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tempo_map.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// 读取记录中开头的数值部分（"120-240"这样的BPM范围取前者）。无法读取时返回fallback。
+inline double ReadLeadingNumber(const std::string& str, double fallback)
+{
+    const char* begin = str.c_str();
+    char* end = nullptr;
+    double val = strtod(begin, &end);
+    return end == begin ? fallback : val;
+}
+
+void TempoMap::Update(const IndexList<std::string>& bpm_list, const IndexList<std::string>& stop_list)
+{
+    if (!this->Dirty())
+    {
+        return;
+    }
+
+    // 保留失效时刻之前的节点
+    auto kept_end = lower_bound(this->nodes.begin(), this->nodes.end(), this->dirty_from,
+                                [](const Node& node, int tick) { return node.tick < tick; });
+    this->nodes.erase(kept_end, this->nodes.end());
+
+    int from_tick = this->nodes.empty() ? 0 : this->nodes.back().tick + 1;
+    auto bpm_iter = bpm_list.nextItem(from_tick - 1);
+    auto stop_iter = stop_list.nextItem(from_tick - 1);
+    auto bpm_end = bpm_list.end();
+    auto stop_end = stop_list.end();
+
+    // 起始节点
+    if (this->nodes.empty())
+    {
+        this->nodes.push_back(Node{0, 0.0, kDefaultBPM, 60000.0 / (kDefaultBPM * 48), 0.0});
+    }
+
+    while (bpm_iter != bpm_end || stop_iter != stop_end)
+    {
+        int tick = INT_MAX;
+        if (bpm_iter != bpm_end)
+        {
+            tick = min(tick, bpm_iter->first);
+        }
+        if (stop_iter != stop_end)
+        {
+            tick = min(tick, stop_iter->first);
+        }
+
+        // 到达该时刻的累计时间
+        const Node& last = this->nodes.back();
+        Node node = last;
+        if (tick != last.tick)
+        {
+            node.tick = tick;
+            node.ms = last.ms + last.stop_ms + (tick - last.tick) * last.ms_per_tick;
+            node.stop_ms = 0.0;
+        }
+
+        // BPM变化：同一时刻有两个记录时，之后生效的是后一个
+        if (bpm_iter != bpm_end && bpm_iter->first == tick)
+        {
+            double bpm = ReadLeadingNumber(bpm_iter->second.second(), node.bpm);
+            if (bpm > 0)
+            {
+                node.bpm = bpm;
+                node.ms_per_tick = 60000.0 / (bpm * 48);
+            }
+            ++bpm_iter;
+        }
+
+        // 停止：持续时间按该时刻之后的BPM计算
+        if (stop_iter != stop_end && stop_iter->first == tick)
+        {
+            double length = ReadLeadingNumber(stop_iter->second.first(), 0.0);
+            node.stop_ms = max(0.0, length) * node.ms_per_tick;
+            ++stop_iter;
+        }
+
+        if (tick == last.tick)
+        {
+            this->nodes.back() = node;
+        }
+        else
+        {
+            this->nodes.push_back(node);
+        }
+    }
+
+    this->dirty_from = INT_MAX;
+}
+
+int TempoMap::NodeIndexAtTick(double tick) const
+{
+    auto iter = upper_bound(this->nodes.begin(), this->nodes.end(), tick,
+                            [](double t, const Node& node) { return t < node.tick; });
+    return max(0, static_cast<int>(iter - this->nodes.begin()) - 1);
+}
+
+int TempoMap::NodeIndexAtMs(double ms) const
+{
+    auto iter = upper_bound(this->nodes.begin(), this->nodes.end(), ms,
+                            [](double t, const Node& node) { return t < node.ms; });
+    return max(0, static_cast<int>(iter - this->nodes.begin()) - 1);
+}
+
+double TempoMap::BPMAt(int tick) const
+{
+    if (this->nodes.empty())
+    {
+        return kDefaultBPM;
+    }
+    return this->nodes[this->NodeIndexAtTick(tick)].bpm;
+}
+
+// 单个节点内的换算
+inline double TickToMsInNode(const TempoMap::Node& node, double tick)
+{
+    if (tick <= node.tick)
+    {
+        return node.ms + (tick - node.tick) * node.ms_per_tick;
+    }
+    return node.ms + node.stop_ms + (tick - node.tick) * node.ms_per_tick;
+}
+
+inline double MsToTickInNode(const TempoMap::Node& node, double ms)
+{
+    if (ms < node.ms)
+    {
+        return node.tick + (ms - node.ms) / node.ms_per_tick;
+    }
+    if (ms <= node.ms + node.stop_ms)
+    {
+        return node.tick;
+    }
+    return node.tick + (ms - node.ms - node.stop_ms) / node.ms_per_tick;
+}
+
+double TempoMap::TickToMs(double tick) const
+{
+    if (this->nodes.empty())
+    {
+        return tick * 60000.0 / (kDefaultBPM * 48);
+    }
+    return TickToMsInNode(this->nodes[this->NodeIndexAtTick(tick)], tick);
+}
+
+double TempoMap::MsToTick(double ms) const
+{
+    if (this->nodes.empty())
+    {
+        return ms * (kDefaultBPM * 48) / 60000.0;
+    }
+    return MsToTickInNode(this->nodes[this->NodeIndexAtMs(ms)], ms);
+}
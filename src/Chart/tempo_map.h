@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "src/IndexList/index_list.h"
+
+/// @brief
+/// 节奏表：由BPM表和停止(stop)表得到的 时间(1/48拍) <-> 毫秒 的换算表。
+///
+/// 每个BPM变化点或停止点记录一个节点，节点上存有到达该点时的累计毫秒数。
+/// 单次换算为一次二分查找。
+///
+/// 表的更新是增量的：只重建失效时刻之后的节点。
+class TempoMap
+{
+public:
+    /// BPM或停止发生的时刻
+    struct Node
+    {
+        /// 时刻（单位：1/48拍）
+        int tick;
+        /// 到达该时刻时的累计时间（毫秒，不含该时刻的停止）
+        double ms;
+        /// 该时刻之后的BPM
+        double bpm;
+        /// 该时刻之后每1/48拍的毫秒数
+        double ms_per_tick;
+        /// 该时刻停止的毫秒数
+        double stop_ms;
+    };
+
+    /// 没有BPM记录时使用的BPM
+    static constexpr double kDefaultBPM = 120.0;
+
+private:
+    std::vector<Node> nodes;
+    // 从该时刻开始的节点需要重建
+    int dirty_from = 0;
+
+public:
+    TempoMap() = default;
+
+    /// 使指定时刻及之后的节点失效
+    inline void Invalidate(int from_tick = 0);
+
+    /// 是否需要重建
+    inline bool Dirty() const;
+
+    /// 根据BPM表和停止表重建失效的部分
+    void Update(const IndexList<std::string>& bpm_list, const IndexList<std::string>& stop_list);
+
+    /// 获取所有节点
+    inline const std::vector<Node>& Nodes() const;
+
+    /// 获取指定时刻的BPM（恰好位于变化点时取变化后的值）
+    double BPMAt(int tick) const;
+
+    /// 时刻换算为毫秒
+    double TickToMs(double tick) const;
+
+    /// 毫秒换算为时刻。位于停止中的时间换算为停止的时刻。
+    double MsToTick(double ms) const;
+
+private:
+    /// 获取不晚于指定时刻的最后一个节点
+    int NodeIndexAtTick(double tick) const;
+
+    /// 获取不晚于指定毫秒数的最后一个节点
+    int NodeIndexAtMs(double ms) const;
+};
+
+#include "tempo_map_inline.h"
@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tempo_map.h"
+
+inline void TempoMap::Invalidate(int from_tick)
+{
+    if (from_tick < this->dirty_from)
+    {
+        this->dirty_from = from_tick;
+    }
+}
+
+inline bool TempoMap::Dirty() const
+{
+    return this->dirty_from != INT_MAX;
+}
+
+inline const std::vector<TempoMap::Node>& TempoMap::Nodes() const
+{
+    return this->nodes;
+}
@@ -0,0 +1,140 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "arg_schema.h"
+
+#include <sstream>
+
+using namespace std;
+
+bool ArgMatches(const Command& cmd, int index, ArgType type)
+{
+    switch (type)
+    {
+    case ArgType::Int:
+        return cmd.argIsInt(index);
+    case ArgType::Double:
+        return cmd.argIsDouble(index);
+    case ArgType::Bool:
+        return cmd.argIsBool(index);
+    case ArgType::Ratio:
+        return cmd.argIsRatio(index);
+    case ArgType::DoubleOrRatio:
+        return cmd.argIsDouble(index) || cmd.argIsRatio(index);
+    default:
+        return true;
+    }
+}
+
+const char* ArgTypeName(ArgType type)
+{
+    switch (type)
+    {
+    case ArgType::Int:
+        return "int";
+    case ArgType::Double:
+        return "number";
+    case ArgType::Bool:
+        return "bool";
+    case ArgType::Ratio:
+        return "ratio";
+    case ArgType::DoubleOrRatio:
+        return "number or ratio";
+    default:
+        return "any";
+    }
+}
+
+// <name:type>，任意类型时省略类型
+static void WriteSpec(ostringstream& ss, const ArgSpec& spec, char left, char right)
+{
+    ss << left << spec.name;
+    if (spec.type != ArgType::Any)
+    {
+        ss << ":" << ArgTypeName(spec.type);
+    }
+    ss << right;
+}
+
+std::string ArgSchema::Explain(const Command& cmd) const
+{
+    ostringstream ss;
+    int length = cmd.argLength();
+    if (!this->LengthMatches(length))
+    {
+        ss << "expected ";
+        int min_length = static_cast<int>(this->required.size());
+        int max_length = min_length + static_cast<int>(this->optional.size());
+        if (this->variadic)
+        {
+            ss << "at least " << min_length;
+        }
+        else if (min_length == max_length)
+        {
+            ss << min_length;
+        }
+        else
+        {
+            ss << min_length << " ~ " << max_length;
+        }
+        ss << " args, got " << length;
+        return ss.str();
+    }
+
+    for (int i = 0; i < length; ++i)
+    {
+        const ArgSpec* spec = this->SpecAt(i);
+        if (spec == nullptr)
+        {
+            break;
+        }
+        if (!ArgMatches(cmd, i, spec->type))
+        {
+            ss << "arg #" << i + 1 << " (" << spec->name << ") should be " << ArgTypeName(spec->type)
+               << ", got \"" << cmd.arg(i) << "\"";
+            return ss.str();
+        }
+    }
+    return "";
+}
+
+std::string ArgSchema::Usage() const
+{
+    ostringstream ss;
+    bool first = true;
+    for (auto& spec : this->required)
+    {
+        ss << (first ? "" : " ");
+        WriteSpec(ss, spec, '<', '>');
+        first = false;
+    }
+    for (auto& spec : this->optional)
+    {
+        ss << (first ? "" : " ");
+        WriteSpec(ss, spec, '[', ']');
+        first = false;
+    }
+    if (this->variadic)
+    {
+        ss << (first ? "..." : " ...");
+    }
+    return ss.str();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "command.h"
+
+/// 命令参数的类型
+enum class ArgType
+{
+	/// 任意字符串
+	Any,
+	/// 整数
+	Int,
+	/// 数字（整数or小数）
+	Double,
+	/// 布尔值
+	Bool,
+	/// 分数(a/b)
+	Ratio,
+	/// 小数or分数
+	DoubleOrRatio
+};
+
+/// 单个参数的声明
+struct ArgSpec
+{
+	/// 参数名称（仅用于提示信息）
+	std::string name;
+	/// 参数类型
+	ArgType type;
+
+	inline ArgSpec(const char* name, ArgType type = ArgType::Any);
+};
+
+/// 命令参数格式。由必需参数、可选参数（按顺序从末尾省略）和是否允许更多参数组成。
+///
+/// 检查时解析出的数值会缓存在Command中，之后以argAsXXX读取时不再重复解析字符串。
+class ArgSchema
+{
+private:
+	std::vector<ArgSpec> required;
+	std::vector<ArgSpec> optional;
+	// 是否允许在可选参数之后继续追加任意参数
+	bool variadic;
+
+public:
+	/// @brief 声明参数格式
+	/// @param required 必需参数
+	/// @param optional 可选参数
+	/// @param variadic 是否允许追加任意参数
+	inline ArgSchema(std::initializer_list<ArgSpec> required,
+	                 std::initializer_list<ArgSpec> optional = {},
+	                 bool variadic = false);
+
+	/// 检查命令参数是否符合格式
+	inline bool Check(const Command& cmd) const;
+
+	/// 说明命令参数不符合格式的原因。符合格式时返回空字符串。
+	std::string Explain(const Command& cmd) const;
+
+	/// 格式说明，形如 <name> <name:type> [name:type] ...
+	std::string Usage() const;
+
+private:
+	/// 参数个数是否在允许范围内
+	inline bool LengthMatches(int length) const;
+	/// 第index个参数的声明。超出声明范围时返回nullptr。
+	inline const ArgSpec* SpecAt(int index) const;
+};
+
+/// 检查单个参数是否符合指定类型
+bool ArgMatches(const Command& cmd, int index, ArgType type);
+
+/// 类型的名称
+const char* ArgTypeName(ArgType type);
+
+#include "arg_schema_inline.h"
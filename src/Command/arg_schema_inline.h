@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "arg_schema.h"
+
+inline ArgSpec::ArgSpec(const char* name, ArgType type)
+    : name(name), type(type)
+{
+}
+
+inline ArgSchema::ArgSchema(std::initializer_list<ArgSpec> required,
+                            std::initializer_list<ArgSpec> optional,
+                            bool variadic)
+    : required(required), optional(optional), variadic(variadic)
+{
+}
+
+inline bool ArgSchema::LengthMatches(int length) const
+{
+    int min_length = static_cast<int>(this->required.size());
+    int max_length = min_length + static_cast<int>(this->optional.size());
+    return length >= min_length && (this->variadic || length <= max_length);
+}
+
+inline const ArgSpec* ArgSchema::SpecAt(int index) const
+{
+    int required_size = static_cast<int>(this->required.size());
+    if (index < required_size)
+    {
+        return &this->required[index];
+    }
+    else if (index - required_size < static_cast<int>(this->optional.size()))
+    {
+        return &this->optional[index - required_size];
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+inline bool ArgSchema::Check(const Command& cmd) const
+{
+    int length = cmd.argLength();
+    if (!this->LengthMatches(length))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < length; ++i)
+    {
+        const ArgSpec* spec = this->SpecAt(i);
+        if (spec == nullptr)
+        {
+            break;
+        }
+        if (!ArgMatches(cmd, i, spec->type))
+        {
+            return false;
+        }
+    }
+    return true;
+}
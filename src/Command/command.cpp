@@ -56,6 +56,65 @@ Command::Command(const std::string& str, int time)
     }
 }
 
+Command::ParsedArg& Command::classifiedArg(int index) const
+{
+    if (this->parsed_args_.size() != this->cmds.size() - 1)
+    {
+        this->parsed_args_.assign(this->cmds.size() - 1, ParsedArg());
+    }
+
+    ParsedArg& parsed = this->parsed_args_[index];
+    if (!(parsed.flags & Classified))
+    {
+        const string& str = this->cmds[index + 1];
+        parsed.flags |= Classified;
+        if (IsDigit(str))
+        {
+            parsed.flags |= ArgInt;
+        }
+        if (IsFloat(str))
+        {
+            parsed.flags |= ArgDouble;
+        }
+        if (str == "t" || str == "f" || str == "true" || str == "false")
+        {
+            parsed.flags |= ArgBool;
+            parsed.bool_val = (str == "t" || str == "true");
+        }
+        if (IsRatio(str))
+        {
+            parsed.flags |= ArgRatio;
+        }
+    }
+    return parsed;
+}
+
+const Command::ParsedArg& Command::parsedArg(int index, ParseFlag ready_flag) const
+{
+    ParsedArg& parsed = this->classifiedArg(index);
+    if (!(parsed.flags & ready_flag))
+    {
+        // 与直接读取字符串的行为一致：转换失败时抛出异常，且不写入缓存
+        const string& str = this->cmds[index + 1];
+        if (ready_flag == IntReady)
+        {
+            parsed.int_val = stoi(str);
+        }
+        else if (ready_flag == DoubleReady)
+        {
+            parsed.double_val = stod(str);
+        }
+        else if (ready_flag == RatioReady)
+        {
+            auto [numer, denom] = ReadRatio(str);
+            parsed.numer = numer;
+            parsed.denom = denom;
+        }
+        parsed.flags |= ready_flag;
+    }
+    return parsed;
+}
+
 std::string Command::substring(int begin_i, int end_i) const
 {
     vector<string>::const_iterator begin_iter = this->cmds.begin();
@@ -20,6 +20,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -39,12 +40,57 @@ private:
 	std::string original;
 	// 拆分后的字符串
 	std::vector<std::string> cmds;
+	// 分派缓存：命令词对应的分派编号，以及各候选插件的参数检查结果。由ApplicationBus填写。
+	// 命令词或参数经非常量访问器取出时清空。
+	mutable int dispatch_id_ = -1;
+	mutable uint32_t checked_mask_ = 0;
+	mutable uint32_t valid_mask_ = 0;
+
+	// 参数解析缓存。每个参数的类型判断和数值转换都只进行一次。
+	struct ParsedArg
+	{
+		// 状态位，见ParseFlag
+		uint8_t flags = 0;
+		bool bool_val = false;
+		int int_val = 0;
+		double double_val = 0.0;
+		double numer = 0.0, denom = 1.0;
+	};
+	enum ParseFlag : uint8_t
+	{
+		Classified = 1 << 0,
+		ArgInt = 1 << 1,
+		ArgDouble = 1 << 2,
+		ArgBool = 1 << 3,
+		ArgRatio = 1 << 4,
+		IntReady = 1 << 5,
+		DoubleReady = 1 << 6,
+		RatioReady = 1 << 7
+	};
+	mutable std::vector<ParsedArg> parsed_args_;
+
+	// 在CommandMap中的插入序号和登记时的延迟权重，用于维护其按延迟分组的索引
+	friend class CommandMap;
+	uint64_t map_order_ = 0;
+	unsigned int map_level_ = 0;
+
+	/// 获取参数的解析缓存，首次访问时判断类型
+	ParsedArg& classifiedArg(int index) const;
+	/// 获取参数的解析缓存，并确保指定的数值已经转换
+	const ParsedArg& parsedArg(int index, ParseFlag ready_flag) const;
 public:
 	inline Command() = default;
 	/// 从字符串构造命令。拆分后转为全小写。
 	Command(const std::string& str, int time = 0);
 
 	inline Command(const Command&) = default;
+	inline Command(Command&&) = default;
+	inline Command& operator=(const Command&) = default;
+	inline Command& operator=(Command&&) = default;
+
+public:
+	/// 分派缓存可记录的候选插件数量
+	static constexpr int kCachedCandidates = 32;
 
 public:
 	/// 命令是否是空的（空字符串）
@@ -107,6 +153,19 @@ public:
 	inline bool matchesCommand(const std::string&, int delay = 0) const;
 	/// 检查该命令的命令词是否与输入参数匹配。
 	inline bool matchesType(const std::string&) const;
+
+	/// 获取缓存的分派编号。未缓存时返回-1。
+	inline int dispatchID() const;
+	/// 缓存分派编号。编号改变时，参数检查结果一并清空。
+	inline void setDispatchID(int id) const;
+	/// @brief 获取缓存的参数检查结果
+	/// @param candidate 候选插件在分派表中的下标
+	/// @return -1表示尚未检查，0表示不合法，1表示合法
+	inline int cachedCheck(int candidate) const;
+	/// 缓存参数检查结果
+	inline void cacheCheck(int candidate, bool valid) const;
+	/// 清空分派缓存
+	inline void clearDispatchCache() const;
 };
 
 /* INLINE FUNCTION */
@@ -35,6 +35,7 @@ inline int Command::argLength() const
 
 inline std::string& Command::cmd()
 {
+    this->clearDispatchCache();
     return this->cmds[0];
 }
 
@@ -65,6 +66,8 @@ inline unsigned int Command::delay() const
 
 inline std::string& Command::arg(int index)
 {
+    this->clearDispatchCache();
+    this->parsed_args_.clear();
     return this->cmds[index + 1];
 }
 
@@ -75,54 +78,43 @@ inline const std::string& Command::arg(int index) const
 
 inline bool Command::argIsInt(int index) const
 {
-    return IsDigit(this->cmds[index + 1]);
+    return this->classifiedArg(index).flags & ArgInt;
 }
 
 inline int Command::argAsInt(int index) const
 {
-    return stoi(this->cmds[index + 1]);
+    return this->parsedArg(index, IntReady).int_val;
 }
 
 inline bool Command::argIsDouble(int index) const
 {
-    return IsFloat(this->cmds[index + 1]);
+    return this->classifiedArg(index).flags & ArgDouble;
 }
 
 inline double Command::argAsDouble(int index) const
 {
-    return stod(this->cmds[index + 1]);
+    return this->parsedArg(index, DoubleReady).double_val;
 }
 
 inline bool Command::argIsBool(int index) const
 {
-    const std::string& str = this->cmds[index + 1];
-    if (str == "t" || str == "f" || str == "true" || str == "false")
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return this->classifiedArg(index).flags & ArgBool;
 }
 
 inline bool Command::argAsBool(int index) const
 {
-    const std::string& str = this->cmds[index + 1];
-    return str == "t" || str == "true";
+    return this->classifiedArg(index).bool_val;
 }
 
 inline bool Command::argIsRatio(int index) const
 {
-    return IsRatio(this->cmds[index + 1]);
+    return this->classifiedArg(index).flags & ArgRatio;
 }
 
 inline double Command::argAsRatio(int index, double amp) const
 {
-    // double numer, denom;
-    auto [numer, denom] = ReadRatio(this->cmds[index + 1]);
-
-    return numer * amp / denom;
+    const ParsedArg& parsed = this->parsedArg(index, RatioReady);
+    return parsed.numer * amp / parsed.denom;
 }
 
 inline double Command::argAsDoubleOrRatio(int index, double amp) const
@@ -165,4 +157,51 @@ inline bool Command::matchesCommand(const std::string& str, int delay) const
 inline bool Command::matchesType(const std::string& str) const
 {
     return this->cmd() == str;
-}
\ No newline at end of file
+}
+
+inline int Command::dispatchID() const
+{
+    return this->dispatch_id_;
+}
+
+inline void Command::setDispatchID(int id) const
+{
+    if (this->dispatch_id_ != id)
+    {
+        this->dispatch_id_ = id;
+        this->checked_mask_ = 0;
+        this->valid_mask_ = 0;
+    }
+}
+
+inline int Command::cachedCheck(int candidate) const
+{
+    if (candidate >= kCachedCandidates || !(this->checked_mask_ & (1u << candidate)))
+    {
+        return -1;
+    }
+    return (this->valid_mask_ >> candidate) & 1u;
+}
+
+inline void Command::cacheCheck(int candidate, bool valid) const
+{
+    if (candidate < kCachedCandidates)
+    {
+        this->checked_mask_ |= (1u << candidate);
+        if (valid)
+        {
+            this->valid_mask_ |= (1u << candidate);
+        }
+        else
+        {
+            this->valid_mask_ &= ~(1u << candidate);
+        }
+    }
+}
+
+inline void Command::clearDispatchCache() const
+{
+    this->dispatch_id_ = -1;
+    this->checked_mask_ = 0;
+    this->valid_mask_ = 0;
+}
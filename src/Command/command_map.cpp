@@ -22,6 +22,122 @@
 
 using namespace std;
 
+CommandMap::CommandMap(const CommandMap& other)
+    : content(other.content), next_order(other.next_order)
+{
+    this->RebuildIndex();
+}
+
+CommandMap& CommandMap::operator=(const CommandMap& other)
+{
+    if (this != &other)
+    {
+        this->content = other.content;
+        this->next_order = other.next_order;
+        this->RebuildIndex();
+    }
+    return *this;
+}
+
+void CommandMap::RebuildIndex()
+{
+    // 复制来的命令保留了原表中的插入序号，顺序不变
+    this->delay_levels.clear();
+    this->word_index.clear();
+    for (auto iter = this->content.begin(); iter != this->content.end(); ++iter)
+    {
+        const Command& cmd = iter->second;
+        this->delay_levels[cmd.map_level_].emplace(Position(iter->first, cmd.map_order_), iter);
+        this->word_index[IndexWord(cmd)].emplace(Position(iter->first, cmd.map_order_), iter);
+    }
+}
+
+vector<CommandMap::Iterator> CommandMap::CommandsOfWord(const string& word, Position from, Position to)
+{
+    vector<Iterator> output;
+    auto found = this->word_index.find(word);
+    if (found == this->word_index.end())
+    {
+        return output;
+    }
+
+    auto& positions = found->second;
+    for (auto iter = positions.upper_bound(from); iter != positions.end() && iter->first < to; ++iter)
+    {
+        output.push_back(iter->second);
+    }
+    return output;
+}
+
+vector<CommandMap::ConstIterator> CommandMap::UnpairedEndCommands() const
+{
+    map<Position, ConstIterator> unpaired;
+    for (const auto& [word, end_positions] : this->word_index)
+    {
+        if (word.compare(0, 4, "end ") != 0)
+        {
+            continue;
+        }
+
+        static const map<Position, Iterator> no_begin;
+        auto begin_word = this->word_index.find(word.substr(4));
+        const auto& begin_positions = begin_word == this->word_index.end() ? no_begin : begin_word->second;
+
+        // 按时间扫描：先计入不晚于结束命令时刻的起始命令，再由结束命令关闭其中一个
+        auto next_begin = begin_positions.begin();
+        int opened = 0;
+        for (const auto& [end_pos, end_iter] : end_positions)
+        {
+            while (next_begin != begin_positions.end() && next_begin->first.first <= end_pos.first)
+            {
+                ++opened;
+                ++next_begin;
+            }
+
+            if (opened > 0)
+            {
+                --opened;
+            }
+            else
+            {
+                unpaired.emplace(end_pos, end_iter);
+            }
+        }
+    }
+
+    vector<ConstIterator> output;
+    for (const auto& [pos, iter] : unpaired)
+    {
+        output.push_back(iter);
+    }
+    return output;
+}
+
+CommandMap::Iterator CommandMap::NextScheduled(unsigned int max_delay, Position& cursor)
+{
+    Iterator found = this->content.end();
+    Position found_pos;
+    for (auto& [level, positions] : this->delay_levels)
+    {
+        if (level > max_delay)
+        {
+            break;
+        }
+        auto next = positions.upper_bound(cursor);
+        if (next != positions.end() && (found == this->content.end() || next->first < found_pos))
+        {
+            found = next->second;
+            found_pos = next->first;
+        }
+    }
+
+    if (found != this->content.end())
+    {
+        cursor = found_pos;
+    }
+    return found;
+}
+
 void CommandMap::ImportFromString(const string& str)
 {
     // 这里不拆最外层的大括号。相应地，在Command解析每个命令的时候会拆掉一层大括号。
@@ -31,8 +147,7 @@ void CommandMap::ImportFromString(const string& str)
     for (auto& cmd : command_str_split)
     {
         Strip(cmd);
-        Command command(cmd, 0);
-        this->content.insert({0, command});
+        this->insert(0, Command(cmd, 0));
     }
 }
 
@@ -50,8 +165,7 @@ void CommandMap::ImportFromComment(const IndexList<string>& lst)
         for (auto& cmd : command_str_split)
         {
             Strip(cmd);
-            Command command(cmd, time);
-            this->content.insert({time, command});
+            this->insert(time, Command(cmd, time));
         }
     }
 }
@@ -89,12 +203,9 @@ IndexList<string> CommandMap::ExportToComment() const
 
 void CommandMap::ChangeKey(Iterator& iter, int new_key)
 {
-    Iterator backup = iter;
-    Command cmd = backup->second;
+    Command cmd = this->Take(iter);
     cmd.time() = new_key;
-    ++iter;
-    this->erase(backup);
-    this->content.insert({new_key, cmd});
+    this->insert(new_key, std::move(cmd));
 }
 
 CommandMap CommandMap::Offset(int offset_time) const
@@ -20,25 +20,55 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <climits>
+#include <cstdint>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "command.h"
 #include "src/IndexList/index_list.h"
 
 /// 存储一系列命令的表。同时被用于表示谱面所有命令的总表和一个batch所包含的命令。
 /// 命令表的索引是执行时刻（影响执行顺序），而命令自带的time属性是作用时刻。
+///
+/// 表内另有按延迟权重分组的索引，执行时可以直接取出不超过某一延迟权重的下一条命令，
+/// 而不必扫描整张表；以及按命令词分组的索引，用于查找成对的起始/结束命令。
+/// 因此对表的修改都需要经由成员函数进行。
 class CommandMap {
 
 public:
 	using Iterator = std::multimap<int, Command>::iterator;
 	using ConstIterator = std::multimap<int, Command>::const_iterator;
+	/// 命令在表中的位置：执行时刻和插入序号。其先后顺序与表中的顺序一致。
+	using Position = std::pair<int, uint64_t>;
 
-public:
+	/// 位于所有命令之前的位置
+	static constexpr Position kBeginPosition = {INT_MIN, 0};
+
+private:
 	std::multimap<int, Command> content;
+	// 延迟权重 -> 该权重下所有命令的位置
+	std::map<unsigned int, std::map<Position, Iterator>> delay_levels;
+	// 命令词 -> 该命令词下所有命令的位置
+	std::unordered_map<std::string, std::map<Position, Iterator>> word_index;
+	// 下一个插入序号
+	uint64_t next_order = 1;
+
+	/// 将新插入的命令登记到索引
+	inline void IndexInsert(Iterator iter);
+	/// 将即将删除的命令从索引中移除。命令此时不能已被移出
+	inline void IndexErase(Iterator iter);
+	/// 根据content重建索引
+	void RebuildIndex();
 
 public:
 	inline CommandMap() = default;
-	inline CommandMap(const CommandMap&) = default;
+	CommandMap(const CommandMap& other);
+	inline CommandMap(CommandMap&&) = default;
+	CommandMap& operator=(const CommandMap& other);
+	inline CommandMap& operator=(CommandMap&&) = default;
 
 	/// 从IndexedChart的注释表构造
 	inline CommandMap(const IndexList<std::string>& lst);
@@ -54,6 +84,8 @@ public:
 	inline void insert(int time, Command cmd);
 	/// 删除一个command对象，以迭代器导航。迭代器会被引导到下一个命令。
 	inline void erase(Iterator& iter);
+	/// 将迭代器所指的命令移出并从表中删除。迭代器会被引导到下一个命令。
+	inline Command Take(Iterator& iter);
 
 	/// 命令表是否为空
 	inline bool Empty() const;
@@ -86,9 +118,22 @@ public:
 	/// 同std::multimap的upper_bound
 	inline Iterator upper_bound(int key);
 
-	
-	
-	
+	/// @brief 按表中的顺序，获取位于cursor之后、延迟权重不超过max_delay的下一条命令
+	/// @param cursor 起始位置。找到命令时被更新为该命令的位置
+	/// @return 不存在时返回end()
+	Iterator NextScheduled(unsigned int max_delay, Position& cursor);
+	/// 表中大于delay的最小延迟权重。不存在时返回UINT_MAX
+	inline unsigned int NextDelayLevel(unsigned int delay) const;
+
+	/// 命令在索引中所属的命令词。结束命令以"end xxx"整体作为命令词
+	static inline std::string IndexWord(const Command& cmd);
+	/// 迭代器所指命令在表中的位置
+	inline Position PositionOf(ConstIterator iter) const;
+	/// 按表中的顺序列出命令词为word、位置在(from, to)之间的命令
+	std::vector<Iterator> CommandsOfWord(const std::string& word, Position from, Position to);
+	/// @brief 将起始命令与结束命令像括号一样按时间配对，列出无法配对的结束命令。
+	/// 同一时刻的起始命令先于结束命令参与配对，与FindNearestCommand的查找范围一致。
+	std::vector<ConstIterator> UnpairedEndCommands() const;
 };
 
 /* INLINE FUNCTION */
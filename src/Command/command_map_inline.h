@@ -26,23 +26,83 @@ inline CommandMap::CommandMap(const IndexList<std::string>& lst) {
     this->ImportFromComment(lst);
 }
 
+inline void CommandMap::IndexInsert(Iterator iter) {
+    Command& cmd = iter->second;
+    cmd.map_order_ = this->next_order++;
+    cmd.map_level_ = cmd.delay();
+    this->delay_levels[cmd.map_level_].emplace(Position(iter->first, cmd.map_order_), iter);
+    this->word_index[IndexWord(cmd)].emplace(Position(iter->first, cmd.map_order_), iter);
+}
+
+inline void CommandMap::IndexErase(Iterator iter) {
+    const Command& cmd = iter->second;
+    auto level = this->delay_levels.find(cmd.map_level_);
+    if (level != this->delay_levels.end()) {
+        level->second.erase(Position(iter->first, cmd.map_order_));
+        if (level->second.empty()) {
+            this->delay_levels.erase(level);
+        }
+    }
+    auto word = this->word_index.find(IndexWord(cmd));
+    if (word != this->word_index.end()) {
+        word->second.erase(Position(iter->first, cmd.map_order_));
+        if (word->second.empty()) {
+            this->word_index.erase(word);
+        }
+    }
+}
+
 inline void CommandMap::insert(int time, Command cmd) {
-    this->content.insert({ time, cmd });
+    Iterator iter = this->content.insert({ time, std::move(cmd) });
+    this->IndexInsert(iter);
 }
 
 inline void CommandMap::erase(Iterator& iter) {
     Iterator backup = iter;
     ++iter;
+    this->IndexErase(backup);
     this->content.erase(backup);
 }
 
+inline Command CommandMap::Take(Iterator& iter) {
+    Iterator backup = iter;
+    ++iter;
+    this->IndexErase(backup);
+    Command cmd = std::move(backup->second);
+    this->content.erase(backup);
+    return cmd;
+}
+
+inline unsigned int CommandMap::NextDelayLevel(unsigned int delay) const {
+    auto level = this->delay_levels.upper_bound(delay);
+    return level == this->delay_levels.end() ? UINT_MAX : level->first;
+}
+
+inline std::string CommandMap::IndexWord(const Command& cmd) {
+    if (cmd.cmd() == "end" && cmd.argLength() > 0) {
+        return "end " + cmd.arg(0);
+    }
+    return cmd.cmd();
+}
+
+inline CommandMap::Position CommandMap::PositionOf(ConstIterator iter) const {
+    return Position(iter->first, iter->second.map_order_);
+}
+
 inline CommandMap::Iterator CommandMap::FindNearestCommand(const std::string& cmd_str, int start_time, int delay) {
-    Iterator start = this->content.lower_bound(start_time);
-    Iterator end = this->content.end();
+    // 只在同一命令词的命令中查找
+    auto word = this->word_index.find(IndexWord(Command(cmd_str, start_time)));
+    if (word == this->word_index.end()) {
+        return this->end();
+    }
 
-    return std::find_if(start, end, [&cmd_str, delay](const std::pair<const int, Command>& item) {
-        return item.second.matchesCommand(cmd_str, delay);
-        });
+    auto& positions = word->second;
+    for (auto iter = positions.lower_bound(Position(start_time, 0)); iter != positions.end(); ++iter) {
+        if (iter->second->second.matchesCommand(cmd_str, delay)) {
+            return iter->second;
+        }
+    }
+    return this->end();
 }
 
 inline CommandMap::Iterator CommandMap::lower_bound(int key) {
@@ -0,0 +1,329 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "console_ui.h"
+
+#include <iostream>
+
+#if defined(WIN32) || defined(WIN64)
+
+int DaemonEntrance(int /*argc*/, char** /*argv*/)
+{
+    std::cerr << "Server mode is not available on Windows." << std::endl;
+    return 1;
+}
+
+#else
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+常驻服务模式。
+
+插件注册表和编译过的batch文件都在进程内共享，所以除第一次以外的请求都不需要重新构建。
+请求和回复都是以\n结尾的行，字段之间以\t分隔：
+    process <input> [output] [cwd]   ->  log <...> ... 然后 done <errors> <warnings> 或者 failed
+                                         相对路径按客户端给出的cwd解析，没有给出cwd时只接受绝对路径
+    ping                       ->  pong
+    shutdown                   ->  bye，之后停止接受新的连接，已有的连接断开后退出
+*/
+
+static atomic<bool> stopping{false};
+static int listen_fd = -1;
+
+/// SIGINT、SIGTERM：与shutdown请求相同，停止接受新的连接，由主线程清理socket文件。再收到一次时直接退出
+static void HandleStopSignal(int /*signal*/)
+{
+    stopping = true;
+    shutdown(listen_fd, SHUT_RDWR);
+}
+
+/// 删除上一次没有正常退出时留下的socket文件。路径上是其他文件时不删除，返回false
+static bool RemoveStaleSocket(const string& path)
+{
+    struct stat info;
+    if (lstat(path.c_str(), &info) < 0)
+    {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(info.st_mode))
+    {
+        return false;
+    }
+    unlink(path.c_str());
+    return true;
+}
+
+static bool SendAll(int fd, const string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/// 处理一行请求，返回回复内容
+static string HandleRequest(const string& line)
+{
+    vector<string> fields;
+    size_t begin = 0;
+    while (begin <= line.size())
+    {
+        size_t end = line.find('\t', begin);
+        if (end == string::npos)
+        {
+            end = line.size();
+        }
+        fields.push_back(line.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    if (fields[0] == "ping")
+    {
+        return "pong\n";
+    }
+    if (fields[0] == "shutdown")
+    {
+        stopping = true;
+        // 唤醒阻塞在accept上的主线程
+        shutdown(listen_fd, SHUT_RDWR);
+        return "bye\n";
+    }
+    if (fields[0] != "process" || fields.size() < 2 || fields[1].empty())
+    {
+        return "failed\tbad request\n";
+    }
+
+    // 相对路径是相对客户端的工作目录而言的，不能按服务自己的工作目录解析
+    const filesystem::path cwd = fields.size() > 3 ? fields[3] : "";
+    const auto resolve = [&cwd](const string& path, string& resolved) {
+        filesystem::path file_path(path);
+        if (file_path.is_absolute())
+        {
+            resolved = path;
+            return true;
+        }
+        if (!cwd.is_absolute())
+        {
+            return false;
+        }
+        resolved = (cwd / file_path).lexically_normal().string();
+        return true;
+    };
+
+    string input, output;
+    if (!resolve(fields[1], input))
+    {
+        return "failed\trelative path without an absolute cwd\n";
+    }
+    if (fields.size() > 2 && !fields[2].empty())
+    {
+        if (!resolve(fields[2], output))
+        {
+            return "failed\trelative path without an absolute cwd\n";
+        }
+    }
+    else
+    {
+        output = AddPostfix(input);
+    }
+
+    ostringstream log;
+    ChartJobResult result = ProcessChartJob(input, output, log);
+
+    // 日志逐行加上前缀，避免和结果行混淆
+    string reply;
+    istringstream log_lines(log.str());
+    string log_line;
+    while (getline(log_lines, log_line))
+    {
+        reply += "log\t" + log_line + "\n";
+    }
+    if (result.success)
+    {
+        reply += "done\t" + to_string(result.error_count) + "\t" + to_string(result.warning_count) + "\n";
+    }
+    else
+    {
+        reply += "failed\n";
+    }
+    return reply;
+}
+
+/// 一个连接及其处理线程
+struct Connection
+{
+    thread worker;
+    // 处理线程结束时置位，之后可以立刻join
+    atomic<bool> finished{false};
+};
+
+/// 处理一个连接上的全部请求
+static void ServeConnection(int fd)
+{
+    string buffer;
+    char chunk[4096];
+    while (true)
+    {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+
+        size_t line_end;
+        while ((line_end = buffer.find('\n')) != string::npos)
+        {
+            string line = buffer.substr(0, line_end);
+            buffer.erase(0, line_end + 1);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty() && !SendAll(fd, HandleRequest(line)))
+            {
+                close(fd);
+                return;
+            }
+        }
+    }
+    close(fd);
+}
+
+int DaemonEntrance(int argc, char** argv)
+{
+    string socket_path = argc > 0 ? argv[0] : "kshram.sock";
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path is too long." << endl;
+        return 1;
+    }
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    // 上一次没有正常退出时会留下socket文件。其他文件不能删除，比如把谱面误当作socket路径时
+    if (!RemoveStaleSocket(socket_path))
+    {
+        cerr << socket_path << " already exists and is not a socket." << endl;
+        return 1;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        cerr << "Failed to create socket: " << strerror(errno) << endl;
+        return 1;
+    }
+    // 服务以当前用户的身份读写文件，socket只允许当前用户连接
+    mode_t old_mask = umask(0077);
+    bool bound = bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(old_mask);
+    if (!bound || chmod(socket_path.c_str(), 0600) < 0 || listen(listen_fd, 16) < 0)
+    {
+        cerr << "Failed to listen on " << socket_path << ": " << strerror(errno) << endl;
+        close(listen_fd);
+        RemoveStaleSocket(socket_path);
+        return 1;
+    }
+    // 客户端提前断开时不退出
+    signal(SIGPIPE, SIG_IGN);
+    // 被中断或者终止时同样走下面的清理，不留下socket文件。不自动重启accept，以便及时醒来
+    struct sigaction stop_action{};
+    stop_action.sa_handler = HandleStopSignal;
+    sigemptyset(&stop_action.sa_mask);
+    stop_action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &stop_action, nullptr);
+    sigaction(SIGTERM, &stop_action, nullptr);
+
+    cout << "KSHRAM is listening on " << socket_path << "." << endl;
+
+    // 每个连接一个线程，谱面之间互不影响。已经结束的线程在每次accept之后回收
+    list<unique_ptr<Connection>> connections;
+    while (!stopping)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        for (auto iter = connections.begin(); iter != connections.end();)
+        {
+            if ((*iter)->finished)
+            {
+                (*iter)->worker.join();
+                iter = connections.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        connections.push_back(make_unique<Connection>());
+        Connection* connection = connections.back().get();
+        connection->worker = thread([connection, fd]() {
+            ServeConnection(fd);
+            connection->finished = true;
+        });
+    }
+
+    for (auto& connection : connections)
+    {
+        connection->worker.join();
+    }
+    close(listen_fd);
+    RemoveStaleSocket(socket_path);
+    cout << "KSHRAM server stopped." << endl;
+
+    return 0;
+}
+
+#endif
@@ -18,38 +18,149 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "console_ui.h"
+#include "result_cache.h"
 
 #include "src/Application/application_bus.h"
+#include "src/Application/chart_streamer.h"
+#include "src/Application/execution_record.h"
 #include "src/Chart/chart.h"
+#include "src/Chart/chart_diff.h"
+#include "src/Chart/chart_patch.h"
+#include "src/Chart/chart_snapshot.h"
+#include "src/Chart/kson.h"
 #include "src/FileSystem/path_manager.h"
+#include "src/misc/worker_pool.h"
+#include "src/misc/utilities.h"
 #include "versions.h"
 
 using namespace std;
 
-int ExecuteCommand(const string& input, const string& output)
+/// 文件是否为KSON格式（以扩展名判断）
+static bool IsKsonFile(const string& path)
+{
+    string ext = filesystem::path(path).extension().string();
+    ToLower(ext);
+    return ext == ".kson";
+}
+
+/// 按path的扩展名，从ksh或者KSON读入谱面
+static bool LoadChart(const string& path, const string& content, Chart& chart)
+{
+    if (!IsKsonFile(path))
+    {
+        return !content.empty() && chart.ImportFromString(content);
+    }
+    IndexedChart ic;
+    Header header;
+    if (!ImportFromKson(content, ic, header))
+    {
+        return false;
+    }
+    chart = ic.ExportToChart();
+    chart.GetHeader() = header;
+    return true;
+}
+
+/// 按path的扩展名，将谱面导出为ksh或者KSON
+static string ExportChart(const string& path, Chart& chart)
+{
+    if (!IsKsonFile(path))
+    {
+        return chart.ExportToString();
+    }
+    IndexedChart ic(chart);
+    ostringstream ss;
+    ExportToKson(ic, chart.GetHeader(), ss);
+    return ss.str();
+}
+
+/// 写入任务的输出。要求输出补丁时，补丁比完整的谱面短才写入相对于输入的补丁output.patch，
+/// 并删掉以前留下的完整谱面；否则写入完整的谱面并删掉以前留下的补丁
+static bool WriteJobOutput(const string& input, const string& input_content, const string& output,
+                           const string& output_content, const ChartJobOptions& options)
+{
+    if (!options.patch || IsKsonFile(input) || IsKsonFile(output))
+    {
+        return PathManager::SaveFileIfChanged(output, output_content);
+    }
+    const string patch_path = output + ".patch";
+    const string patch = ChartPatch::Diff(input_content, output_content).ExportToString();
+    error_code ec;
+    if (patch.size() < output_content.size())
+    {
+        if (!PathManager::SaveFileIfChanged(patch_path, patch))
+        {
+            return false;
+        }
+        // 旧的完整谱面已经与这次的结果不一致。输出就是输入时不能删除，补丁要依靠它
+        if (!filesystem::equivalent(input, output, ec))
+        {
+            filesystem::remove(output, ec);
+        }
+        return true;
+    }
+    filesystem::remove(patch_path, ec);
+    return PathManager::SaveFileIfChanged(output, output_content);
+}
+
+/// 读入增量执行时上次的输出。输出文件与记录中的一致时直接读入快照，否则重新解析输出文件
+static bool LoadPreviousOutput(const string& output, const ExecutionRecord& previous, Chart& previous_chart,
+                               IndexedChart& previous_output)
+{
+    ChartSnapshot snapshot;
+    if (previous.output_file != 0 && HashString(PathManager::LoadFile(output)) == previous.output_file &&
+        snapshot.Open(ExecutionRecord::SnapshotPathFor(output)) && previous_output.ImportFromSnapshot(snapshot))
+    {
+        return true;
+    }
+    if (!previous_chart.ImportFromFile(output))
+    {
+        return false;
+    }
+    previous_output.ImportFromChart(previous_chart);
+    return true;
+}
+
+/// 保存本次输出的快照，并在记录中写下输出文件的哈希，供下次增量执行读入
+static void SavePreviousOutput(const string& output, const string& output_content, Chart& chart_out,
+                               ExecutionRecord& record)
+{
+    IndexedChart output_chart(chart_out);
+    const bool saved = ChartSnapshot::Save(ExecutionRecord::SnapshotPathFor(output), output_chart.ExportToSnapshot());
+    record.output_file = saved ? HashString(output_content) : 0;
+}
+
+int ExecuteCommand(const string& input, const string& output, int workers = 1)
 {
     Chart chart;
-    if (!chart.ImportFromFile(input))
+    if (!LoadChart(input, PathManager::LoadFile(input), chart))
     {
         cerr << "Failed to open input file!" << endl;
         return 1;
     }
 
-    ApplicationBus& bus = ApplicationBus::GetInstance();
+    ApplicationBus bus;
+    bus.SetWorkerCount(workers);
     try
     {
         bus.BindChart(std::move(chart));
         bus.RunCommands();
 
-        Chart chart_out = bus.GetChart();
-
-        chart_out.GetHeader() = chart.GetHeader();
-        chart_out.GetCustomFX() = chart.GetCustomFX();
-
-        chart_out.ExportToFile(output);
+        Chart chart_out = bus.TakeChart();
+        PathManager::SaveFile(output, ExportChart(output, chart_out));
     }
     catch (std::exception& e)
     {
@@ -69,15 +180,260 @@ int ExecuteCommand(const string& input, const string& output)
         cout << "Total Warnings: " << err_collector.WarningCount() << endl;
     }
 
-    ApplicationBus::GetInstance().Reset();
-
     return 0;
 }
 
-inline string AddPostfix(const string& ksh)
+bool ParseMeasureRange(const string& text, ChartJobOptions& options)
+{
+    int first = 0, last = 0;
+    char dash = 0, rest = 0;
+    istringstream ss(text);
+    if (!(ss >> first))
+    {
+        return false;
+    }
+    last = first;
+    if (ss >> dash && (dash != '-' || !(ss >> last) || ss >> rest))
+    {
+        return false;
+    }
+    if (first < 1 || last < first)
+    {
+        return false;
+    }
+    options.first_measure = first;
+    options.last_measure = last;
+    return true;
+}
+
+/// @brief 只执行一段小节内的命令。处理的是整张谱面的副本，结果只写回这一段，其余小节保持原样
+/// @param first 起始小节（从1开始）
+/// @param last 结束小节（包括在内）
+/// @note chart的内容移交给chart_out
+static bool RunCommandsInWindow(ApplicationBus& bus, Chart& chart, int first, int last, Chart& chart_out, ostream& log)
+{
+    const int measure_count = chart.Grid().MeasureCount();
+    first = first - 1;
+    last = min(last, measure_count) - 1;
+    if (first > last)
+    {
+        log << "The measure range is outside the chart." << endl;
+        return false;
+    }
+
+    // 范围以外的命令不执行，但batch define、batch import等定义照常执行，它们多半写在谱面开头。
+    // 其余小节也提供上下文，比如范围开头之前生效的标记和跨过边界的长条
+    Chart copy = chart.ExtractMeasures(0, measure_count - 1);
+    const int window_count = last - first + 1;
+
+    const int window_start = copy[first].StartTime();
+    const int window_end = copy[last].EndTime();
+
+    bus.BindChart(std::move(copy));
+    bus.SetTimeWindow(window_start, window_end);
+    bus.RunCommands();
+
+    chart_out = std::move(chart);
+    if (!chart_out.ReplaceMeasures(first, window_count, bus.GetChart(), first))
+    {
+        log << "The lengths of the measures in the range were changed, so they can not be merged back." << endl;
+        return false;
+    }
+    return true;
+}
+
+/// 流式处理一张ksh谱面。输出先写入临时文件，完成后替换
+static ChartJobResult StreamChartJob(const string& input, const string& output, ostream& log,
+                                     const ChartJobOptions& options)
+{
+    ChartJobResult result;
+    ifstream is(input);
+    if (!is)
+    {
+        log << "Failed to open input file!" << endl;
+        return result;
+    }
+
+    filesystem::path input_path(input), output_path(output);
+    PathManager paths = PathManager::GetInstance();
+    paths.AddPath(input_path.parent_path().string());
+    if (output_path.has_parent_path())
+    {
+        filesystem::create_directories(output_path.parent_path());
+    }
+
+    ApplicationBus bus(paths);
+    bus.SetWorkerCount(1);
+    ErrorCollector& err_collector = bus.GetErrorCollector();
+    err_collector.SetOutput(&log);
+
+    const string temp_path = output + ".tmp";
+    try
+    {
+        ofstream os(temp_path);
+        string error;
+        ChartStreamer streamer(bus, {options.stream_window, options.stream_lookahead});
+        bool success = streamer.Run(is, os, error);
+        os.close();
+        if (!success || !os)
+        {
+            log << (success ? "Failed to write output file!" : error) << endl;
+            filesystem::remove(temp_path);
+            return result;
+        }
+        filesystem::rename(temp_path, output);
+    }
+    catch (std::exception& e)
+    {
+        log << "Unhandled exception occured:\n"
+            << e.what() << "\n";
+        return result;
+    }
+
+    result.success = true;
+    result.error_count = err_collector.ErrorCount();
+    result.warning_count = err_collector.WarningCount();
+    result.dependencies = bus.Dependencies();
+    return result;
+}
+
+ChartJobResult ProcessChartJob(const string& input, const string& output, ostream& log,
+                               const ChartJobOptions& options)
+{
+    // 流式处理不把整张谱面读入内存
+    if (options.stream_window > 0 && !IsKsonFile(input) && !IsKsonFile(output))
+    {
+        return StreamChartJob(input, output, log, options);
+    }
+
+    ChartJobResult result;
+    const string content = PathManager::LoadFile(input);
+    Chart chart;
+    if (!LoadChart(input, content, chart))
+    {
+        log << "Failed to open input file!" << endl;
+        return result;
+    }
+
+    // 谱面所在目录也是batch文件的搜索路径
+    filesystem::path input_path(input), output_path(output);
+    PathManager paths = PathManager::GetInstance();
+    paths.AddPath(input_path.parent_path().string());
+
+    if (output_path.has_parent_path())
+    {
+        filesystem::create_directories(output_path.parent_path());
+    }
+
+    // 只处理一段小节时，输出和执行记录都不完整，不参与缓存和增量执行
+    const bool windowed = options.first_measure > 0;
+
+    // 命中缓存时直接使用上次的输出和日志，不再执行任何命令
+    const bool use_cache = !options.cache_dir.empty() && !windowed;
+    ResultCache cache(use_cache ? options.cache_dir : string());
+    const uint64_t cache_key = use_cache ? ResultCache::Key(content, paths) : 0;
+    ResultCache::Entry entry;
+    if (use_cache && cache.Lookup(cache_key, entry))
+    {
+        if (!WriteJobOutput(input, content, output, entry.output, options))
+        {
+            log << "Failed to write output file!" << endl;
+            return result;
+        }
+        log << entry.log;
+        return entry.result;
+    }
+
+    ApplicationBus bus(paths);
+    // 调用方自己负责在谱面之间并行，单张谱面内不再另开线程
+    bus.SetWorkerCount(1);
+    ErrorCollector& err_collector = bus.GetErrorCollector();
+    // 需要写入缓存时先把日志留下来
+    ostringstream captured_log;
+    err_collector.SetOutput(use_cache ? &captured_log : &log);
+    const bool incremental = options.incremental && !windowed;
+
+    // 增量执行需要上次的记录和输出，两者缺一时全部重新执行
+    const string record_path = ExecutionRecord::PathFor(output);
+    ExecutionRecord previous, record;
+    Chart previous_chart;
+    IndexedChart previous_output;
+    if (!incremental || !previous.Load(record_path) ||
+        !LoadPreviousOutput(output, previous, previous_chart, previous_output))
+    {
+        previous.valid = false;
+    }
+
+    try
+    {
+        Chart chart_out;
+        if (windowed)
+        {
+            if (!RunCommandsInWindow(bus, chart, options.first_measure, options.last_measure, chart_out, log))
+            {
+                return result;
+            }
+        }
+        else if (incremental)
+        {
+            bus.BindChart(std::move(chart));
+            int skipped = bus.RunCommandsIncremental(previous, previous_output, record);
+            if (skipped > 0)
+            {
+                log << "Reused the results of " << skipped << " unchanged command(s) from the previous run." << endl;
+            }
+            chart_out = bus.TakeChart();
+        }
+        else
+        {
+            bus.BindChart(std::move(chart));
+            bus.RunCommands();
+            chart_out = bus.TakeChart();
+        }
+
+        // 内容没有变化时不改写输出，免得下游以为谱面又更新了
+        entry.output = ExportChart(output, chart_out);
+        // 写入失败时不留下记录和缓存，免得下次把没写成的结果当作上次的输出
+        if (!WriteJobOutput(input, content, output, entry.output, options))
+        {
+            log << captured_log.str();
+            log << "Failed to write output file!" << endl;
+            return result;
+        }
+        if (incremental)
+        {
+            SavePreviousOutput(output, entry.output, chart_out, record);
+            record.Save(record_path);
+        }
+    }
+    catch (std::exception& e)
+    {
+        log << captured_log.str();
+        log << "Unhandled exception occured:\n"
+            << e.what() << "\n";
+        return result;
+    }
+
+    result.success = true;
+    result.error_count = err_collector.ErrorCount();
+    result.warning_count = err_collector.WarningCount();
+    result.dependencies = bus.Dependencies();
+
+    if (use_cache)
+    {
+        entry.result = result;
+        entry.log = captured_log.str();
+        log << entry.log;
+        cache.Store(cache_key, entry);
+    }
+    return result;
+}
+
+string AddPostfix(const string& ksh)
 {
     string output = ksh;
-    output.insert(ksh.find_last_of('.'), "_out");
+    size_t ext_pos = ksh.find_last_of('.');
+    output.insert(ext_pos != string::npos ? ext_pos : ksh.size(), "_out");
 
     return output;
 }
@@ -100,9 +456,64 @@ void HelpMessage()
          << "1. Interactive Start:\n"
          << "\trun KSHRAM.exe directly (with no args).\n"
          << "2. Open in a terminal:\n"
-         << "\tKSHRAM.exe [input file] ([output file])\n"
+         << "\tKSHRAM.exe [-j N] [input file] ([output file])\n"
          << "\tOutput file name is optional.\n"
-         << "\tIf not given, the output file will be named \"xxx_out.ksh\".\n";
+         << "\tWith -j N, commands that touch different lanes run on N threads (default: 1).\n"
+         << "\tIf not given, the output file will be named \"xxx_out.ksh\".\n"
+         << "\tFiles ending in .kson are read and written in the KSON (JSON) chart format.\n"
+         << "3. Batch mode:\n"
+         << "\tKSHRAM.exe --batch [options] [files, directories or patterns like songs/*.ksh...]\n"
+         << "\tDirectories are searched recursively for .ksh files.\n"
+         << "\t-j, --jobs N        process N charts at the same time (default: CPU count)\n"
+         << "\t-o, --output-dir D  write outputs into D, keeping the layout under each input directory\n"
+         << "\t--suffix S          append S to output file names (default: _out)\n"
+         << "\t--incremental       only re-run commands whose input or definition changed since the\n"
+         << "\t                    last run (a .kshram record and a .kshsnap snapshot of the output\n"
+         << "\t                    are kept next to each output); commands that touch the whole chart\n"
+         << "\t                    (swing, tiltstyle, camera amp) are only reused when no notes,\n"
+         << "\t                    lasers or other commands changed\n"
+         << "\t--cache D           reuse whole results from the cache directory D when the chart, the\n"
+         << "\t                    batch files it imports and the program version are all unchanged\n"
+         << "\t--patch             write only the changed lines as a patch (output file + \".patch\")\n"
+         << "\t                    when it is smaller than the whole chart, and remove an older whole\n"
+         << "\t                    chart; otherwise the whole chart is written and an older patch is\n"
+         << "\t                    removed. .kson files are always written in full\n"
+         << "\t--measures A-B      only run the commands in measures A to B (counted from 1) for a quick\n"
+         << "\t                    preview; other measures are written out unchanged (batch define\n"
+         << "\t                    and batch import still run wherever they are)\n"
+         << "\t--stream N          read, process and write N measures at a time to bound memory use on\n"
+         << "\t                    very long charts (.ksh only; --incremental, --cache, --patch and\n"
+         << "\t                    --measures are ignored)\n"
+         << "\t--lookahead L       with --stream, read at least L measures past the current ones\n"
+         << "\t                    (default: 8); paired end commands and svfx lengths extend this.\n"
+         << "\t                    Other commands whose effects reach past the measures read (such\n"
+         << "\t                    as long batch calls) give different results from a normal run;\n"
+         << "\t                    raise L if so. Commands that add measures at the end of the\n"
+         << "\t                    chart make the rest of the chart be read at once\n"
+         << "4. Server mode (not available on Windows):\n"
+         << "\tKSHRAM.exe --serve [socket path]\n"
+         << "\tListens on a local socket (default: kshram.sock) for requests, one per line:\n"
+         << "\t  process<TAB>input<TAB>output<TAB>cwd\n"
+         << "\t                                process a chart; output and cwd are optional, relative\n"
+         << "\t                                paths are resolved against cwd and need it to be given\n"
+         << "\t  ping                          check that the server is alive\n"
+         << "\t  shutdown                      stop the server\n"
+         << "\tEach log line is sent back as \"log<TAB>...\", followed by\n"
+         << "\t\"done<TAB>errors<TAB>warnings\" or \"failed\".\n"
+         << "\tOnly the current user can connect to the socket.\n"
+         << "5. Watch mode:\n"
+         << "\tKSHRAM.exe --watch [--measures A-B] [input file] ([output file])\n"
+         << "\tProcesses the chart, then again every time it or a batch file it imports is saved.\n"
+         << "\tWith --measures, only the commands in measures A to B are run.\n"
+         << "6. Apply a patch:\n"
+         << "\tKSHRAM.exe --apply [chart file] [patch file] ([output file])\n"
+         << "\tRebuilds the full output from the chart and a patch written by --patch.\n"
+         << "\tIf no output file is given, the chart is updated in place.\n"
+         << "7. Compare two charts:\n"
+         << "\tKSHRAM.exe --diff [--tolerance X] [old chart] [new chart]\n"
+         << "\tLists the notes, lasers and marks added, removed or changed in the new chart.\n"
+         << "\tNumeric mark values within X of each other count as equal (default: 0).\n"
+         << "\tExits with 0 if nothing changed, and 1 otherwise.\n";
 }
 
 void VersionMessage()
@@ -169,6 +580,403 @@ void InteractiveStart()
     }
 }
 
+/* #region 批量处理 */
+
+/// 批量处理的命令行选项
+struct BatchOptions
+{
+    /// 输入：文件、目录或者文件名中带有*和?的通配路径
+    vector<string> inputs;
+    /// 输出目录。为空时输出到输入文件所在的目录
+    string output_dir;
+    /// 输出文件名的后缀
+    string suffix = "_out";
+    /// 同时处理的谱面数
+    int jobs = max(1, static_cast<int>(thread::hardware_concurrency()));
+    /// 每张谱面的处理选项
+    ChartJobOptions job_options;
+};
+
+/// 批量处理中的一张谱面
+struct BatchJob
+{
+    filesystem::path input;
+    filesystem::path output;
+    ChartJobResult result;
+    /// 处理期间的全部日志，按输入顺序统一输出
+    ostringstream log;
+};
+
+/// 文件名通配匹配，支持*和?
+static bool MatchWildcard(const string& pattern, const string& name)
+{
+    size_t p = 0, n = 0;
+    size_t star = string::npos, resume = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            resume = n;
+        }
+        else if (star != string::npos)
+        {
+            p = star + 1;
+            n = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+static bool IsChartFile(const filesystem::path& path)
+{
+    string ext = path.extension().string();
+    ToLower(ext);
+    return ext == ".ksh" || ext == ".kson";
+}
+
+/// 计算输出路径。relative为输入相对于所在输入目录的路径
+static filesystem::path BatchOutputPath(const BatchOptions& options, const filesystem::path& input,
+                                        const filesystem::path& relative)
+{
+    string file_name = input.stem().string() + options.suffix + input.extension().string();
+    if (options.output_dir.empty())
+    {
+        return input.parent_path() / file_name;
+    }
+    return filesystem::path(options.output_dir) / relative.parent_path() / file_name;
+}
+
+/// 将命令行输入展开为谱面列表。同一个文件只处理一次
+static vector<unique_ptr<BatchJob>> CollectBatchJobs(const BatchOptions& options)
+{
+    vector<unique_ptr<BatchJob>> jobs;
+    set<filesystem::path> visited;
+
+    auto add_job = [&](const filesystem::path& input, const filesystem::path& relative) {
+        if (!visited.insert(filesystem::weakly_canonical(input)).second)
+        {
+            return;
+        }
+        auto job = make_unique<BatchJob>();
+        job->input = input;
+        job->output = BatchOutputPath(options, input, relative);
+        jobs.push_back(std::move(job));
+    };
+    // 展开目录和通配符时，跳过之前的输出文件
+    const filesystem::path output_root =
+        options.output_dir.empty() ? filesystem::path() : filesystem::weakly_canonical(options.output_dir);
+    auto is_previous_output = [&](const filesystem::path& file) {
+        if (!output_root.empty())
+        {
+            // 输出目录可能位于输入目录之内
+            filesystem::path relative = filesystem::weakly_canonical(file).lexically_relative(output_root);
+            return !relative.empty() && *relative.begin() != "..";
+        }
+        const string stem = file.stem().string();
+        return !options.suffix.empty() && stem.size() > options.suffix.size() &&
+               stem.compare(stem.size() - options.suffix.size(), options.suffix.size(), options.suffix) == 0;
+    };
+
+    for (const string& input : options.inputs)
+    {
+        filesystem::path input_path(input);
+        const string pattern = input_path.filename().string();
+        vector<filesystem::path> found;
+
+        if (pattern.find_first_of("*?") != string::npos)
+        {
+            // 通配符只作用于文件名
+            filesystem::path dir = input_path.parent_path().empty() ? filesystem::path(".") : input_path.parent_path();
+            error_code ec;
+            for (auto& entry : filesystem::directory_iterator(dir, ec))
+            {
+                if (entry.is_regular_file() && MatchWildcard(pattern, entry.path().filename().string()) &&
+                    !is_previous_output(entry.path()))
+                {
+                    found.push_back(input_path.parent_path() / entry.path().filename());
+                }
+            }
+            if (ec || found.empty())
+            {
+                cerr << "No file matches " << input << "." << endl;
+            }
+            sort(found.begin(), found.end());
+            for (auto& file : found)
+            {
+                add_job(file, file.filename());
+            }
+        }
+        else if (filesystem::is_directory(input_path))
+        {
+            for (auto& entry : filesystem::recursive_directory_iterator(input_path))
+            {
+                if (entry.is_regular_file() && IsChartFile(entry.path()) && !is_previous_output(entry.path()))
+                {
+                    found.push_back(entry.path());
+                }
+            }
+            sort(found.begin(), found.end());
+            for (auto& file : found)
+            {
+                add_job(file, file.lexically_relative(input_path));
+            }
+        }
+        else if (filesystem::is_regular_file(input_path))
+        {
+            add_job(input_path, input_path.filename());
+        }
+        else
+        {
+            cerr << "Input file not found: " << input << "." << endl;
+        }
+    }
+
+    return jobs;
+}
+
+
+/// 解析--batch之后的参数。格式错误时返回false
+static bool ParseBatchOptions(int argc, char** argv, BatchOptions& options)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc)
+        {
+            try
+            {
+                options.jobs = stoi(argv[++i]);
+            }
+            catch (exception&)
+            {
+                return false;
+            }
+            if (options.jobs <= 0)
+            {
+                return false;
+            }
+        }
+        else if ((arg == "-o" || arg == "--output-dir") && i + 1 < argc)
+        {
+            options.output_dir = argv[++i];
+        }
+        else if (arg == "--suffix" && i + 1 < argc)
+        {
+            options.suffix = argv[++i];
+        }
+        else if (arg == "--incremental")
+        {
+            options.job_options.incremental = true;
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            options.job_options.cache_dir = argv[++i];
+        }
+        else if (arg == "--patch")
+        {
+            options.job_options.patch = true;
+        }
+        else if (arg == "--stream" && i + 1 < argc)
+        {
+            options.job_options.stream_window = atoi(argv[++i]);
+            if (options.job_options.stream_window <= 0)
+            {
+                return false;
+            }
+        }
+        else if (arg == "--lookahead" && i + 1 < argc)
+        {
+            options.job_options.stream_lookahead = atoi(argv[++i]);
+            if (options.job_options.stream_lookahead < 0)
+            {
+                return false;
+            }
+        }
+        else if (arg == "--measures" && i + 1 < argc)
+        {
+            if (!ParseMeasureRange(argv[++i], options.job_options))
+            {
+                return false;
+            }
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            return false;
+        }
+        else
+        {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    // 既没有输出目录也没有后缀时会覆盖输入文件
+    return !options.inputs.empty() && !(options.output_dir.empty() && options.suffix.empty());
+}
+
+int BatchEntrance(int argc, char** argv)
+{
+    BatchOptions options;
+    if (!ParseBatchOptions(argc, argv, options))
+    {
+        HelpMessage();
+        return 1;
+    }
+
+    vector<unique_ptr<BatchJob>> jobs = CollectBatchJobs(options);
+    const int job_count = static_cast<int>(jobs.size());
+    if (job_count == 0)
+    {
+        cerr << "No chart to process." << endl;
+        return 1;
+    }
+
+    // 各谱面的日志按输入顺序输出：某张谱面完成时，把它之前已经连续完成的部分都打印出来
+    mutex print_mutex;
+    vector<char> finished(job_count, false);
+    int next_to_print = 0;
+    auto print_finished = [&]() {
+        while (next_to_print < job_count && finished[next_to_print])
+        {
+            BatchJob& job = *jobs[next_to_print];
+            cout << "[" << next_to_print + 1 << "/" << job_count << "] " << job.input.string() << " -> "
+                 << job.output.string() << "\n"
+                 << job.log.str();
+            const ChartJobResult& result = job.result;
+            if (result.success && result.error_count == 0 && result.warning_count == 0)
+            {
+                cout << "Done.\n";
+            }
+            else if (result.success)
+            {
+                cout << "Errors: " << result.error_count << ", Warnings: " << result.warning_count << "\n";
+            }
+            cout << flush;
+            job.log.str("");
+            ++next_to_print;
+        }
+    };
+
+    WorkerPool pool(min(options.jobs, job_count));
+    pool.Run(job_count, [&](int i) {
+        BatchJob& job = *jobs[i];
+        job.result = ProcessChartJob(job.input.string(), job.output.string(), job.log, options.job_options);
+        lock_guard<mutex> lock(print_mutex);
+        finished[i] = true;
+        print_finished();
+    });
+
+    // 汇总
+    int failed = 0, total_errors = 0, total_warnings = 0;
+    for (auto& job : jobs)
+    {
+        failed += job->result.success ? 0 : 1;
+        total_errors += job->result.error_count;
+        total_warnings += job->result.warning_count;
+    }
+    cout << "===================================================================\n"
+         << "Charts: " << job_count << ", Failed: " << failed << "\n"
+         << "Total Errors: " << total_errors << "\n"
+         << "Total Warnings: " << total_warnings << endl;
+
+    return failed == 0 ? 0 : 1;
+}
+
+/* #endregion 批量处理 */
+
+/// 对谱面应用--patch输出的补丁
+static int ApplyPatchEntrance(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        HelpMessage();
+        return 1;
+    }
+    const string chart_path = argv[0], patch_path = argv[1];
+    const string output = argc == 3 ? argv[2] : chart_path;
+
+    ChartPatch patch;
+    if (!patch.ImportFromString(PathManager::LoadFile(patch_path)))
+    {
+        cerr << "Failed to read patch file!" << endl;
+        return 1;
+    }
+
+    string content, error;
+    if (!patch.Apply(PathManager::LoadFile(chart_path), content, error))
+    {
+        cerr << "Failed to apply patch: " << error << endl;
+        return 1;
+    }
+    if (!PathManager::SaveFileIfChanged(output, content))
+    {
+        cerr << "Failed to write output file!" << endl;
+        return 1;
+    }
+
+    cout << "Applied " << patch.Changes().size() << " change(s)." << endl;
+    return 0;
+}
+
+/// 比较两张谱面的内容
+static int DiffEntrance(int argc, char** argv)
+{
+    double tolerance = 0.0;
+    vector<string> paths;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--tolerance" && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        HelpMessage();
+        return 2;
+    }
+
+    Chart charts[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!LoadChart(paths[i], PathManager::LoadFile(paths[i]), charts[i]))
+        {
+            cerr << "Failed to open " << paths[i] << "!" << endl;
+            return 2;
+        }
+    }
+    IndexedChart old_chart(charts[0]), new_chart(charts[1]);
+
+    // 完全相同时不必逐条比较
+    if (tolerance == 0.0 && old_chart.SameAs(new_chart))
+    {
+        cout << "Identical." << endl;
+        return 0;
+    }
+    ChartDiff diff(tolerance);
+    old_chart.DiffWith(new_chart, diff);
+    diff.Print(cout);
+    return diff.Empty() ? 0 : 1;
+}
+
 int ConsoleEntrance(int argc, char** argv)
 {
     // 登录搜索路径
@@ -178,6 +986,51 @@ int ConsoleEntrance(int argc, char** argv)
     // Current Working Dir
     PathManager::GetInstance().AddPath(filesystem::current_path().string());
 
+    // 批量处理。各谱面所在的目录由每个任务自己登记
+    if (argc > 1 && string(argv[1]) == "--batch")
+    {
+        return BatchEntrance(argc - 2, argv + 2);
+    }
+    // 常驻服务
+    if (argc > 1 && string(argv[1]) == "--serve")
+    {
+        return DaemonEntrance(argc - 2, argv + 2);
+    }
+    // 监视模式
+    if (argc > 1 && string(argv[1]) == "--watch")
+    {
+        return WatchEntrance(argc - 2, argv + 2);
+    }
+    // 应用补丁
+    if (argc > 1 && string(argv[1]) == "--apply")
+    {
+        return ApplyPatchEntrance(argc - 2, argv + 2);
+    }
+    // 比较谱面
+    if (argc > 1 && string(argv[1]) == "--diff")
+    {
+        return DiffEntrance(argc - 2, argv + 2);
+    }
+
+    // 单张谱面：-j N 时并行执行互不冲突的命令
+    int workers = 1;
+    if (argc > 3 && (string(argv[1]) == "-j" || string(argv[1]) == "--jobs"))
+    {
+        try
+        {
+            workers = max(1, stoi(argv[2]));
+        }
+        catch (exception&)
+        {
+            cerr << "Invalid value for " << argv[1] << ": " << argv[2] << endl;
+            return 1;
+        }
+        // 移过选项，argv[0]仍为程序路径
+        argv[2] = argv[0];
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc > 1)
     {
         try
@@ -213,14 +1066,14 @@ int ConsoleEntrance(int argc, char** argv)
         else
         {
             string output = AddPostfix(input);
-            return ExecuteCommand(input, output);
+            return ExecuteCommand(input, output, workers);
         }
     }
     else if (argc == 3)
     {
         string input = argv[1];
         string output = argv[2];
-        return ExecuteCommand(input, output);
+        return ExecuteCommand(input, output, workers);
     }
     else
     {
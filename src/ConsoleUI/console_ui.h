@@ -20,4 +20,54 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-int ConsoleEntrance(int argc, char** argv);
\ No newline at end of file
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// 一张谱面的处理结果
+struct ChartJobResult
+{
+    bool success = false;
+    int error_count = 0;
+    int warning_count = 0;
+    /// 处理时读取过的外部文件，例如导入的batch文件
+    std::vector<std::string> dependencies;
+};
+
+/// 处理谱面时的选项
+struct ChartJobOptions
+{
+    /// 是否增量执行：复用上次输出中没有变化的部分，并在输出旁边保存执行记录
+    bool incremental = false;
+    /// 结果缓存的目录。为空时不使用缓存
+    std::string cache_dir;
+    /// 是否只输出相对于输入的补丁（output.patch），而不是完整的谱面。KSON谱面总是完整输出
+    bool patch = false;
+    /// 只执行这一段小节（从1开始，包括两端）内的命令，其余小节原样输出。为0时处理整张谱面。
+    /// 限定范围时不使用增量执行和结果缓存
+    int first_measure = 0;
+    int last_measure = 0;
+    /// 流式处理时每一轮执行的小节数，为0时整张谱面一起处理。
+    /// 流式处理只支持ksh，不使用增量执行、结果缓存、补丁输出和小节范围
+    int stream_window = 0;
+    /// 流式处理时窗口之后至少读入的小节数
+    int stream_lookahead = 8;
+};
+
+/// 解析"A-B"或者"A"形式的小节范围，写入options
+bool ParseMeasureRange(const std::string& text, ChartJobOptions& options);
+
+/// @brief 使用独立的ApplicationBus处理一张谱面，日志写入log。可以在多个线程中同时调用
+ChartJobResult ProcessChartJob(const std::string& input, const std::string& output, std::ostream& log,
+                               const ChartJobOptions& options = ChartJobOptions());
+
+/// 默认的输出文件名：xxx.ksh -> xxx_out.ksh
+std::string AddPostfix(const std::string& ksh);
+
+int ConsoleEntrance(int argc, char** argv);
+
+/// 常驻服务模式：在本地socket上接收处理请求
+int DaemonEntrance(int argc, char** argv);
+
+/// 监视模式：谱面或者它导入的文件保存后自动重新处理
+int WatchEntrance(int argc, char** argv);
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "console_ui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+#include "src/FileSystem/path_manager.h"
+
+using namespace std;
+
+/*
+监视模式。
+
+谱面和它导入的batch文件中任意一个被保存后，重新处理整张谱面。
+没有变化的batch文件不会重新编译（见CommandBatch的缓存），内容没有变化的保存会被忽略。
+处理是增量的：只有输入或者定义变化了的命令会重新执行。
+Linux上使用inotify等待，inotify不可用时和其他平台上定时检查修改时间。
+*/
+
+/// 被监视的文件，以及上次处理时的修改时间
+struct WatchedFile
+{
+    filesystem::path path;
+    filesystem::file_time_type mtime;
+};
+
+static filesystem::file_time_type ModifiedTime(const filesystem::path& path)
+{
+    error_code ec;
+    auto mtime = filesystem::last_write_time(path, ec);
+    return ec ? filesystem::file_time_type::min() : mtime;
+}
+
+static bool AnyModified(const vector<WatchedFile>& files)
+{
+    for (auto& file : files)
+    {
+        if (ModifiedTime(file.path) != file.mtime)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// 定时检查修改时间，等待到任意一个被监视的文件被修改
+static void PollForChange(const vector<WatchedFile>& files)
+{
+    while (!AnyModified(files))
+    {
+        this_thread::sleep_for(chrono::milliseconds(300));
+    }
+}
+
+#ifdef __linux__
+
+/// 等待到任意一个被监视的文件被修改。inotify不可用时（比如实例数达到上限）改为定时检查
+static void WaitForChange(const vector<WatchedFile>& files)
+{
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0)
+    {
+        PollForChange(files);
+        return;
+    }
+
+    // 编辑器大多以“写临时文件再改名”的方式保存，所以监视所在的目录而不是文件本身
+    for (auto& file : files)
+    {
+        filesystem::path dir = file.path.parent_path().empty() ? filesystem::path(".") : file.path.parent_path();
+        if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            // 有目录监视不到时，这个目录里的修改只能靠定时检查发现
+            close(fd);
+            PollForChange(files);
+            return;
+        }
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (!AnyModified(files))
+    {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            close(fd);
+            PollForChange(files);
+            return;
+        }
+        // 保存往往会连续触发多个事件，等它们结束后再检查
+        pollfd pfd{fd, POLLIN, 0};
+        while (poll(&pfd, 1, 100) > 0 && read(fd, buffer, sizeof(buffer)) > 0)
+        {
+        }
+    }
+
+    close(fd);
+}
+
+#else
+
+static void WaitForChange(const vector<WatchedFile>& files)
+{
+    PollForChange(files);
+}
+
+#endif
+
+int WatchEntrance(int argc, char** argv)
+{
+    ChartJobOptions options;
+    options.incremental = true;
+    vector<string> files;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--measures" && i + 1 < argc)
+        {
+            if (!ParseMeasureRange(argv[++i], options))
+            {
+                cerr << "Invalid measure range: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty())
+    {
+        cerr << "No input file given." << endl;
+        return 1;
+    }
+    const string input = files[0];
+    const string output = files.size() > 1 ? files[1] : AddPostfix(input);
+
+    string last_content;
+    vector<WatchedFile> watched;
+    while (true)
+    {
+        // 先取修改时间再读文件，处理期间的保存会在下一轮被发现
+        auto input_mtime = ModifiedTime(input);
+        string content = PathManager::LoadFile(input);
+        bool dependency_changed = false;
+        for (size_t i = 1; i < watched.size(); ++i)
+        {
+            dependency_changed |= ModifiedTime(watched[i].path) != watched[i].mtime;
+        }
+
+        // 只保存而没有修改的谱面不需要重新处理
+        if (watched.empty() || content != last_content || dependency_changed)
+        {
+            if (!watched.empty())
+            {
+                cout << "===================================================================\n";
+            }
+
+            // 导入的文件同样先取修改时间
+            vector<WatchedFile> dependencies;
+            for (size_t i = 1; i < watched.size(); ++i)
+            {
+                dependencies.push_back({watched[i].path, ModifiedTime(watched[i].path)});
+            }
+
+            auto start = chrono::steady_clock::now();
+            ChartJobResult result = ProcessChartJob(input, output, cout, options);
+            auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+            if (result.success && result.error_count == 0 && result.warning_count == 0)
+            {
+                cout << "Done";
+            }
+            else if (result.success)
+            {
+                cout << "Errors: " << result.error_count << ", Warnings: " << result.warning_count;
+            }
+            else
+            {
+                cout << "Failed";
+            }
+            cout << " (" << elapsed.count() << " ms). Watching for changes..." << endl;
+
+            // 监视谱面本身和这次处理时导入的文件
+            watched.assign(1, {input, input_mtime});
+            for (const string& dependency : result.dependencies)
+            {
+                auto known = find_if(dependencies.begin(), dependencies.end(),
+                                     [&](const WatchedFile& file) { return file.path == dependency; });
+                watched.push_back({dependency, known != dependencies.end() ? known->mtime : ModifiedTime(dependency)});
+            }
+            last_content = std::move(content);
+        }
+        else
+        {
+            watched[0].mtime = input_mtime;
+        }
+
+        WaitForChange(watched);
+    }
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "result_cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "src/misc/utilities.h"
+#include "versions.h"
+
+using namespace std;
+
+/*
+每个条目由两个文件组成：
+    <键>.out    输出谱面（不用.ksh，免得批量处理时被当成输入）
+    <键>.meta   文本，每行一项：
+        KSHRAM-CACHE <版本>
+        result <错误数> <警告数>
+        depends <内容哈希> <路径>
+        log <日志>                （转义为一行）
+*/
+
+static constexpr int kCacheVersion = 1;
+
+/// 先写入临时文件再改名，其他进程不会读到写了一半的文件
+static bool WriteAtomically(const filesystem::path& path, const string& content)
+{
+    ostringstream suffix;
+    suffix << ".tmp" << this_thread::get_id();
+    filesystem::path temp = path;
+    temp += suffix.str();
+    if (!PathManager::SaveFile(temp.string(), content))
+    {
+        return false;
+    }
+    error_code ec;
+    filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+ResultCache::ResultCache(const std::string& dir) : dir(dir)
+{
+    error_code ec;
+    filesystem::create_directories(this->dir, ec);
+}
+
+filesystem::path ResultCache::EntryPath(uint64_t key, const char* extension) const
+{
+    ostringstream name;
+    name << hex << key << extension;
+    return this->dir / name.str();
+}
+
+uint64_t ResultCache::Key(const std::string& chart_content, const PathManager& paths)
+{
+    uint64_t hash = kHashSeed;
+    HashValue(hash, string(PROJECT_VERSION));
+    HashValue(hash, chart_content);
+    // 搜索路径决定导入时找到的是哪一个文件
+    for (const string& path : paths.Paths())
+    {
+        HashValue(hash, path);
+    }
+    return hash;
+}
+
+bool ResultCache::Lookup(uint64_t key, Entry& entry) const
+{
+    ifstream fs(this->EntryPath(key, ".meta"));
+    string magic;
+    int version = 0;
+    if (!(fs >> magic >> version) || magic != "KSHRAM-CACHE" || version != kCacheVersion)
+    {
+        return false;
+    }
+
+    entry = Entry();
+    string line;
+    while (getline(fs, line))
+    {
+        istringstream ss(line);
+        string kind;
+        ss >> kind;
+        if (kind == "result")
+        {
+            ss >> entry.result.error_count >> entry.result.warning_count;
+        }
+        else if (kind == "depends")
+        {
+            uint64_t hash;
+            string path;
+            if (!(ss >> hex >> hash) || !getline(ss >> ws, path))
+            {
+                return false;
+            }
+            // 导入的文件变化了，结果不能复用
+            if (HashString(PathManager::LoadFile(path)) != hash)
+            {
+                return false;
+            }
+            entry.result.dependencies.push_back(path);
+        }
+        else if (kind == "log")
+        {
+            string text;
+            getline(ss >> ws, text);
+            entry.log = UnescapeLine(text);
+        }
+    }
+
+    entry.output = PathManager::LoadFile(this->EntryPath(key, ".out").string());
+    entry.result.success = !entry.output.empty();
+    return entry.result.success;
+}
+
+bool ResultCache::Store(uint64_t key, const Entry& entry) const
+{
+    ostringstream meta;
+    meta << "KSHRAM-CACHE " << kCacheVersion << "\n";
+    meta << "result " << entry.result.error_count << " " << entry.result.warning_count << "\n";
+    for (const string& path : entry.result.dependencies)
+    {
+        meta << "depends " << hex << HashString(PathManager::LoadFile(path)) << dec << " " << path << "\n";
+    }
+    meta << "log " << EscapeLine(entry.log) << "\n";
+
+    // 先写谱面再写元数据，元数据存在时谱面一定是完整的
+    return WriteAtomically(this->EntryPath(key, ".out"), entry.output) &&
+           WriteAtomically(this->EntryPath(key, ".meta"), meta.str());
+}
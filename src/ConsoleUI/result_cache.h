@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "console_ui.h"
+#include "src/FileSystem/path_manager.h"
+
+/// 整次执行结果的缓存，保存在一个目录中。
+///
+/// 键由谱面内容、搜索路径和程序版本决定。条目中另外记录执行时导入的文件及其内容，
+/// 这些文件也都没有变化时才算命中。多个进程或线程可以同时使用同一个目录。
+class ResultCache
+{
+public:
+    /// 一次执行的结果
+    struct Entry
+    {
+        ChartJobResult result;
+        /// 执行时输出的日志
+        std::string log;
+        /// 输出谱面的内容
+        std::string output;
+    };
+
+private:
+    std::filesystem::path dir;
+
+    std::filesystem::path EntryPath(uint64_t key, const char* extension) const;
+
+public:
+    explicit ResultCache(const std::string& dir);
+
+    /// 计算缓存的键
+    static uint64_t Key(const std::string& chart_content, const PathManager& paths);
+
+    /// 查找缓存。条目存在并且记录的导入文件都没有变化时返回true
+    bool Lookup(uint64_t key, Entry& entry) const;
+    /// 保存一次成功执行的结果
+    bool Store(uint64_t key, const Entry& entry) const;
+};
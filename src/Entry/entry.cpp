@@ -19,6 +19,7 @@
 */
 
 #include "entry.h"
+#include "src/misc/keywords.h"
 #include "src/misc/utilities.h"
 
 #include <utility>
@@ -40,65 +41,10 @@ Mark::Mark(const string& str) {
 	std::string_view mark_val(str.data() + split_pos + 1);
 	this->value = mark_val;
 
-	if (mark_id == "t") {
-		this->type = MarkType::BPM;
-	}
-	else if (mark_id == "beat") {
-		this->type = MarkType::TimeSignature;
-	}
-	else if (mark_id == "fx-l") {
-		this->type = MarkType::FXLong;
-		this->side = Side::L;
-	}
-	else if (mark_id == "fx-r") {
-		this->type = MarkType::FXLong;
-		this->side = Side::R;
-	}
-	else if (mark_id == "fx-l_se") {
-		this->type = MarkType::FXChip;
-		this->side = Side::L;
-	}
-	else if (mark_id == "fx-r_se") {
-		this->type = MarkType::FXChip;
-		this->side = Side::R;
-	}
-	else if (mark_id == "laserrange_l") {
-		this->type = MarkType::Laser2x;
-		this->side = Side::L;
-	}
-	else if (mark_id == "laserrange_r") {
-		this->type = MarkType::Laser2x;
-		this->side = Side::R;
-	}
-	else if (mark_id == "filtertype") {
-		this->type = MarkType::Filter;
-	}
-	else if (mark_id == "pfiltergain") {
-		this->type = MarkType::KnobVolume;
-	}
-	else if (mark_id == "chokkakuse") {
-		this->type = MarkType::SlamSound;
-	}
-	else if (mark_id == "chokkakuvol") {
-		this->type = MarkType::SlamVolume;
-	}
-	else if (mark_id == "zoom_top") {
-		this->type = MarkType::ZoomTop;
-	}
-	else if (mark_id == "zoom_bottom") {
-		this->type = MarkType::ZoomBottom;
-	}
-	else if (mark_id == "zoom_side") {
-		this->type = MarkType::ZoomSide;
-	}
-	else if (mark_id == "tilt") {
-		this->type = MarkType::Tilt;
-	}
-	else if (mark_id == "stop") {
-		this->type = MarkType::Stop;
-	}
-	else if (mark_id == "center_split") {
-		this->type = MarkType::LaneSplit;
+	const MarkKeyword* keyword = g_KshMarkKeywords.Find(mark_id);
+	if (keyword != nullptr) {
+		this->type = keyword->type;
+		this->side = keyword->side;
 	}
 	// for unknown type
 	// else {
@@ -19,8 +19,11 @@
 */
 
 #include "error_collector.h"
+#include "src/Chart/measure_grid.h"
+#include "src/Command/command.h"
 
 #include <iostream>
+#include <numeric>
 
 using namespace std;
 
@@ -40,15 +43,40 @@ inline void PrintPos(const TimeInfo& time, std::ostream& os)
 	os << "[ measure #" << time.measure + 1 << ", " << time.entry_numer << " / " << time.entry_denom << " ]";
 }
 
-void ErrorCollector::LogMessage(const std::string& msg, const std::string& type, std::ostream& os)
+void ErrorCollector::SetCommand(const Command& cmd)
 {
+    this->root_command = cmd.toOriginalString();
+}
+
+TimeInfo ErrorCollector::ToTimeInfo(int time) const
+{
+    MeasureGrid empty_grid;
+    const MeasureGrid& grid = this->measure_grid != nullptr ? *this->measure_grid : empty_grid;
+
+    int measure_id = grid.MeasureIDAtTime(time);
+    int local_time = time - grid.MeasureStartTime(measure_id);
+    int gcd = std::gcd(local_time, 48);
+    int denom = local_time == 0 ? 4 : 192 / gcd;
+
+    TimeInfo output;
+    output.measure = measure_id + this->measure_offset;
+    output.entry_numer = local_time / gcd;
+    output.entry_denom = denom;
+
+    return output;
+}
+
+void ErrorCollector::LogMessage(const std::string& msg, const std::string& type, std::ostream& target)
+{
+	std::ostream& os = this->Output(target);
+
 	// 根命令时间
 	os << "Command at ";
-	PrintPos(this->root_cmd_time, os);
+	PrintPos(this->ToTimeInfo(this->root_cmd_time), os);
 	os << "\n";
 	// 执行时间
 	os << "Execution Time: ";
-	PrintPos(this->execution_time, os);
+	PrintPos(this->ToTimeInfo(this->execution_time), os);
 	os << "\n";
 	
 	// 命令本身
@@ -72,8 +100,8 @@ void ErrorCollector::Reset()
 {
     this->err_count = 0;
     this->warning_count = 0;
-    this->root_cmd_time = {0, 0, 4};
-    this->execution_time = {0, 0, 4};
-    this->root_command = "";
+    this->root_cmd_time = 0;
+    this->execution_time = 0;
+    this->root_command.clear();
     this->call_stack.Clear();
 }
\ No newline at end of file
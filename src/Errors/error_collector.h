@@ -24,6 +24,9 @@
 #include <vector>
 #include <iostream>
 
+class MeasureGrid;
+class Command;
+
 /*
 用途：
 在执行任何语句时，收集语句内容和执行的命令点位。
@@ -76,14 +79,20 @@ class ErrorCollector {
 private:
 	// 错误信息计数器
 	int err_count, warning_count;
-	// 根命令时间（不计入任何调用的）
-	TimeInfo root_cmd_time;
-	// 当前调用发生时间
-	TimeInfo execution_time;
+	// 根命令时间（不计入任何调用的），单位：1/48拍
+	int root_cmd_time;
+	// 当前调用发生时间，单位：1/48拍
+	int execution_time;
+	// 用于将时间换算为小节位置的网格（仅在打印消息时使用）
+	const MeasureGrid* measure_grid;
+	// 打印时加在小节序号上的偏移。只处理谱面的一段时为这一段的起始小节
+	int measure_offset;
 	// 当前调用链
 	CallStack call_stack;
-	// 当前根命令（不算调用链上的那些）
+	// 当前根命令（不算调用链上的那些）的原文。命令对象执行中可能被移出命令表，所以保存文本
 	std::string root_command;
+	// 消息的输出目标。为空时输出到打印时指定的流
+	std::ostream* output;
 public:
 	// 构造
 	inline ErrorCollector();
@@ -95,12 +104,30 @@ private:
 	void LogMessage(const std::string& msg, const std::string& type, std::ostream& os = std::cout);
 
 public:
+	/// 设置用于换算小节位置的网格
+	inline void SetMeasureGrid(const MeasureGrid* grid);
+	/// 设置打印时加在小节序号上的偏移
+	inline void SetMeasureOffset(int offset);
+	/// 将时间换算为小节位置。超出谱面时按最后一小节的拍号顺延。
+	TimeInfo ToTimeInfo(int time) const;
 	/// 设置根命令时间
-	inline void SetRootCmdTime(const TimeInfo& time);
+	inline void SetRootCmdTime(int time);
 	/// 设置当前调用时间
-	inline void SetExecTime(const TimeInfo& time);
+	inline void SetExecTime(int time);
 	/// 设置当前命令
+	void SetCommand(const Command& cmd);
+	/// 设置当前命令的原文
 	inline void SetCommand(const std::string& cmd);
+	/// 获取当前命令的原文
+	inline const std::string& CurrentCommand() const;
+	/// 将之后的消息都输出到指定的流。为空时恢复默认
+	inline void SetOutput(std::ostream* os);
+	/// 消息的输出目标。没有指定时为fallback
+	inline std::ostream& Output(std::ostream& fallback = std::cout) const;
+	/// 累加另一个Logger记录的错误和警告数量
+	inline void MergeCounts(const ErrorCollector& other);
+	/// 累加错误和警告数量
+	inline void AddCounts(int errors, int warnings);
 	/// 向调用链增加一层内容
 	inline void AddToStack(const std::string& cmd);
 	/// 调用链减少一层
@@ -127,7 +154,8 @@ enum class ErrorType {
 	ObjectNotFound,
 	ParamIsNotNumber,
 	KnobTooShort,
-	EndCommandNotFound
+	EndCommandNotFound,
+	BeginCommandNotFound
 };
 
 template <ErrorType type>
@@ -162,6 +190,11 @@ inline std::string ErrorMessage<ErrorType::EndCommandNotFound>() {
 	return "The end command of this command is not found.";
 }
 
+template <>
+inline std::string ErrorMessage<ErrorType::BeginCommandNotFound>() {
+	return "No command before this end command can be paired with it.";
+}
+
 /* #endregion */
 
 #include "error_collector_inline.h"
\ No newline at end of file
@@ -52,17 +52,30 @@ inline void CallStack::Clear()
 
 inline ErrorCollector::ErrorCollector() 
 : err_count(0), warning_count(0), 
-root_cmd_time({0, 0, 4}),
-execution_time({0, 0, 4})
+root_cmd_time(0),
+execution_time(0),
+measure_grid(nullptr),
+measure_offset(0),
+output(nullptr)
 {
 }
 
-inline void ErrorCollector::SetRootCmdTime(const TimeInfo& time)
+inline void ErrorCollector::SetMeasureGrid(const MeasureGrid* grid)
+{
+    this->measure_grid = grid;
+}
+
+inline void ErrorCollector::SetMeasureOffset(int offset)
+{
+    this->measure_offset = offset;
+}
+
+inline void ErrorCollector::SetRootCmdTime(int time)
 {
     this->root_cmd_time = time;
 }
 
-inline void ErrorCollector::SetExecTime(const TimeInfo& time)
+inline void ErrorCollector::SetExecTime(int time)
 {
     this->execution_time = time;
 }
@@ -72,6 +85,32 @@ inline void ErrorCollector::SetCommand(const std::string& cmd)
     this->root_command = cmd;
 }
 
+inline const std::string& ErrorCollector::CurrentCommand() const
+{
+    return this->root_command;
+}
+
+inline void ErrorCollector::SetOutput(std::ostream* os)
+{
+    this->output = os;
+}
+
+inline std::ostream& ErrorCollector::Output(std::ostream& fallback) const
+{
+    return this->output != nullptr ? *this->output : fallback;
+}
+
+inline void ErrorCollector::MergeCounts(const ErrorCollector& other)
+{
+    this->AddCounts(other.err_count, other.warning_count);
+}
+
+inline void ErrorCollector::AddCounts(int errors, int warnings)
+{
+    this->err_count += errors;
+    this->warning_count += warnings;
+}
+
 inline void ErrorCollector::AddToStack(const std::string& cmd)
 {
     this->call_stack.Append(cmd);
@@ -165,6 +165,16 @@ bool PathManager::SaveFile(const std::string& path, const std::string& content)
 
 #endif
 
+bool PathManager::SaveFileIfChanged(const std::string& path, const std::string& content)
+{
+    // 读不到内容时无法区分空文件和不存在的文件，总是写入
+    if (!content.empty() && LoadFile(path) == content)
+    {
+        return true;
+    }
+    return SaveFile(path, content);
+}
+
 /* #endregion 静态函数 */
 
 /* #region 成员函数 */
@@ -35,14 +35,16 @@ Qt还是强啊，直接一个toLocal8Bit()就编程utf-8了。
 /// 负责登记路径和查找文件。
 ///
 /// 由于需要为console和Qt准备两套不同的文件读写实现，所以这部分也归它。
+///
+/// 全局实例保存程序级别的搜索路径，每个执行上下文持有一份自己的拷贝。
 class PathManager
 {
-private:
-    PathManager() = default;
-    PathManager(const PathManager&) = delete;
-    PathManager& operator=(const PathManager&) = delete;
 public:
-    // SINGLETON
+    PathManager() = default;
+    PathManager(const PathManager&) = default;
+    PathManager& operator=(const PathManager&) = default;
+
+    // GLOBAL DEFAULT
     static PathManager& GetInstance();
 
 private:
@@ -56,12 +58,16 @@ public:
     static std::string LoadFileWithoutComment(const std::string& path);
     /// 将字符串内的全部内容写入文件
     static bool SaveFile(const std::string& path, const std::string& content);
+    /// 将字符串写入文件。文件已有相同的内容时不写入，保留其修改时间
+    static bool SaveFileIfChanged(const std::string& path, const std::string& content);
 
 public:
     /// 添加一个新的路径
     inline void AddPath(const std::string& path);
     /// 删除最近添加的路径
     inline void RemoveLastPath();
+    /// 按添加顺序排列的全部路径
+    inline const std::vector<std::string>& Paths() const;
 
     /// 按照路径添加顺序，逐个搜索特定的文件。
     /// 如果返回了一个地址，该地址肯定能开。如果文件没找到，那么返回空路径。
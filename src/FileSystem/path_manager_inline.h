@@ -31,3 +31,8 @@ inline void PathManager::RemoveLastPath()
 {
     this->paths.pop_back();
 }
+
+inline const std::vector<std::string>& PathManager::Paths() const
+{
+    return this->paths;
+}
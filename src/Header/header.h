@@ -43,6 +43,10 @@ public:
 	inline bool HasMark(const std::string& key) const;
 	/// 是否有给定关键词的值
 	inline std::string GetMarkValue(const std::string& key) const;
+	/// 设置给定关键词的值
+	inline void SetMarkValue(const std::string& key, const std::string& value);
+	/// 全部信息，按关键词排序
+	inline const std::map<std::string, std::string>& Items() const;
 
 public:
 	friend std::istream& operator>>(std::istream&, Header&);
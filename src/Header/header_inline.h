@@ -28,4 +28,12 @@ inline bool Header::HasMark(const std::string& key) const {
 
 inline std::string Header::GetMarkValue(const std::string& key) const {
 	return this->items.find(key)->second;
+}
+
+inline void Header::SetMarkValue(const std::string& key, const std::string& value) {
+	this->items[key] = value;
+}
+
+inline const std::map<std::string, std::string>& Header::Items() const {
+	return this->items;
 }
\ No newline at end of file
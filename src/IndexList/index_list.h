@@ -87,6 +87,8 @@ public:
     inline void insert(const std::map<int, PairEntry<T>>& map);
     /// 插入一整个IndexList
     inline void insert(const IndexList& index_list);
+    /// 在末尾追加元素。key需要大于表中已有的所有key
+    inline void append(int key, PairEntry<T>&& item);
 
     /// 删除单个元素
     inline void erase(int key);
@@ -252,6 +254,12 @@ inline void IndexList<T>::insert(int key, PairEntry<T>&& item)
     this->map_.insert_or_assign(key, std::move(item));
 }
 
+template <typename T>
+inline void IndexList<T>::append(int key, PairEntry<T>&& item)
+{
+    this->map_.emplace_hint(this->map_.end(), key, std::move(item));
+}
+
 template <typename T>
 inline void IndexList<T>::insert(const std::pair<const int, T>& item)
 {
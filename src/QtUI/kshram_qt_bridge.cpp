@@ -65,17 +65,13 @@ int ExecuteCommand(const string& input, const string& output, string& log)
         return 1;
     }
 
-    ApplicationBus& bus = ApplicationBus::GetInstance();
+    ApplicationBus bus;
     try{
         
         bus.BindChart(std::move(chart));
         bus.RunCommands();
 
-        Chart chart_out = bus.GetChart();
-
-        chart_out.GetHeader() = chart.GetHeader();
-        chart_out.GetCustomFX() = chart.GetCustomFX();
-
+        Chart chart_out = bus.TakeChart();
         chart_out.ExportToFile(output);
     }
     catch(std::exception& e)
@@ -100,8 +96,6 @@ int ExecuteCommand(const string& input, const string& output, string& log)
         ss << "Total Errors: " << err_collector.ErrorCount() << endl;
         ss << "Total Warnings: " << err_collector.WarningCount() << endl;
     }
-
-    bus.Reset();
     // 获得所有的log
     log = ss.str();
     // 恢复cout的位置
@@ -0,0 +1,494 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+using namespace std;
+
+static constexpr size_t kFlushSize = 1 << 16;
+
+/* #region JsonWriter */
+
+JsonWriter::~JsonWriter()
+{
+    this->Flush();
+}
+
+inline void JsonWriter::FlushIfFull()
+{
+    if (this->buffer.size() >= kFlushSize)
+    {
+        this->Flush();
+    }
+}
+
+void JsonWriter::Flush()
+{
+    this->os.write(this->buffer.data(), static_cast<streamsize>(this->buffer.size()));
+    this->buffer.clear();
+}
+
+void JsonWriter::Separate()
+{
+    if (this->after_key)
+    {
+        this->after_key = false;
+        return;
+    }
+    if (!this->first_in_scope.empty())
+    {
+        if (!this->first_in_scope.back())
+        {
+            this->buffer += ',';
+        }
+        this->first_in_scope.back() = false;
+    }
+}
+
+void JsonWriter::AppendEscaped(std::string_view text)
+{
+    this->buffer += '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': this->buffer += "\\\""; break;
+        case '\\': this->buffer += "\\\\"; break;
+        case '\n': this->buffer += "\\n"; break;
+        case '\r': this->buffer += "\\r"; break;
+        case '\t': this->buffer += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                this->buffer += escaped;
+            }
+            else
+            {
+                this->buffer += c;
+            }
+            break;
+        }
+    }
+    this->buffer += '"';
+}
+
+JsonWriter& JsonWriter::BeginObject()
+{
+    this->Separate();
+    this->buffer += '{';
+    this->first_in_scope.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject()
+{
+    this->buffer += '}';
+    this->first_in_scope.pop_back();
+    this->FlushIfFull();
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray()
+{
+    this->Separate();
+    this->buffer += '[';
+    this->first_in_scope.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray()
+{
+    this->buffer += ']';
+    this->first_in_scope.pop_back();
+    this->FlushIfFull();
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key)
+{
+    this->Separate();
+    this->AppendEscaped(key);
+    this->buffer += ':';
+    this->after_key = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value)
+{
+    this->Separate();
+    this->AppendEscaped(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(int64_t value)
+{
+    this->Separate();
+    this->buffer += to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Number(double value)
+{
+    if (!isfinite(value))
+    {
+        return this->Null();
+    }
+    this->Separate();
+    // 最短的能够还原出原值的写法
+    char digits[32];
+    auto [end, ec] = to_chars(digits, digits + sizeof(digits), value);
+    this->buffer.append(digits, end);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value)
+{
+    this->Separate();
+    this->buffer += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null()
+{
+    this->Separate();
+    this->buffer += "null";
+    return *this;
+}
+
+/* #endregion */
+
+/* #region JsonReader */
+
+bool JsonReader::Fail()
+{
+    this->failed = true;
+    return false;
+}
+
+void JsonReader::SkipSpace()
+{
+    while (this->pos < this->text.size())
+    {
+        char c = this->text[this->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+        {
+            break;
+        }
+        ++this->pos;
+    }
+}
+
+bool JsonReader::Expect(char expected)
+{
+    this->SkipSpace();
+    if (this->failed || this->pos >= this->text.size() || this->text[this->pos] != expected)
+    {
+        return this->Fail();
+    }
+    ++this->pos;
+    return true;
+}
+
+bool JsonReader::AtEnd()
+{
+    this->SkipSpace();
+    return this->pos >= this->text.size();
+}
+
+JsonReader::Type JsonReader::Peek()
+{
+    this->SkipSpace();
+    if (this->failed || this->pos >= this->text.size())
+    {
+        return Type::Invalid;
+    }
+    switch (this->text[this->pos])
+    {
+    case '{': return Type::Object;
+    case '[': return Type::Array;
+    case '"': return Type::String;
+    case 't':
+    case 'f': return Type::Bool;
+    case 'n': return Type::Null;
+    default:
+    {
+        char c = this->text[this->pos];
+        return (c == '-' || (c >= '0' && c <= '9')) ? Type::Number : Type::Invalid;
+    }
+    }
+}
+
+bool JsonReader::BeginObject()
+{
+    if (!this->Expect('{'))
+    {
+        return false;
+    }
+    return ++this->depth <= kMaxDepth || this->Fail();
+}
+
+bool JsonReader::NextKey(std::string& key)
+{
+    this->SkipSpace();
+    if (this->failed || this->pos >= this->text.size())
+    {
+        return this->Fail();
+    }
+    if (this->text[this->pos] == '}')
+    {
+        ++this->pos;
+        --this->depth;
+        return false;
+    }
+    // 不是第一个键时先读掉逗号
+    if (this->text[this->pos] == ',' && !this->Expect(','))
+    {
+        return false;
+    }
+    return this->ReadString(key) && this->Expect(':');
+}
+
+bool JsonReader::BeginArray()
+{
+    if (!this->Expect('['))
+    {
+        return false;
+    }
+    return ++this->depth <= kMaxDepth || this->Fail();
+}
+
+bool JsonReader::NextElement()
+{
+    this->SkipSpace();
+    if (this->failed || this->pos >= this->text.size())
+    {
+        return this->Fail();
+    }
+    if (this->text[this->pos] == ']')
+    {
+        ++this->pos;
+        --this->depth;
+        return false;
+    }
+    if (this->text[this->pos] == ',')
+    {
+        ++this->pos;
+    }
+    return true;
+}
+
+/// 将码位以UTF-8写入
+static void AppendUtf8(string& output, unsigned int code)
+{
+    if (code < 0x80)
+    {
+        output += static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+        output += static_cast<char>(0xC0 | (code >> 6));
+        output += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        output += static_cast<char>(0xE0 | (code >> 12));
+        output += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        output += static_cast<char>(0xF0 | (code >> 18));
+        output += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        output += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool JsonReader::ReadString(std::string& value)
+{
+    if (!this->Expect('"'))
+    {
+        return false;
+    }
+    value.clear();
+    // 没有转义的部分整段复制
+    size_t run_start = this->pos;
+    while (this->pos < this->text.size())
+    {
+        char c = this->text[this->pos];
+        if (c == '"')
+        {
+            value.append(this->text.data() + run_start, this->pos - run_start);
+            ++this->pos;
+            return true;
+        }
+        if (c != '\\')
+        {
+            ++this->pos;
+            continue;
+        }
+
+        value.append(this->text.data() + run_start, this->pos - run_start);
+        if (this->pos + 1 >= this->text.size())
+        {
+            return this->Fail();
+        }
+        char escaped = this->text[this->pos + 1];
+        this->pos += 2;
+        switch (escaped)
+        {
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'u':
+        {
+            unsigned int code = 0;
+            if (this->pos + 4 > this->text.size())
+            {
+                return this->Fail();
+            }
+            auto [ptr, ec] = from_chars(this->text.data() + this->pos, this->text.data() + this->pos + 4, code, 16);
+            if (ec != errc() || ptr != this->text.data() + this->pos + 4)
+            {
+                return this->Fail();
+            }
+            this->pos += 4;
+            // 代理对
+            if (code >= 0xD800 && code < 0xDC00 && this->pos + 6 <= this->text.size() &&
+                this->text.substr(this->pos, 2) == "\\u")
+            {
+                unsigned int low = 0;
+                from_chars(this->text.data() + this->pos + 2, this->text.data() + this->pos + 6, low, 16);
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    this->pos += 6;
+                }
+            }
+            AppendUtf8(value, code);
+            break;
+        }
+        default: value += escaped; break;
+        }
+        run_start = this->pos;
+    }
+    return this->Fail();
+}
+
+bool JsonReader::ReadNumber(double& value)
+{
+    if (this->Peek() != Type::Number)
+    {
+        return this->Fail();
+    }
+    auto [ptr, ec] = from_chars(this->text.data() + this->pos, this->text.data() + this->text.size(), value);
+    if (ec != errc())
+    {
+        return this->Fail();
+    }
+    this->pos = ptr - this->text.data();
+    return true;
+}
+
+bool JsonReader::ReadInt(int& value)
+{
+    double number = 0.0;
+    // 超出范围时转换为int是未定义行为，先检查
+    if (!this->ReadNumber(number) || number != floor(number) || number < numeric_limits<int>::min() ||
+        number > numeric_limits<int>::max())
+    {
+        return this->Fail();
+    }
+    value = static_cast<int>(number);
+    return true;
+}
+
+bool JsonReader::ReadBool(bool& value)
+{
+    this->SkipSpace();
+    if (this->text.substr(this->pos, 4) == "true")
+    {
+        this->pos += 4;
+        value = true;
+        return true;
+    }
+    if (this->text.substr(this->pos, 5) == "false")
+    {
+        this->pos += 5;
+        value = false;
+        return true;
+    }
+    return this->Fail();
+}
+
+bool JsonReader::SkipValue()
+{
+    std::string key;
+    switch (this->Peek())
+    {
+    case Type::Object:
+        this->BeginObject();
+        while (this->NextKey(key))
+        {
+            this->SkipValue();
+        }
+        break;
+    case Type::Array:
+        this->BeginArray();
+        while (this->NextElement())
+        {
+            this->SkipValue();
+        }
+        break;
+    case Type::String: this->ReadString(key); break;
+    case Type::Number:
+    {
+        double number;
+        this->ReadNumber(number);
+        break;
+    }
+    case Type::Bool:
+    {
+        bool b;
+        this->ReadBool(b);
+        break;
+    }
+    case Type::Null:
+        if (this->text.substr(this->pos, 4) != "null")
+        {
+            return this->Fail();
+        }
+        this->pos += 4;
+        break;
+    default: return this->Fail();
+    }
+    return !this->failed;
+}
+
+/* #endregion */
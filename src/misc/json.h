@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* #region JsonWriter */
+
+/// @brief 流式的JSON写出器，内容先写入缓冲区，缓冲区满时再写入流。
+///
+/// 调用顺序需要符合JSON的结构，写出器不做检查。对象中的值前面需要先调用Key。
+class JsonWriter
+{
+private:
+    std::ostream& os;
+    std::string buffer;
+    /// 各层对象或数组中是否还没有写入元素
+    std::vector<bool> first_in_scope;
+    /// 刚写完一个键，接下来的值前面不需要逗号
+    bool after_key = false;
+
+    /// 在值之前写入需要的逗号
+    void Separate();
+    void AppendEscaped(std::string_view text);
+    /// 缓冲区较大时写入流
+    inline void FlushIfFull();
+
+public:
+    explicit JsonWriter(std::ostream& os) : os(os) {}
+    JsonWriter(const JsonWriter&) = delete;
+    ~JsonWriter();
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+    /// 写入对象中的键
+    JsonWriter& Key(std::string_view key);
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Int(int64_t value);
+    JsonWriter& Number(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& Null();
+
+    /// 将缓冲区中的内容写入流
+    void Flush();
+};
+
+/* #endregion */
+
+/* #region JsonReader */
+
+/// @brief 拉取式的JSON读入器。
+///
+/// 不建立文档树：调用方按照自己期望的结构逐个读取值，不关心的值用SkipValue跳过。
+/// 读到不符合预期的内容后进入失败状态，之后的读取都会返回false。
+class JsonReader
+{
+public:
+    /// 下一个值的类型
+    enum class Type
+    {
+        Object,
+        Array,
+        String,
+        Number,
+        Bool,
+        Null,
+        /// 没有值，或者内容有误
+        Invalid,
+    };
+
+private:
+    std::string_view text;
+    size_t pos = 0;
+    bool failed = false;
+    /// 当前所在的对象和数组的层数
+    int depth = 0;
+
+    void SkipSpace();
+    /// 读取一个字符。不是expected时进入失败状态
+    bool Expect(char expected);
+    bool Fail();
+
+public:
+    /// 对象和数组最多嵌套的层数，超过时进入失败状态
+    static constexpr int kMaxDepth = 256;
+
+    explicit JsonReader(std::string_view text) : text(text) {}
+
+    /// 是否已经进入失败状态
+    inline bool Failed() const { return this->failed; }
+    /// 是否已经读完全部内容（只剩空白）
+    bool AtEnd();
+
+    /// 查看下一个值的类型
+    Type Peek();
+    /// 进入对象
+    bool BeginObject();
+    /// 读取对象中的下一个键。对象结束时返回false
+    bool NextKey(std::string& key);
+    /// 进入数组
+    bool BeginArray();
+    /// 数组中是否还有下一个元素。数组结束时返回false
+    bool NextElement();
+
+    bool ReadString(std::string& value);
+    bool ReadNumber(double& value);
+    /// 读取整数。数值不是整数或者超出int的范围时进入失败状态
+    bool ReadInt(int& value);
+    bool ReadBool(bool& value);
+    /// 跳过下一个值，包括其中嵌套的内容
+    bool SkipValue();
+};
+
+/* #endregion */
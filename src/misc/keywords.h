@@ -0,0 +1,198 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "enums.h"
+
+/// 编译期构造的关键字表。以完美哈希将字符串映射到值，查找时只需计算一次哈希并比较一次字符串。
+///
+/// 通过MakeKeywordTable构造：
+///
+///     constexpr auto table = MakeKeywordTable<int>({{"a", 0}, {"b", 1}});
+///     const int* val = table.Find("a");
+template <typename T, std::size_t N, std::size_t Slots>
+class KeywordTable
+{
+public:
+	using Entry = std::pair<std::string_view, T>;
+
+private:
+	struct Slot {
+		std::string_view key;
+		T value{};
+		bool used = false;
+	};
+
+	std::array<Slot, Slots> slots{};
+	uint32_t seed = 0;
+
+public:
+	constexpr KeywordTable(const Entry (&entries)[N]) {
+		// 依次尝试种子，直到所有关键字落在不同的槽位上
+		for (uint32_t s = 1;; ++s) {
+			if (TryBuild(entries, s)) {
+				this->seed = s;
+				return;
+			}
+		}
+	}
+
+	/// 查找关键字，不存在时返回nullptr
+	constexpr const T* Find(std::string_view key) const {
+		const Slot& slot = this->slots[Hash(key, this->seed) & (Slots - 1)];
+		return (slot.used && slot.key == key) ? &slot.value : nullptr;
+	}
+
+	/// 查找关键字，不存在时返回fallback
+	constexpr T Get(std::string_view key, T fallback) const {
+		const T* found = this->Find(key);
+		return found != nullptr ? *found : fallback;
+	}
+
+	/// 关键字数量
+	constexpr std::size_t Size() const { return N; }
+
+private:
+	static constexpr uint32_t Hash(std::string_view key, uint32_t seed) {
+		// FNV-1a
+		uint32_t h = 2166136261u ^ seed;
+		for (char ch : key) {
+			h ^= static_cast<uint8_t>(ch);
+			h *= 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	constexpr bool TryBuild(const Entry (&entries)[N], uint32_t s) {
+		for (auto& slot : this->slots) {
+			slot = Slot{};
+		}
+		for (std::size_t i = 0; i < N; ++i) {
+			Slot& slot = this->slots[Hash(entries[i].first, s) & (Slots - 1)];
+			if (slot.used) {
+				return false;
+			}
+			slot.key = entries[i].first;
+			slot.value = entries[i].second;
+			slot.used = true;
+		}
+		return true;
+	}
+};
+
+/// 关键字表的槽位数：不小于关键字数量两倍的2的幂
+constexpr std::size_t KeywordSlots(std::size_t n) {
+	std::size_t slots = 1;
+	while (slots < 2 * n) {
+		slots <<= 1;
+	}
+	return slots;
+}
+
+/// 构造关键字表
+template <typename T, std::size_t N>
+constexpr KeywordTable<T, N, KeywordSlots(N)> MakeKeywordTable(const std::pair<std::string_view, T> (&entries)[N]) {
+	return KeywordTable<T, N, KeywordSlots(N)>(entries);
+}
+
+/* #region ksh关键字 */
+
+/// ksh中标记的关键字对应的类型
+struct MarkKeyword {
+	MarkType type;
+	Side side;
+};
+
+/// ksh标记关键字表，如 t=120 中的t
+inline constexpr auto g_KshMarkKeywords = MakeKeywordTable<MarkKeyword>({
+	{"t", {MarkType::BPM, Side::L}},
+	{"beat", {MarkType::TimeSignature, Side::L}},
+	{"fx-l", {MarkType::FXLong, Side::L}},
+	{"fx-r", {MarkType::FXLong, Side::R}},
+	{"fx-l_se", {MarkType::FXChip, Side::L}},
+	{"fx-r_se", {MarkType::FXChip, Side::R}},
+	{"laserrange_l", {MarkType::Laser2x, Side::L}},
+	{"laserrange_r", {MarkType::Laser2x, Side::R}},
+	{"filtertype", {MarkType::Filter, Side::L}},
+	{"pfiltergain", {MarkType::KnobVolume, Side::L}},
+	{"chokkakuse", {MarkType::SlamSound, Side::L}},
+	{"chokkakuvol", {MarkType::SlamVolume, Side::L}},
+	{"tilt", {MarkType::Tilt, Side::L}},
+	{"zoom_top", {MarkType::ZoomTop, Side::L}},
+	{"zoom_bottom", {MarkType::ZoomBottom, Side::L}},
+	{"zoom_side", {MarkType::ZoomSide, Side::L}},
+	{"stop", {MarkType::Stop, Side::L}},
+	{"center_split", {MarkType::LaneSplit, Side::L}},
+});
+
+/* #endregion */
+
+/* #region IndexedChart文本格式关键字 */
+
+/// IndexedChart文本格式中section的类型和表序号
+struct SectionKeyword {
+	/// 0: BT, 1: FX, 2: 旋钮, 3: 标记, 4: 回转特效, 5: 注释, 6: 其他内容
+	int type;
+	/// 同类表中的序号
+	int id;
+};
+
+/// IndexedChart文本格式的section名称表。标记的section名称与ksh标记关键字相同。
+inline constexpr auto g_SectionKeywords = MakeKeywordTable<SectionKeyword>({
+	{"BT-A", {0, 0}},
+	{"BT-B", {0, 1}},
+	{"BT-C", {0, 2}},
+	{"BT-D", {0, 3}},
+	{"FX-L", {1, 0}},
+	{"FX-R", {1, 1}},
+	{"Knob-L", {2, 0}},
+	{"Knob-R", {2, 1}},
+	{"t", {3, 0}},
+	{"beat", {3, 1}},
+	{"fx-l", {3, 2}},
+	{"fx-r", {3, 3}},
+	{"fx-l_se", {3, 4}},
+	{"fx-r_se", {3, 5}},
+	{"laserrange_l", {3, 6}},
+	{"laserrange_r", {3, 7}},
+	{"filtertype", {3, 8}},
+	{"pfiltergain", {3, 9}},
+	{"chokkakuse", {3, 10}},
+	{"chokkakuvol", {3, 11}},
+	{"tilt", {3, 12}},
+	{"zoom_top", {3, 13}},
+	{"zoom_bottom", {3, 14}},
+	{"zoom_side", {3, 15}},
+	{"stop", {3, 16}},
+	{"center_split", {3, 17}},
+	{"Spin Effect", {4, 0}},
+	{"Comments", {5, 0}},
+	{"Other Items", {6, 0}},
+});
+
+/* #endregion */
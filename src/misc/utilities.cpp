@@ -371,6 +371,41 @@ tuple<double, double> ReadRatio(const std::string& str)
     return {numer, denom};
 }
 
+std::string EscapeLine(const std::string& str)
+{
+    std::string output;
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '\\': output += "\\\\"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default: output += c; break;
+        }
+    }
+    return output;
+}
+
+std::string UnescapeLine(const std::string& str)
+{
+    std::string output;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '\\' && i + 1 < str.size())
+        {
+            char c = str[++i];
+            output += c == 'n' ? '\n' : c == 'r' ? '\r' : c == 't' ? '\t' : c;
+        }
+        else
+        {
+            output += str[i];
+        }
+    }
+    return output;
+}
+
 /* #endregion */
 
 /* #region knob params */
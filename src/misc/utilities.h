@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -206,6 +207,12 @@ std::tuple<int, int> ReadRatioI(const std::string& str);
 /// 将 "a/b" 格式的比例字符串读入两个double中
 std::tuple<double, double> ReadRatio(const std::string& str);
 
+/// 转义字符串中的\、换行、回车和\t，使其可以作为一行中以\t分隔的字段保存
+std::string EscapeLine(const std::string& str);
+
+/// EscapeLine的逆操作
+std::string UnescapeLine(const std::string& str);
+
 /* #endregion */
 
 /* #region knob params */
@@ -241,3 +248,39 @@ inline char ToKnobChar(double knob_pos, bool laser2x = false)
 }
 
 /* #endregion */
+
+/* #region hash */
+
+/// FNV-1a哈希的初始值
+constexpr uint64_t kHashSeed = 1469598103934665603ULL;
+
+/// 将一段数据累加进FNV-1a哈希值。用于判断内容是否变化，不用于加密
+inline void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+}
+
+inline void HashValue(uint64_t& hash, int value)
+{
+    HashBytes(hash, &value, sizeof(value));
+}
+
+inline void HashValue(uint64_t& hash, const std::string& value)
+{
+    HashValue(hash, static_cast<int>(value.size()));
+    HashBytes(hash, value.data(), value.size());
+}
+
+/// 一段文本内容的哈希值
+inline uint64_t HashString(const std::string& value)
+{
+    uint64_t hash = kHashSeed;
+    HashValue(hash, value);
+    return hash;
+}
+
+/* #endregion */
@@ -0,0 +1,116 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "worker_pool.h"
+
+using namespace std;
+
+WorkerPool::WorkerPool(int thread_count)
+{
+    for (int i = 1; i < thread_count; ++i)
+    {
+        this->workers.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<std::mutex> lock(this->pool_mutex);
+        this->stopping = true;
+    }
+    this->task_ready.notify_all();
+    for (auto& worker : this->workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::Drain(const Task& round_task, int round_count)
+{
+    for (int i = this->next_index++; i < round_count; i = this->next_index++)
+    {
+        round_task(i);
+    }
+}
+
+void WorkerPool::WorkerLoop()
+{
+    unsigned int seen_generation = 0;
+    while (true)
+    {
+        const Task* round_task = nullptr;
+        int round_count = 0;
+        {
+            unique_lock<std::mutex> lock(this->pool_mutex);
+            this->task_ready.wait(lock, [&] { return this->stopping || this->generation != seen_generation; });
+            if (this->stopping)
+            {
+                return;
+            }
+            seen_generation = this->generation;
+            // 醒来时这一轮可能已经结束
+            if (this->task == nullptr)
+            {
+                continue;
+            }
+            round_task = this->task;
+            round_count = this->task_count;
+            ++this->busy_workers;
+        }
+
+        this->Drain(*round_task, round_count);
+
+        {
+            lock_guard<std::mutex> lock(this->pool_mutex);
+            --this->busy_workers;
+        }
+        this->task_done.notify_one();
+    }
+}
+
+void WorkerPool::Run(int count, const Task& task)
+{
+    if (this->workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<std::mutex> lock(this->pool_mutex);
+        this->task = &task;
+        this->task_count = count;
+        this->next_index = 0;
+        ++this->generation;
+    }
+    this->task_ready.notify_all();
+
+    this->Drain(task, count);
+
+    // 等待其他线程手上的任务完成
+    unique_lock<std::mutex> lock(this->pool_mutex);
+    this->task_done.wait(lock, [&] { return this->busy_workers == 0; });
+    this->task = nullptr;
+    this->task_count = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// 固定数量的工作线程，用于并行执行一组互相独立的任务。
+///
+/// 调用Run的线程也会参与执行，Run会阻塞到所有任务完成。
+class WorkerPool
+{
+public:
+    using Task = std::function<void(int)>;
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex pool_mutex;
+    std::condition_variable task_ready;
+    std::condition_variable task_done;
+
+    // 当前一轮的任务。各线程以原子计数领取任务编号
+    const Task* task = nullptr;
+    int task_count = 0;
+    std::atomic<int> next_index{0};
+    // 当前一轮中仍在执行任务的工作线程数
+    int busy_workers = 0;
+    // 轮次编号，用于唤醒工作线程
+    unsigned int generation = 0;
+    bool stopping = false;
+
+    /// 工作线程主循环
+    void WorkerLoop();
+    /// 领取并执行任务，直到当前一轮的任务被领完
+    void Drain(const Task& round_task, int round_count);
+
+public:
+    /// @brief 构造
+    /// @param thread_count 总线程数（包括调用Run的线程）
+    explicit WorkerPool(int thread_count);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// 总线程数（包括调用Run的线程）
+    inline int Size() const;
+
+    /// 以task(0) ~ task(count - 1)的形式执行一组任务，全部完成后返回
+    void Run(int count, const Task& task);
+};
+
+inline int WorkerPool::Size() const
+{
+    return static_cast<int>(this->workers.size()) + 1;
+}
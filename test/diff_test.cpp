@@ -0,0 +1,120 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 按表比较的测试：两张差异已知的谱面报告的表、时刻、差异类型和值与预期一致；容差内的数值视为相同；
+// 谱面与自身比较时没有差异。
+
+#include <sstream>
+#include <tuple>
+
+#include "src/Chart/chart.h"
+#include "src/Chart/chart_diff.h"
+#include "src/Chart/indexed_chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+// 第一小节BT-A换成BT-C；第二小节zoom_top从10改为10.004，去掉FX-L长押和laserrange_l；
+// 第三小节旋钮的值从o改为5，并新增zoom_bottom
+static const char* kOldChart =
+    "title=diff\r\nt=120\r\nver=167\r\n--\r\n"
+    "beat=4/4\r\n1000|00|--\r\n0000|00|--\r\n0000|00|--\r\n0000|00|--\r\n--\r\n"
+    "zoom_top=10\r\n0000|00|--\r\n0000|10|--\r\n0000|10|--\r\nlaserrange_l=2x\r\n0000|00|0-\r\n--\r\n"
+    "0000|00|o-\r\n--\r\n";
+static const char* kNewChart =
+    "title=diff\r\nt=120\r\nver=167\r\n--\r\n"
+    "beat=4/4\r\n0010|00|--\r\n0000|00|--\r\n0000|00|--\r\n0000|00|--\r\n--\r\n"
+    "zoom_top=10.004\r\n0000|00|--\r\n0000|00|--\r\n0000|00|--\r\n0000|00|0-\r\n--\r\n"
+    "zoom_bottom=5\r\n0000|00|5-\r\n--\r\n";
+
+using Expected = tuple<string, int, ChartDiff::Kind, string, string>;
+
+static void CheckEvents(const ChartDiff& diff, const vector<Expected>& expected)
+{
+    CHECK(diff.Events().size() == expected.size());
+    for (size_t i = 0; i < min(diff.Events().size(), expected.size()); ++i)
+    {
+        const ChartDiff::Event& event = diff.Events()[i];
+        CHECK_MSG(Expected(event.lane, event.time, event.kind, event.old_value, event.new_value) == expected[i],
+                  "event " << i << ": " << event.lane << " @" << event.time);
+    }
+}
+
+static void CheckKnownDifferences()
+{
+    Chart old_chart, new_chart;
+    CHECK(old_chart.ImportFromString(kOldChart));
+    CHECK(new_chart.ImportFromString(kNewChart));
+    IndexedChart old_ic(old_chart), new_ic(new_chart);
+    CHECK(!old_ic.SameAs(new_ic));
+
+    using Kind = ChartDiff::Kind;
+    vector<Expected> expected = {
+        {"BT-A", 0, Kind::Removed, "1", ""},
+        {"BT-C", 0, Kind::Added, "", "1"},
+        {"FX-L", 240, Kind::Removed, "2", ""},
+        {"FX-L", 336, Kind::Removed, "0", ""},
+        {"Knob-L", 384, Kind::Changed, "50", "5"},
+        {"laserrange_l", 336, Kind::Removed, "2x", ""},
+        {"zoom_top", 192, Kind::Changed, "10", "10.004"},
+        {"zoom_bottom", 384, Kind::Added, "", "5"},
+    };
+    ChartDiff exact;
+    old_ic.DiffWith(new_ic, exact);
+    CheckEvents(exact, expected);
+    CHECK(exact.Count(Kind::Added) == 2);
+    CHECK(exact.Count(Kind::Removed) == 4);
+    CHECK(exact.Count(Kind::Changed) == 2);
+
+    // 容差内的zoom_top不再报告
+    expected.erase(expected.begin() + 6);
+    ChartDiff tolerant(0.01);
+    old_ic.DiffWith(new_ic, tolerant);
+    CheckEvents(tolerant, expected);
+
+    ostringstream printed;
+    tolerant.Print(printed);
+    CHECK(printed.str().find("BT-C @0: + 1\n") != string::npos);
+    CHECK(printed.str().find("Knob-L @384: 50 -> 5\n") != string::npos);
+    CHECK(printed.str().find("2 added, 4 removed, 1 changed.\n") != string::npos);
+}
+
+/// 各fixture与自身、与重新读入的自身比较
+static void CheckFixtures(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        Chart chart, reread;
+        CHECK_MSG(chart.ImportFromFile(path), path);
+        CHECK_MSG(reread.ImportFromString(chart.ExportToString()), path);
+        IndexedChart ic(chart), reread_ic(reread);
+        CHECK_MSG(ic.SameAs(reread_ic), path);
+        ChartDiff diff;
+        ic.DiffWith(reread_ic, diff);
+        CHECK_MSG(diff.Empty(), path);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CheckKnownDifferences();
+    CheckFixtures(argc, argv);
+    return TestResult();
+}
@@ -0,0 +1,118 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 增量执行的测试：输入没有变化时，再次增量执行能复用上次的结果（包括含有独占命令的谱面），且输出与完整执行相同；
+// 结束命令挪动位置后增量执行的输出与完整执行相同。
+
+#include <fstream>
+#include <sstream>
+
+#include "src/Application/application_bus.h"
+#include "src/Application/execution_record.h"
+#include "src/Chart/chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 一次执行的输出
+struct RunResult
+{
+    string chart;
+    string log;
+    int skipped = 0;
+};
+
+/// 处理谱面。给出上次的记录和输出时增量执行
+static RunResult Process(const string& text, const PathManager& paths, const ExecutionRecord* previous,
+                         const string* previous_text, ExecutionRecord& record)
+{
+    Chart chart;
+    CHECK(chart.ImportFromString(text));
+
+    ApplicationBus bus(paths);
+    ostringstream log;
+    bus.GetErrorCollector().SetOutput(&log);
+    bus.BindChart(std::move(chart));
+
+    RunResult result;
+    if (previous != nullptr)
+    {
+        // 与命令行一样，上次的输出从文本重新读入
+        Chart previous_chart;
+        CHECK(previous_chart.ImportFromString(*previous_text));
+        IndexedChart previous_output;
+        previous_output.ImportFromChart(previous_chart);
+        result.skipped = bus.RunCommandsIncremental(*previous, previous_output, record);
+    }
+    else
+    {
+        bus.RunCommandsIncremental(ExecutionRecord(), IndexedChart(), record);
+    }
+    result.chart = bus.TakeChart().ExportToString();
+    result.log = log.str();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        PathManager paths = PathManager::GetInstance();
+        paths.AddPath(argv[1]);
+
+        ifstream file(path, ios::binary);
+        const string text{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+
+        ExecutionRecord first_record, second_record;
+        RunResult first = Process(text, paths, nullptr, nullptr, first_record);
+        CHECK_MSG(first.skipped == 0, path);
+
+        RunResult second = Process(text, paths, &first_record, &first.chart, second_record);
+        CHECK_MSG(second.chart == first.chart, path << " chart");
+        CHECK_MSG(second.log == first.log, path << " log");
+        // 含有swing、tiltstyle、摄像机放大等独占命令的谱面同样可以复用
+        CHECK_MSG(second.skipped > 0, path << " skipped nothing");
+
+        // 把前一行是音符行的第一个结束命令往前挪一行，成对的起始命令必须重新执行
+        size_t end_pos = text.find("//end ");
+        size_t prev_pos = 0;
+        for (; end_pos != string::npos; end_pos = text.find("//end ", end_pos + 1))
+        {
+            prev_pos = text.rfind('\n', end_pos - 2) + 1;
+            if (text.compare(prev_pos, 2, "//") != 0 && text.compare(prev_pos, 2, "--") != 0)
+            {
+                break;
+            }
+        }
+        if (end_pos == string::npos)
+        {
+            continue;
+        }
+        const size_t line_end = text.find('\n', end_pos) + 1;
+        string edited = text.substr(0, prev_pos) + text.substr(end_pos, line_end - end_pos) +
+                        text.substr(prev_pos, end_pos - prev_pos) + text.substr(line_end);
+        ExecutionRecord full_record, edited_record;
+        RunResult full = Process(edited, paths, nullptr, nullptr, full_record);
+        RunResult incremental = Process(edited, paths, &first_record, &first.chart, edited_record);
+        CHECK_MSG(incremental.chart == full.chart, path << " edited chart");
+        CHECK_MSG(incremental.log == full.log, path << " edited log");
+    }
+    return TestResult();
+}
@@ -0,0 +1,108 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// JSON读取的测试：嵌套过深的内容作为格式错误拒绝，而不是耗尽栈；超出int范围的整数不被读入。
+
+#include <string>
+
+#include "src/Chart/kson.h"
+#include "src/misc/json.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// depth层嵌套的数组
+static string NestedArrays(int depth)
+{
+    return string(depth, '[') + string(depth, ']');
+}
+
+static void CheckDepth()
+{
+    {
+        const string text = NestedArrays(JsonReader::kMaxDepth);
+        JsonReader reader(text);
+        CHECK(reader.SkipValue());
+        CHECK(!reader.Failed());
+        CHECK(reader.AtEnd());
+    }
+    {
+        const string text = NestedArrays(JsonReader::kMaxDepth + 1);
+        JsonReader reader(text);
+        CHECK(!reader.SkipValue());
+        CHECK(reader.Failed());
+    }
+    {
+        // 足以在没有限制时耗尽栈的深度
+        const string text = "{\"a\":" + string(1000000, '[');
+        JsonReader reader(text);
+        CHECK(!reader.SkipValue());
+        CHECK(reader.Failed());
+    }
+    {
+        // 对象和数组交替嵌套，同一层的兄弟节点不累计层数
+        string text;
+        for (int i = 0; i < JsonReader::kMaxDepth / 2 - 1; ++i)
+        {
+            text += "{\"k\":[1,{},[]],\"v\":[";
+        }
+        for (int i = 0; i < JsonReader::kMaxDepth / 2 - 1; ++i)
+        {
+            text += "]}";
+        }
+        JsonReader reader(text);
+        CHECK(reader.SkipValue());
+        CHECK(!reader.Failed());
+    }
+    {
+        // 谱面中未知的键同样受限制
+        const string text = "{\"version\":\"0.8.0\",\"unknown\":" + string(1000000, '[') + "}";
+        IndexedChart ic;
+        Header header;
+        CHECK(!ImportFromKson(text, ic, header));
+    }
+}
+
+static void CheckInt()
+{
+    const pair<string, bool> cases[] = {
+        {"0", true},          {"-7", true},          {"2147483647", true}, {"-2147483648", true},
+        {"2147483648", false}, {"-2147483649", false}, {"1e300", false},    {"-1e300", false},
+        {"1.5", false},        {"4.0", true},
+    };
+    for (auto& [text, valid] : cases)
+    {
+        JsonReader reader(text);
+        int value = 0;
+        CHECK_MSG(reader.ReadInt(value) == valid, text);
+        CHECK_MSG(reader.Failed() != valid, text);
+        if (valid)
+        {
+            CHECK_MSG(value == static_cast<int>(stod(text)), text);
+        }
+    }
+}
+
+int main()
+{
+    CheckDepth();
+    CheckInt();
+    return TestResult();
+}
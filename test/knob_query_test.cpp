@@ -0,0 +1,427 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 旋钮查询的等价性测试：KnobSegmentIndex和KnobPosList缓存给出的结果，
+// 与改用索引之前逐点扫描旋钮表的实现（Legacy命名空间内，照搬自原来的Shared/knob_query.cpp）逐刻比较。
+
+#include <optional>
+#include <sstream>
+
+#include "src/Application/Shared/knob_query.h"
+#include "src/Chart/chart.h"
+#include "src/Chart/indexed_chart.h"
+#include "src/misc/utilities.h"
+#include "test_utils.h"
+
+using namespace std;
+
+namespace Legacy
+{
+
+// 原实现在部分边界上会越过表尾取值（未定义行为），这些情况返回nullopt，不参与比较
+
+bool IsSlam(const IndexList<int>& lst, int time)
+{
+    if (!lst.hasKey(time))
+    {
+        return false;
+    }
+    int start_val = lst.startVal(time);
+    int end_val = lst.endVal(time);
+    return start_val != end_val && start_val != -1 && end_val != -1;
+}
+
+optional<bool> IsSlamToVoid(const IndexList<int>& lst, IndexList<int>::ConstIterator iter)
+{
+    auto next = iter;
+    ++next;
+    if (next == lst.end())
+    {
+        return nullopt;
+    }
+    return (iter->second.first() != iter->second.second() && next->second.first() != next->second.second() &&
+            next->second.first() == iter->second.second() && next->second.second() == -1 &&
+            next->first - iter->first <= 6);
+}
+
+bool IsStart(const IndexList<int>& lst, int time)
+{
+    if (!lst.hasKey(time))
+    {
+        return false;
+    }
+    auto iter = lst.prevItem(time - 1);
+    return (iter == lst.end() || iter->second.second() == -1);
+}
+
+bool IsNormalEnd(const IndexList<int>& lst, int time)
+{
+    return lst.hasKey(time) && lst.endVal(time) == -1;
+}
+
+optional<bool> IsEnd(const IndexList<int>& lst, int time)
+{
+    if (!lst.hasKey(time))
+    {
+        return false;
+    }
+    auto iter = lst.prevItem(time);
+    if (iter->second.second() == -1)
+    {
+        return true;
+    }
+    return IsSlamToVoid(lst, iter);
+}
+
+bool ExistsSlam(const IndexList<int>& lst, int start, int end)
+{
+    auto iter = lst.nextItem(start - 1);
+    while (iter != lst.end() && iter->first <= end)
+    {
+        if (iter->second.first() != iter->second.second() && iter->second.first() != -1 && iter->second.second() != -1)
+        {
+            return true;
+        }
+        ++iter;
+    }
+    return false;
+}
+
+int LastSlam(const IndexList<int>& lst, int time)
+{
+    auto iter = lst.prevItem(time);
+    while (iter != lst.end())
+    {
+        if (iter->second.first() != iter->second.second() && iter->second.first() != -1 && iter->second.second() != -1)
+        {
+            return iter->first;
+        }
+        if (iter == lst.begin())
+        {
+            break;
+        }
+        --iter;
+    }
+    return -1;
+}
+
+bool IsLaser2x(const IndexList<int>& knob_list, const IndexList<string>& laser2x_list, int time)
+{
+    auto iter = knob_list.prevItem(time + 1);
+    if (iter == knob_list.end())
+    {
+        return false;
+    }
+    while (iter->second.second() != -1 && iter != knob_list.begin())
+    {
+        --iter;
+    }
+    if (!(iter == knob_list.begin() && iter->second.second() != -1))
+    {
+        ++iter;
+    }
+    if (iter == knob_list.end())
+    {
+        return false;
+    }
+    return laser2x_list.hasKey(iter->first);
+}
+
+optional<double> InterpolateKnobPos(const IndexList<int>& lst, int time)
+{
+    auto prev_iter = lst.prevItem(time);
+    if (prev_iter != lst.end())
+    {
+        while (prev_iter != lst.begin() && prev_iter->second.first() == -1)
+        {
+            --prev_iter;
+        }
+    }
+    auto next_iter = lst.nextItem(time);
+    while (next_iter != lst.end() && next_iter->second.first() == -1)
+    {
+        ++next_iter;
+    }
+    if (prev_iter == lst.end() || next_iter == lst.end())
+    {
+        return nullopt;
+    }
+
+    int prev_pos = prev_iter->second.second();
+    int next_pos = next_iter->second.first();
+    if (next_iter->second.second() == -1 && next_iter->first - prev_iter->first <= 6 &&
+        Legacy::IsSlam(lst, prev_iter->first))
+    {
+        next_pos = -1;
+    }
+    if (prev_pos == -1 || next_pos == -1)
+    {
+        return -1;
+    }
+    return LinearInterpolation(prev_iter->first, prev_pos, next_iter->first, next_pos, time);
+}
+
+optional<double> KnobStartPos(const IndexList<int>& lst, int time)
+{
+    if (!lst.hasKey(time))
+    {
+        return InterpolateKnobPos(lst, time);
+    }
+    if (lst.endVal(time) == -1)
+    {
+        auto prev = lst.prevItem(time - 1);
+        if (prev == lst.end())
+        {
+            return nullopt;
+        }
+        if (prev->second.first() != prev->second.second() && time - prev->first <= 6)
+        {
+            return -1;
+        }
+    }
+    return lst.startVal(time);
+}
+
+optional<double> KnobEndPos(const IndexList<int>& lst, int time)
+{
+    if (!lst.hasKey(time))
+    {
+        return InterpolateKnobPos(lst, time);
+    }
+    if (lst.startVal(time) != lst.endVal(time))
+    {
+        auto next = lst.nextItem(time);
+        if (next == lst.end())
+        {
+            return nullopt;
+        }
+        if (next->second.second() == -1 && next->first - time <= 6)
+        {
+            return -1;
+        }
+    }
+    return lst.startVal(time);
+}
+
+pair<int, double> NextStartPos(const IndexList<int>& lst, int time)
+{
+    if (lst.size() == 0)
+    {
+        return {-1, -1};
+    }
+    auto iter = lst.nextItem(time - 1);
+    if (iter == lst.end())
+    {
+        return {-1, -1};
+    }
+    if (iter == lst.begin())
+    {
+        return {iter->first, iter->second.first()};
+    }
+    --iter;
+    while (iter != lst.end() && iter->second.first() != -1)
+    {
+        ++iter;
+    }
+    if (iter != lst.end())
+    {
+        ++iter;
+    }
+    if (iter == lst.end())
+    {
+        return {-1, -1};
+    }
+    return {iter->first, iter->second.first()};
+}
+
+optional<pair<int, double>> LastEndPos(const IndexList<int>& lst, int time, bool before_slam)
+{
+    if (lst.size() == 0)
+    {
+        return pair<int, double>(-1, -1);
+    }
+    auto iter = lst.prevItem(time);
+    if (iter == lst.end())
+    {
+        return pair<int, double>(-1, -1);
+    }
+    while (iter != lst.begin() && (iter->second.second() != -1 || iter->second.first() == -1))
+    {
+        --iter;
+    }
+    if (before_slam && Legacy::IsSlam(lst, iter->first - 6))
+    {
+        if (iter == lst.begin())
+        {
+            return nullopt;
+        }
+        --iter;
+    }
+    return pair<int, double>(iter->first, iter->second.first());
+}
+
+IndexList<double> KnobPosList(const IndexList<int>& knob_list, const IndexList<string>& laser2x_list)
+{
+    IndexList<double> output;
+    bool continuing_knob = false;
+    bool laser2x = false;
+    for (auto& item : knob_list)
+    {
+        laser2x = (continuing_knob && laser2x) ||
+                  (!continuing_knob && item.second.first() != -1 && laser2x_list.hasKey(item.first));
+        continuing_knob = item.second.second() != -1;
+
+        double start_val = item.second.first();
+        double end_val = item.second.second();
+        if (laser2x)
+        {
+            start_val = item.second.first() == -1 ? -1 : 2 * ToKnobPos(item.second.first(), true) - 25;
+            end_val = item.second.second() == -1 ? -1 : 2 * ToKnobPos(item.second.second(), true) - 25;
+        }
+        output.insert(item.first, start_val, end_val);
+    }
+    return output;
+}
+
+}  // namespace Legacy
+
+static bool SameList(const IndexList<double>& a, const IndexList<double>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (auto iter_a = a.begin(), iter_b = b.begin(); iter_a != a.end(); ++iter_a, ++iter_b)
+    {
+        if (iter_a->first != iter_b->first || iter_a->second.first() != iter_b->second.first() ||
+            iter_a->second.second() != iter_b->second.second())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// 对单侧旋钮逐刻比较新旧查询
+static void CompareKnob(const IndexedChart& chart, Knob knob, const string& name)
+{
+    const IndexList<int>& lst = chart.KnobList(knob);
+    const IndexList<string>& laser2x_list = chart.MarkList(MarkType::Laser2x, ToSide(knob));
+    const string label = name + (knob == Knob::L ? " L" : " R");
+    const int end_time = chart.TotalTime() + 12;
+
+    for (int time = 0; time <= end_time; ++time)
+    {
+        ostringstream where;
+        where << label << " @" << time;
+
+        CHECK_MSG(IsSlam(chart, knob, time) == Legacy::IsSlam(lst, time), where.str() << " IsSlam");
+        CHECK_MSG(IsStart(chart, knob, time) == Legacy::IsStart(lst, time), where.str() << " IsStart");
+        CHECK_MSG(IsNormalEnd(chart, knob, time) == Legacy::IsNormalEnd(lst, time), where.str() << " IsNormalEnd");
+        auto is_end = Legacy::IsEnd(lst, time);
+        CHECK_MSG(!is_end || IsEnd(chart, knob, time) == *is_end, where.str() << " IsEnd");
+        for (int length : {0, 6, 48, 192})
+        {
+            CHECK_MSG(ExistsSlam(chart, knob, time, time + length) == Legacy::ExistsSlam(lst, time, time + length),
+                      where.str() << " ExistsSlam +" << length);
+        }
+        CHECK_MSG(LastSlam(chart, knob, time) == Legacy::LastSlam(lst, time), where.str() << " LastSlam");
+        CHECK_MSG(IsLaser2x(chart, knob, time) == Legacy::IsLaser2x(lst, laser2x_list, time),
+                  where.str() << " IsLaser2x");
+
+        auto start_pos = Legacy::KnobStartPos(lst, time);
+        CHECK_MSG(!start_pos || KnobStartPos(chart, knob, time) == *start_pos, where.str() << " KnobStartPos");
+        auto end_pos = Legacy::KnobEndPos(lst, time);
+        CHECK_MSG(!end_pos || KnobEndPos(chart, knob, time) == *end_pos, where.str() << " KnobEndPos");
+
+        CHECK_MSG(NextStartPos(chart, knob, time) == Legacy::NextStartPos(lst, time), where.str() << " NextStartPos");
+        auto last_end = Legacy::LastEndPos(lst, time, false);
+        CHECK_MSG(!last_end || LastEndPos(chart, knob, time) == *last_end, where.str() << " LastEndPos");
+        auto last_end_before_slam = Legacy::LastEndPos(lst, time, true);
+        CHECK_MSG(!last_end_before_slam || LastEndPos_BeforeSlam(chart, knob, time) == *last_end_before_slam,
+                  where.str() << " LastEndPos_BeforeSlam");
+    }
+
+    CHECK_MSG(SameList(chart.KnobPosList(knob), Legacy::KnobPosList(lst, laser2x_list)), label << " KnobPosList");
+}
+
+static void CompareChart(IndexedChart& chart, const string& name)
+{
+    CompareKnob(chart, Knob::L, name);
+    CompareKnob(chart, Knob::R, name);
+
+    // 修改旋钮之后，增量更新的索引和缓存仍然要与重新扫描的结果一致
+    for (Knob knob : {Knob::L, Knob::R})
+    {
+        int total_time = chart.TotalTime();
+        IndexList<int> replacement;
+        replacement.insert(total_time / 2, 0);
+        replacement.insert(total_time / 2 + 6, 50, 25);
+        replacement.insert(total_time / 2 + 12, 25, -1);
+        chart.ReplaceKnob(knob, replacement);
+        CompareKnob(chart, knob, name + " (modified)");
+    }
+}
+
+/// 由左右旋钮各行的字符组成一个小节，字符串不足line_count时用"-"补齐
+static string MeasureText(int line_count, const string& left, const string& right)
+{
+    string output;
+    for (int i = 0; i < line_count; ++i)
+    {
+        output += "0000|00|";
+        output += i < static_cast<int>(left.size()) ? left[i] : '-';
+        output += i < static_cast<int>(right.size()) ? right[i] : '-';
+        output += "\r\n";
+    }
+    return output + "--\r\n";
+}
+
+/// 直角旋钮的各种边界：直角后立刻断开（6个单位和3个单位内），直角后继续，外扩旋钮，谱面末尾仍未结束的旋钮
+static string SlamChartText()
+{
+    string output = "title=knob query test\r\nt=120\r\n--\r\n";
+    // 32行，每行6个单位
+    string measure = MeasureText(32, "0o--5:K0:::o", "");
+    measure.insert(4 * 12, "laserrange_l=2x\r\n");
+    output += measure;
+    // 64行，每行3个单位
+    output += MeasureText(64, "", "0o--5F::F0--0o:::::::::::::::::::::::::::::::::::::::::::::::::::");
+    output += MeasureText(32, "", "::o0::::::::::::::::::::::::::::");
+    return output;
+}
+
+int main(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        Chart chart;
+        CHECK_MSG(chart.ImportFromFile(path), path);
+        IndexedChart ic(chart);
+        CompareChart(ic, path);
+    }
+
+    Chart chart;
+    CHECK(chart.ImportFromString(SlamChartText()));
+    IndexedChart ic(chart);
+    CompareChart(ic, "slam chart");
+
+    return TestResult();
+}
@@ -0,0 +1,63 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 并行执行的测试：按访问范围并行执行命令时，输出的谱面和日志与依次执行完全相同。
+
+#include <sstream>
+
+#include "src/Application/application_bus.h"
+#include "src/Chart/chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 用指定的线程数处理谱面，返回输出的谱面和日志
+static pair<string, string> Process(const string& path, const PathManager& paths, int workers)
+{
+    Chart chart;
+    CHECK_MSG(chart.ImportFromFile(path), path);
+
+    ApplicationBus bus(paths);
+    bus.SetWorkerCount(workers);
+    ostringstream log;
+    bus.GetErrorCollector().SetOutput(&log);
+    bus.BindChart(std::move(chart));
+    bus.RunCommands();
+    Chart output = bus.TakeChart();
+    return {output.ExportToString(), log.str()};
+}
+
+int main(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        PathManager paths = PathManager::GetInstance();
+        paths.AddPath(argv[1]);
+
+        auto serial = Process(path, paths, 1);
+        for (int workers : {2, 4, 8})
+        {
+            auto parallel = Process(path, paths, workers);
+            CHECK_MSG(parallel.first == serial.first, path << " chart, " << workers << " workers");
+            CHECK_MSG(parallel.second == serial.second, path << " log, " << workers << " workers");
+        }
+    }
+    return TestResult();
+}
@@ -0,0 +1,166 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 补丁的测试：各谱面处理前后的补丁经过文件格式读回后能还原输出；小节内只改动一行时补丁只记录这一行；
+// 原谱面不符或者补丁内容有误时拒绝应用。
+
+#include <fstream>
+
+#include "src/Application/application_bus.h"
+#include "src/Chart/chart.h"
+#include "src/Chart/chart_patch.h"
+#include "test_utils.h"
+
+using namespace std;
+
+static string LoadText(const string& path)
+{
+    ifstream file(path, ios::binary);
+    return string{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+}
+
+/// 去掉回车，补丁比较时忽略回车
+static string WithoutCR(string_view text)
+{
+    string output;
+    for (char c : text)
+    {
+        if (c != '\r')
+        {
+            output += c;
+        }
+    }
+    return output;
+}
+
+/// 经过补丁文件的文本读回，再应用到old_ksh上
+static bool RoundTrip(const string& old_ksh, const string& new_ksh, string& output, ChartPatch& read)
+{
+    const string text = ChartPatch::Diff(old_ksh, new_ksh).ExportToString();
+    string error;
+    return read.ImportFromString(text) && read.Apply(old_ksh, output, error);
+}
+
+/// 处理前后的谱面
+static void CheckFixtures(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        PathManager paths = PathManager::GetInstance();
+        paths.AddPath(argv[1]);
+        Chart chart;
+        CHECK_MSG(chart.ImportFromFile(path), path);
+        ApplicationBus bus(paths);
+        ostringstream log;
+        bus.GetErrorCollector().SetOutput(&log);
+        bus.BindChart(std::move(chart));
+        bus.RunCommands();
+        const string input = LoadText(path);
+        const string output = bus.TakeChart().ExportToString();
+
+        ChartPatch read;
+        string applied;
+        CHECK_MSG(RoundTrip(input, output, applied, read), path);
+        CHECK_MSG(WithoutCR(applied) == WithoutCR(output), path);
+
+        // 输出与输入相同时补丁为空
+        CHECK_MSG(RoundTrip(output, output, applied, read) && read.Empty() && applied == output, path);
+    }
+}
+
+/// 小节内的行级改动
+static void CheckLineEdits(int /*argc*/, char** argv)
+{
+    // swing.ksh每个小节有16行音符
+    const string input = LoadText(string(argv[1]) + "/swing.ksh");
+    // 第二个小节（第二个"--"行之后）的第五行
+    size_t line = input.find("\n--", input.find("\n--") + 1) + 1;
+    for (int i = 0; i < 6; ++i)
+    {
+        line = input.find('\n', line) + 1;
+    }
+    CHECK(input[line + 4] == '|');
+
+    // 改动一行，并在小节末尾插入一行
+    string edited = input;
+    edited[line + 1] = '2';
+    edited.insert(input.find("\n--", line) + 1, "1111|00|--\r\n");
+
+    ChartPatch patch = ChartPatch::Diff(input, edited);
+    CHECK(patch.Changes().size() == 1);
+    if (patch.Changes().size() == 1)
+    {
+        const ChartPatch::Change& change = patch.Changes().front();
+        CHECK(change.index == 1);
+        CHECK(change.text.empty());
+        CHECK(change.hunks.size() == 2);
+        CHECK(!change.hunks.empty() && change.hunks.front().count == 1);
+    }
+    // 补丁只含改动的行
+    const string text = patch.ExportToString();
+    CHECK(text.size() < 200);
+
+    ChartPatch read;
+    string applied, error;
+    CHECK(RoundTrip(input, edited, applied, read));
+    CHECK(applied == edited);
+
+    // 原谱面的小节被改过时拒绝应用
+    string changed = input;
+    changed[line + 2] = changed[line + 2] == '0' ? '1' : '0';
+    CHECK(!read.Apply(changed, applied, error));
+    CHECK(!error.empty());
+}
+
+/// 补丁内容有误
+static void CheckMalformed(int argc, char** argv)
+{
+    const string input = LoadText(FixtureCharts(argc, argv).front());
+    ChartPatch patch;
+    // 行级改动缺少改动
+    CHECK(!patch.ImportFromString("KSHRAM-PATCH 2\nmeasures 1 1\nedit measure 0 1\n"));
+    // 没有所属的行级改动
+    CHECK(!patch.ImportFromString("KSHRAM-PATCH 2\nmeasures 1 1\nhunk 0 1 x\n"));
+    // 旧版本
+    CHECK(!patch.ImportFromString("KSHRAM-PATCH 1\nmeasures 1 1\n"));
+
+    // 改动的位置超出小节的行数：在第一个小节开头插入一行，得到"hunk 0 0 ..."，再把行号改大
+    string edited = input;
+    edited.insert(input.find("\n--") + 4, "0000|00|--\n");
+    string edit_text = ChartPatch::Diff(input, edited).ExportToString();
+    size_t hunk = edit_text.find("hunk 0 ");
+    CHECK(hunk != string::npos);
+    if (hunk != string::npos)
+    {
+        edit_text.replace(hunk, 6, "hunk 99999");
+        ChartPatch read;
+        string output, error;
+        CHECK(read.ImportFromString(edit_text));
+        CHECK(!read.Apply(input, output, error));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CheckFixtures(argc, argv);
+    CheckLineEdits(argc, argv);
+    CheckMalformed(argc, argv);
+    return TestResult();
+}
@@ -0,0 +1,84 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 快照的测试：ksh谱面经过快照再导出，与直接导出的ksh完全相同；快照内容损坏时拒绝读入。
+
+#include <cstdio>
+
+#include "src/Chart/chart.h"
+#include "src/Chart/chart_snapshot.h"
+#include "src/Chart/indexed_chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 导出为带有原谱面头的ksh
+static string ExportWithHeader(IndexedChart& ic, Chart& source)
+{
+    Chart chart = ic.ExportToChart();
+    chart.GetHeader() = source.GetHeader();
+    chart.GetCustomFX() = source.GetCustomFX();
+    return chart.ExportToString();
+}
+
+int main(int argc, char** argv)
+{
+    const string snapshot_path = "snapshot_test.kshsnap";
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        Chart chart;
+        CHECK_MSG(chart.ImportFromFile(path), path);
+        IndexedChart ic(chart);
+        const string expected = ExportWithHeader(ic, chart);
+        const string content = ic.ExportToSnapshot();
+
+        // 内存中的快照
+        ChartSnapshot snapshot;
+        CHECK_MSG(snapshot.Assign(content), path);
+        IndexedChart from_memory;
+        CHECK_MSG(from_memory.ImportFromSnapshot(snapshot), path);
+        CHECK_MSG(ExportWithHeader(from_memory, chart) == expected, path << " from memory");
+
+        // 映射的快照文件
+        CHECK_MSG(ChartSnapshot::Save(snapshot_path, content), path);
+        ChartSnapshot mapped;
+        CHECK_MSG(mapped.Open(snapshot_path), path);
+        IndexedChart from_file;
+        CHECK_MSG(from_file.ImportFromSnapshot(mapped), path);
+        CHECK_MSG(ExportWithHeader(from_file, chart) == expected, path << " from file");
+        for (int lane = 0; lane < mapped.LaneCount(); ++lane)
+        {
+            CHECK_MSG(from_file.LaneHash(lane) == ic.LaneHash(lane), path << " lane " << lane);
+        }
+
+        // 改动任何一个字节都会被校验发现
+        for (size_t pos = 0; pos < content.size(); pos += 7)
+        {
+            string corrupt = content;
+            corrupt[pos] = static_cast<char>(corrupt[pos] ^ 0x5a);
+            ChartSnapshot rejected;
+            CHECK_MSG(!rejected.Assign(std::move(corrupt)), path << " byte " << pos);
+        }
+        ChartSnapshot truncated;
+        CHECK_MSG(!truncated.Assign(content.substr(0, content.size() / 2)), path);
+    }
+    remove(snapshot_path.c_str());
+    return TestResult();
+}
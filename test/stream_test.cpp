@@ -0,0 +1,110 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 流式处理的测试：各种窗口大小下，流式处理的输出与整体处理相同。
+// batch.ksh末尾的batch调用会追加小节，不读入更多小节时也要与整体处理相同。
+
+#include <fstream>
+#include <sstream>
+
+#include "src/Application/application_bus.h"
+#include "src/Application/chart_streamer.h"
+#include "src/Chart/chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 一次处理的输出
+struct RunResult
+{
+    string chart;
+    int error_count = 0;
+};
+
+/// 整体处理
+static RunResult ProcessWhole(const string& text, const PathManager& paths)
+{
+    Chart chart;
+    CHECK(chart.ImportFromString(text));
+
+    ApplicationBus bus(paths);
+    ostringstream log;
+    bus.GetErrorCollector().SetOutput(&log);
+    bus.BindChart(std::move(chart));
+    bus.RunCommands();
+
+    RunResult result;
+    result.chart = bus.TakeChart().ExportToString();
+    result.error_count = bus.GetErrorCollector().ErrorCount();
+    return result;
+}
+
+/// 流式处理
+static RunResult ProcessStream(const string& text, const PathManager& paths, int window, int lookahead)
+{
+    ApplicationBus bus(paths);
+    ostringstream log;
+    bus.GetErrorCollector().SetOutput(&log);
+
+    ChartStreamer::Options options;
+    options.window = window;
+    options.lookahead = lookahead;
+    ChartStreamer streamer(bus, options);
+
+    istringstream is(text);
+    ostringstream os;
+    string error;
+    CHECK_MSG(streamer.Run(is, os, error), error);
+
+    RunResult result;
+    result.chart = os.str();
+    result.error_count = bus.GetErrorCollector().ErrorCount();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        PathManager paths = PathManager::GetInstance();
+        paths.AddPath(argv[1]);
+
+        ifstream file(path, ios::binary);
+        const string text{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+        const RunResult whole = ProcessWhole(text, paths);
+
+        vector<int> lookaheads{ChartStreamer::Options().lookahead};
+        if (path.size() >= 9 && path.compare(path.size() - 9, 9, "batch.ksh") == 0)
+        {
+            lookaheads.push_back(0);
+        }
+        for (int lookahead : lookaheads)
+        {
+            for (int window : {1, 2, 3, 5, 16})
+            {
+                const RunResult streamed = ProcessStream(text, paths, window, lookahead);
+                CHECK_MSG(streamed.chart == whole.chart, path << " window " << window << " lookahead " << lookahead);
+                CHECK_MSG(streamed.error_count == whole.error_count,
+                          path << " window " << window << " lookahead " << lookahead << " errors");
+            }
+        }
+    }
+    return TestResult();
+}
@@ -0,0 +1,84 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 节奏表的测试：跨过BPM变化和停止时，时刻与毫秒的换算正确，且两个方向互逆；
+// 修改停止后，只重建失效部分的表与重新建立的表相同。
+
+#include <cmath>
+#include <string>
+
+#include "src/Chart/tempo_map.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 毫秒数的比较，允许浮点误差
+static bool Near(double a, double b)
+{
+    return fabs(a - b) < 1e-6;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    // 120 BPM下每1/48拍 60000 / (120 * 48) ms，一个4/4小节（192）为2000ms。
+    // 第二小节开头变为240 BPM，第三小节开头停止96（按240 BPM为500ms）
+    IndexList<string> bpm_list, stop_list;
+    bpm_list.insert(0, string("120"));
+    bpm_list.insert(192, string("240"));
+    stop_list.insert(384, string("96"));
+
+    TempoMap tempo_map;
+    tempo_map.Update(bpm_list, stop_list);
+
+    CHECK(Near(tempo_map.BPMAt(191), 120.0));
+    CHECK(Near(tempo_map.BPMAt(192), 240.0));
+
+    CHECK(Near(tempo_map.TickToMs(96), 1000.0));
+    CHECK(Near(tempo_map.TickToMs(192), 2000.0));
+    CHECK(Near(tempo_map.TickToMs(288), 2500.0));
+    // 停止的时刻本身还没有停止，之后的时刻都要加上停止的时间
+    CHECK(Near(tempo_map.TickToMs(384), 3000.0));
+    CHECK(Near(tempo_map.TickToMs(480), 4000.0));
+
+    CHECK(Near(tempo_map.MsToTick(2500.0), 288.0));
+    // 停止中的时间都换算为停止的时刻
+    CHECK(Near(tempo_map.MsToTick(3200.0), 384.0));
+    CHECK(Near(tempo_map.MsToTick(4000.0), 480.0));
+
+    for (int tick = 0; tick <= 576; tick += 12)
+    {
+        CHECK_MSG(Near(tempo_map.MsToTick(tempo_map.TickToMs(tick)), tick), "tick " << tick);
+    }
+
+    // 停止变为48（250ms）后只重建之后的节点
+    stop_list.insert(384, string("48"));
+    tempo_map.Invalidate(384);
+    tempo_map.Update(bpm_list, stop_list);
+    TempoMap rebuilt;
+    rebuilt.Update(bpm_list, stop_list);
+    CHECK(tempo_map.Nodes().size() == rebuilt.Nodes().size());
+    CHECK(Near(tempo_map.TickToMs(480), 3750.0));
+    for (int tick = 0; tick <= 576; tick += 12)
+    {
+        CHECK_MSG(Near(tempo_map.TickToMs(tick), rebuilt.TickToMs(tick)), "tick " << tick);
+    }
+
+    return TestResult();
+}
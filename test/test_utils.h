@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 测试用的简单断言。失败时输出位置并计数，不中断测试，main最后返回TestResult()
+
+inline int& FailureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+#define CHECK(cond)                                                                          \
+    do                                                                                       \
+    {                                                                                        \
+        if (!(cond))                                                                         \
+        {                                                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            ++FailureCount();                                                                \
+        }                                                                                    \
+    } while (false)
+
+/// 带附加信息的断言，msg可以是任何能输出到ostream的表达式
+#define CHECK_MSG(cond, msg)                                                                 \
+    do                                                                                       \
+    {                                                                                        \
+        if (!(cond))                                                                         \
+        {                                                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed: " << msg << std::endl; \
+            ++FailureCount();                                                                \
+        }                                                                                    \
+    } while (false)
+
+/// 测试结果，作为main的返回值
+inline int TestResult()
+{
+    if (FailureCount() > 0)
+    {
+        std::cerr << FailureCount() << " check(s) failed." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/// test目录下的所有ksh谱面。目录由命令行的第一个参数给出
+inline std::vector<std::string> FixtureCharts(int argc, char** argv)
+{
+    std::vector<std::string> output;
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <test dir>" << std::endl;
+        ++FailureCount();
+        return output;
+    }
+    for (const auto& item : std::filesystem::directory_iterator(argv[1]))
+    {
+        if (item.path().extension() == ".ksh")
+        {
+            output.push_back(item.path().string());
+        }
+    }
+    std::sort(output.begin(), output.end());
+    return output;
+}
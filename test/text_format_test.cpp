@@ -0,0 +1,147 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 文本格式的测试：ksh谱面经过文本格式再导出，与直接导出的ksh完全相同；
+// 含有需要转义的字符（\ , 回车、换行）的值原样读回；CRLF和LF换行的文本读入结果相同；格式错误的行被拒绝。
+
+#include <sstream>
+
+#include "src/Chart/chart.h"
+#include "src/Chart/indexed_chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 导出为带有原谱面头的ksh
+static string ExportWithHeader(IndexedChart& ic, Chart& source)
+{
+    Chart chart = ic.ExportToChart();
+    chart.GetHeader() = source.GetHeader();
+    chart.GetCustomFX() = source.GetCustomFX();
+    return chart.ExportToString();
+}
+
+/// 把CRLF换行改为LF
+static string ToLF(string text)
+{
+    string output;
+    for (char c : text)
+    {
+        if (c != '\r')
+        {
+            output += c;
+        }
+    }
+    return output;
+}
+
+/// 检查字符串表中time处的值
+static bool HasValue(IndexList<string>& lst, int time, const string& first, const string& second)
+{
+    auto iter = lst.find(time);
+    return iter != lst.end() && iter->second.first() == first && iter->second.second() == second;
+}
+
+/// 逐个fixture检查 KSH -> IndexedChart -> 文本 -> IndexedChart -> KSH
+static void CheckFixtures(int argc, char** argv)
+{
+    for (const string& path : FixtureCharts(argc, argv))
+    {
+        Chart chart;
+        CHECK_MSG(chart.ImportFromFile(path), path);
+        IndexedChart ic(chart);
+        const string expected = ExportWithHeader(ic, chart);
+        const string text = ic.ExportToString();
+
+        IndexedChart from_string;
+        CHECK_MSG(from_string.ImportFromString(text), path);
+        CHECK_MSG(ExportWithHeader(from_string, chart) == expected, path << " from string");
+        CHECK_MSG(from_string.ExportToString() == text, path << " text");
+
+        istringstream stream(text);
+        IndexedChart from_stream;
+        CHECK_MSG(from_stream.ImportFromStream(stream), path);
+        CHECK_MSG(ExportWithHeader(from_stream, chart) == expected, path << " from stream");
+
+        IndexedChart from_lf;
+        CHECK_MSG(from_lf.ImportFromString(ToLF(text)), path);
+        CHECK_MSG(from_lf.ExportToString() == text, path << " LF");
+    }
+}
+
+/// 需要转义的值
+static void CheckEscapes()
+{
+    const string tricky = "a,b\\c\r\nd\\,";
+    const string spaced = " lead, and trail ";
+    IndexedChart ic;
+    ic.CommentList().insert(0, tricky);
+    ic.CommentList().insert(48, spaced, "\\r\\n");
+    ic.OtherItemsList().insert(96, "\r", "\n");
+    ic.OtherItemsList().insert(144, string());
+    ic.MarkList(MarkType::Tilt).insert(192, "1,5", "-2");
+
+    const string text = ic.ExportToString();
+    // 值内的换行都被转义，文本的每一行都以CRLF结尾
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        CHECK(text[i] != '\n' || (i > 0 && text[i - 1] == '\r'));
+        CHECK(text[i] != '\r' || (i + 1 < text.size() && text[i + 1] == '\n'));
+    }
+    CHECK(text.find("a\\,b\\\\c\\r\\nd\\\\\\,") != string::npos);
+
+    for (const string& input : {text, ToLF(text)})
+    {
+        IndexedChart read;
+        CHECK(read.ImportFromString(input));
+        CHECK(HasValue(read.CommentList(), 0, tricky, tricky));
+        CHECK(HasValue(read.CommentList(), 48, spaced, "\\r\\n"));
+        CHECK(HasValue(read.OtherItemsList(), 96, "\r", "\n"));
+        CHECK(HasValue(read.OtherItemsList(), 144, "", ""));
+        CHECK(HasValue(read.MarkList(MarkType::Tilt), 192, "1,5", "-2"));
+        CHECK(read.ExportToString() == text);
+
+        istringstream stream(input);
+        IndexedChart streamed;
+        CHECK(streamed.ImportFromStream(stream));
+        CHECK(streamed.ExportToString() == text);
+    }
+}
+
+/// 格式错误的行
+static void CheckMalformed()
+{
+    for (const char* bad : {"section BT-A\r\nabc : 1\r\n", "section BT-A\r\n12 : x\r\n", "section FX-L\r\n12 - 1\r\n",
+                            "total_time=abc\r\n", "12 : 1\r\n"})
+    {
+        IndexedChart ic;
+        CHECK_MSG(!ic.ImportFromString(bad), bad);
+        istringstream stream(bad);
+        CHECK_MSG(!ic.ImportFromStream(stream), bad);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CheckFixtures(argc, argv);
+    CheckEscapes();
+    CheckMalformed();
+    return TestResult();
+}
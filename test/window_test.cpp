@@ -0,0 +1,113 @@
+/*
+    This file is part of KSHRAM.
+
+    KSHRAM: A command-style K-Shoot Mania chart editing toolpack.
+    Copyright (C) 2024 Singular_Photon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// 限定小节范围执行的测试：范围在batch define/import之后时，范围内调用的batch仍然有定义，
+// 范围内的调用都被执行，且结果与完整执行相同（之前的小节没有写到范围内时）。
+
+#include <fstream>
+#include <sstream>
+
+#include "src/Application/application_bus.h"
+#include "src/Chart/chart.h"
+#include "test_utils.h"
+
+using namespace std;
+
+/// 一段小节的文本
+static string MeasuresText(Chart& chart, int first, int last)
+{
+    ostringstream os;
+    for (int i = first; i <= last; ++i)
+    {
+        os << chart[i];
+    }
+    return os.str();
+}
+
+/// 处理整张谱面。first >= 0时只执行小节first到last内的命令，与--measures相同
+static Chart Process(const string& text, const PathManager& paths, int first, int last, string& log)
+{
+    Chart chart;
+    CHECK(chart.ImportFromString(text));
+
+    ApplicationBus bus(paths);
+    ostringstream log_stream;
+    bus.GetErrorCollector().SetOutput(&log_stream);
+    if (first >= 0)
+    {
+        const int start = chart[first].StartTime();
+        const int end = chart[last].EndTime();
+        bus.BindChart(std::move(chart));
+        bus.SetTimeWindow(start, end);
+    }
+    else
+    {
+        bus.BindChart(std::move(chart));
+    }
+    bus.RunCommands();
+    log = log_stream.str();
+    return bus.TakeChart();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <test dir>" << endl;
+        return 1;
+    }
+    PathManager paths = PathManager::GetInstance();
+    paths.AddPath(argv[1]);
+
+    // batch.ksh在第一个小节导入batch文件，之后的小节调用其中的定义
+    const string path = string(argv[1]) + "/batch.ksh";
+    ifstream file(path, ios::binary);
+    const string text{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    CHECK_MSG(!text.empty(), path);
+
+    string full_log;
+    Chart full = Process(text, paths, -1, -1, full_log);
+    CHECK_MSG(full_log.find("undefined") == string::npos, full_log);
+
+    Chart original;
+    CHECK(original.ImportFromString(text));
+    const int measure_count = original.Grid().MeasureCount();
+    for (int first = 1; first < measure_count; ++first)
+    {
+        // 之前小节的命令写到范围内的部分不会出现，只比较从调用batch的小节开始、且前一个小节没有调用的范围
+        const bool comparable = MeasuresText(original, first, first).find("batch call") != string::npos &&
+                                MeasuresText(original, first - 1, first - 1).find("batch call") == string::npos;
+        for (int last = first; last < measure_count && last < first + 3; ++last)
+        {
+            string log;
+            Chart windowed = Process(text, paths, first, last, log);
+            CHECK_MSG(log.find("undefined") == string::npos, first << "-" << last << ": " << log);
+            // 范围内的调用都执行了，没有作为命令写回
+            CHECK_MSG(MeasuresText(windowed, first, last).find("batch call") == string::npos,
+                      "measures " << first << "-" << last);
+            if (comparable)
+            {
+                CHECK_MSG(MeasuresText(windowed, first, last) == MeasuresText(full, first, last),
+                          "measures " << first << "-" << last);
+            }
+        }
+    }
+    return TestResult();
+}